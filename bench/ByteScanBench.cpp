@@ -0,0 +1,117 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ByteScanBench.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/12 10:02:17 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/12 10:02:17 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @file ByteScanBench.cpp
+ * @brief Times the ByteScan levels on the header block of a browser request.
+ *
+ * Each iteration does what framing and parsing do: find the end of the
+ * header block, then split it into lines and check each field name and
+ * value. The baseline finds the same delimiters with std::string::find(),
+ * without the control byte check.
+ *
+ * Run with `make bench` (ByteScan.o is built with -O2, like in webserv).
+ */
+
+#include "../inc/ByteScan.hpp"
+#include <cstdio>  // std::printf()
+#include <cstdlib> // std::atoi()
+#include <ctime>   // std::clock()
+#include <string>  // std::string
+
+static const char REQUEST[] =
+    "GET /index.html?a=1&b=2 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+    "*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Cookie: session=abcdef0123456789abcdef0123456789; theme=dark; "
+    "lang=en\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+/// @brief Keeps the results alive, so the scans are not optimised out.
+static volatile std::size_t g_sink = 0;
+
+static double elapsedNs(std::clock_t start, int iterations) {
+    return (static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC *
+            1e9 / iterations);
+}
+
+/**
+ * @brief Frames and splits the request with the current level.
+ *
+ * @return The time of one iteration, in nanoseconds.
+ */
+static double benchLevel(const std::string &req, int iterations) {
+    const char *buf = req.data();
+    std::clock_t start = std::clock();
+
+    for (int i = 0; i < iterations; ++i) {
+        std::size_t end = ByteScan::findHeaderEnd(buf, req.size());
+        std::size_t pos = 0;
+        while (pos < end) {
+            std::size_t eol = ByteScan::findCrlf(buf + pos, end + 2 - pos);
+            if ((eol == 0) || (eol == std::string::npos))
+                break;
+            g_sink = g_sink + ByteScan::findNonToken(buf + pos, eol);
+            g_sink = g_sink + ByteScan::findCtl(buf + pos, eol);
+            pos += eol + 2;
+        }
+        g_sink = g_sink + end;
+    }
+    return (elapsedNs(start, iterations));
+}
+
+/// @brief Same work, done the way the parser did before ByteScan.
+static double benchFind(const std::string &req, int iterations) {
+    std::clock_t start = std::clock();
+
+    for (int i = 0; i < iterations; ++i) {
+        std::size_t end = req.find("\r\n\r\n");
+        std::size_t pos = 0;
+        while (pos < end) {
+            std::size_t eol = req.find("\r\n", pos);
+            if ((eol == pos) || (eol == std::string::npos))
+                break;
+            g_sink = g_sink + req.find(':', pos);
+            pos = eol + 2;
+        }
+        g_sink = g_sink + end;
+    }
+    return (elapsedNs(start, iterations));
+}
+
+int main(int argc, char **argv) {
+    std::string req(REQUEST, sizeof(REQUEST) - 1);
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+
+    if (iterations <= 0)
+        iterations = 1000000;
+    std::printf("%lu byte header block, %d iterations\n",
+                static_cast<unsigned long>(req.size()), iterations);
+    for (int l = ByteScan::SCALAR; l <= ByteScan::AVX2; ++l) {
+        ByteScan::setLevel(static_cast<ByteScan::Level>(l));
+        if (ByteScan::getLevel() != l)
+            break; // Not supported by this CPU
+        std::printf("  %-12s %8.1f ns/request\n",
+                    ByteScan::level2string(ByteScan::getLevel()),
+                    benchLevel(req, iterations));
+    }
+    std::printf("  %-12s %8.1f ns/request\n", "string::find",
+                benchFind(req, iterations));
+    return (0);
+}
@@ -0,0 +1,159 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ByteScanCheck.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/12 10:02:17 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/12 10:02:17 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @file ByteScanCheck.cpp
+ * @brief Checks that every ByteScan level returns what the scalar one does.
+ *
+ * The inputs are placed at every offset of a 32 byte block (so the SIMD
+ * loads are unaligned) with lengths across several blocks (so every tail
+ * length is hit), and are followed by bytes that would complete a delimiter
+ * if a scan read past the end. Exits non-zero when the levels disagree.
+ *
+ * Run with `make bench_check`.
+ */
+
+#include "../inc/ByteScan.hpp"
+#include <cstdio>   // std::printf(), std::fprintf()
+#include <cstdlib>  // std::rand(), std::srand()
+#include <cstring>  // std::memcpy(), std::memset(), std::strlen()
+
+/// @brief Bytes every scan looks for, and some it must skip.
+static const char DELIMS[] = "\r\n:%?#=&\t \x01\x7f\x80/\"{}(),;@[]\\-_~aZ09";
+static const std::size_t N_DELIMS = sizeof(DELIMS) - 1;
+
+/// @brief Bytes past the end that complete a delimiter, if a scan reads them.
+static const char *const OVERRUNS[] = {"\n\r\n\r\n#\x01 ", "\r\n\r\n#\x01 "};
+static const std::size_t N_OVERRUNS = 2;
+
+static const std::size_t MAX_OFFSET = 32;
+static const std::size_t MAX_LEN = 200;
+static const std::size_t SLACK = 64;
+static const int N_RANDOM = 50000;
+
+/// @brief What every scan returns on one input.
+struct Result {
+    std::size_t crlf;
+    std::size_t headerEnd;
+    std::size_t nonToken;
+    std::size_t ctl;
+    ByteScan::Target target;
+};
+
+static Result scanAll(const char *buf, std::size_t len) {
+    Result r;
+    r.crlf = ByteScan::findCrlf(buf, len);
+    r.headerEnd = ByteScan::findHeaderEnd(buf, len);
+    r.nonToken = ByteScan::findNonToken(buf, len);
+    r.ctl = ByteScan::findCtl(buf, len);
+    ByteScan::scanTarget(buf, len, r.target);
+    return (r);
+}
+
+/**
+ * @brief Compares two results.
+ *
+ * @details The target counts are only defined when no '#' or control byte
+ * stopped the scan (see ByteScan::scanTarget()).
+ */
+static bool isSame(const Result &a, const Result &b) {
+    const ByteScan::Target &x = a.target;
+    const ByteScan::Target &y = b.target;
+
+    if ((a.crlf != b.crlf) || (a.headerEnd != b.headerEnd) ||
+        (a.nonToken != b.nonToken) || (a.ctl != b.ctl))
+        return (false);
+    if ((x.firstPercent != y.firstPercent) ||
+        (x.firstQuestion != y.firstQuestion) || (x.hasHash != y.hasHash) ||
+        (x.hasCtl != y.hasCtl))
+        return (false);
+    if (x.hasHash || x.hasCtl)
+        return (true);
+    return ((x.nQuestion == y.nQuestion) && (x.nEqual == y.nEqual) &&
+            (x.nAmp == y.nAmp));
+}
+
+/**
+ * @brief Runs every level on an input and compares them to the scalar one.
+ *
+ * @param input The bytes to scan.
+ * @param len Their number.
+ * @return The number of levels that disagreed (reported on stderr).
+ */
+static int checkInput(const char *input, std::size_t len) {
+    static char block[MAX_OFFSET + MAX_LEN + SLACK];
+    int failed = 0;
+
+    for (std::size_t n = 0; n < MAX_OFFSET * N_OVERRUNS; ++n) {
+        std::size_t off = n % MAX_OFFSET;
+        const char *overrun = OVERRUNS[n / MAX_OFFSET];
+
+        std::memset(block, 'x', sizeof(block));
+        std::memcpy(block + off, input, len);
+        std::memcpy(block + off + len, overrun, std::strlen(overrun));
+
+        ByteScan::setLevel(ByteScan::SCALAR);
+        Result expected = scanAll(block + off, len);
+        for (int l = ByteScan::SSE2; l <= ByteScan::AVX2; ++l) {
+            ByteScan::setLevel(static_cast<ByteScan::Level>(l));
+            if (ByteScan::getLevel() != l)
+                break; // Not supported by this CPU
+            if (isSame(expected, scanAll(block + off, len)))
+                continue;
+            std::fprintf(stderr, "%s != scalar: offset %lu, length %lu\n",
+                         ByteScan::level2string(ByteScan::getLevel()),
+                         static_cast<unsigned long>(off),
+                         static_cast<unsigned long>(len));
+            ++failed;
+        }
+    }
+    return (failed);
+}
+
+int main(void) {
+    char input[MAX_LEN];
+    int failed = 0;
+
+    ByteScan::setLevel(ByteScan::AVX2);
+    std::printf("Checking the scalar scans against up to %s\n",
+                ByteScan::level2string(ByteScan::getLevel()));
+
+    // One delimiter at every position of every length, the tails included
+    for (std::size_t len = 0; (len <= 80) && !failed; ++len) {
+        for (std::size_t pos = 0; (pos < len) && !failed; ++pos) {
+            for (std::size_t d = 0; (d < N_DELIMS) && !failed; ++d) {
+                std::memset(input, 'a', len);
+                input[pos] = DELIMS[d];
+                failed += checkInput(input, len);
+            }
+        }
+    }
+    // Dense random inputs, for the delimiters split across blocks
+    std::srand(42);
+    for (int i = 0; (i < N_RANDOM) && !failed; ++i) {
+        std::size_t len = std::rand() % MAX_LEN;
+        int density = (std::rand() % 4) + 2;
+        for (std::size_t j = 0; j < len; ++j) {
+            if ((std::rand() % density) == 0)
+                input[j] = DELIMS[std::rand() % N_DELIMS];
+            else
+                input[j] = "abcdefgh"[std::rand() % 8];
+        }
+        failed += checkInput(input, len);
+    }
+    if (failed) {
+        std::printf("[FAIL] the levels disagree\n");
+        return (1);
+    }
+    std::printf("[OK] every level agrees\n");
+    return (0);
+}
@@ -28,13 +28,24 @@ class Location;
  * @brief Represents an HTTP response.
  *
  * This structure holds the status code, headers, and body of an HTTP response.
+ * Well-known headers are set in their HeaderId slot (an empty value is an
+ * unset header) and are sent in HeaderId order, before the other ones.
  */
 struct HttpResponse {
-    unsigned short status;                           /**< HTTP status code. */
-    std::multimap<std::string, std::string> headers; /**< HTTP headers. */
-    std::string body;                                /**< HTTP response body. */
-
-    HttpResponse() : status(OK) {}
+    unsigned short status;               /**< HTTP status code. */
+    std::string knownHeaders[N_HEADERS]; /**< Well-known headers. */
+    std::vector<std::pair<std::string, std::string> >
+        otherHeaders;                    /**< The rest, in order. */
+    std::string body;                    /**< HTTP response body. */
+    int fileFd;      /**< Body streamed from this file instead, or -1. */
+    off_t fileSize;  /**< Size of the file body. */
+
+    HttpResponse() : status(OK), fileFd(-1), fileSize(0) {}
+
+    void reset(void);
+    void setHeader(HeaderId id, const std::string &value);
+    void addHeader(const std::string &name, const std::string &value);
+    bool hasHeader(const std::string &name) const;
 };
 
 /**
@@ -42,26 +53,37 @@ struct HttpResponse {
  * @brief Abstract base class for HTTP responses.
  *
  * This class provides a common interface for generating HTTP responses.
- * Derived classes must implement the generateResponse() method.
+ * Derived classes must implement the generateResponse() method, which
+ * returns the header block; the body is then handed over by takeBody() or,
+ * for a file, takeFile(), so it never gets copied behind the headers.
+ *
+ * Handlers are not built per request: each event loop keeps one per method
+ * and binds it to the request and response of a connection with reset().
  */
 class AResponse {
   public:
     // Constructors
-    AResponse(const Server &, const HttpRequest &, const short);
+    AResponse();
     AResponse(const AResponse &);
     const AResponse &operator=(const AResponse &);
     virtual ~AResponse();
 
     // Public Member Functions
+    virtual void reset(const Server &server, const HttpRequest &request,
+                       HttpResponse &response, short status);
     virtual std::string generateResponse() = 0;
 	short getStatus() const;
+	void setKeepAlive(bool keepAlive);
+	int takeFile(off_t &size);
+	void takeBody(std::string &body);
 
   protected:
-    HttpRequest _request;       /**< The HTTP request. */
-    HttpResponse _response;     /**< The HTTP response. */
-    const Server &_server;      /**< Reference to the server configuration. */
+    const HttpRequest *_request; /**< The HTTP request. */
+    HttpResponse *_response;     /**< The HTTP response being built. */
+    const Server *_server;       /**< The server configuration. */
     std::string _locationRoute; /**< The location route. */
 	unsigned short _status; 	/**< The HTTP status code. */
+	bool _keepAlive;            /**< Whether the connection persists. */
 
     // Checkers
     bool isCGI() const;
@@ -84,7 +106,7 @@ class AResponse {
 
     // Getters
     std::string getLastModifiedDate(const std::string &path) const;
-    const std::string getResponseStr() const;
+    const std::string getHeaderStr() const;
     const std::string getPath() const;
     const std::string getPath(const std::string &root,
                               const std::string &path) const;
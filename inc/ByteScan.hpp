@@ -0,0 +1,77 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ByteScan.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/11 09:12:40 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/11 09:12:40 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef BYTESCAN_HPP
+#define BYTESCAN_HPP
+
+#include <cstddef>
+
+/**
+ * @class ByteScan
+ * @brief Vectorised searches over request bytes.
+ *
+ * Framing and parsing spend their time looking for a few delimiters. These
+ * scans test 16 (SSE2) or 32 (AVX2) bytes per step; the widest instruction
+ * set the CPU supports is picked once, at startup, with a scalar fallback
+ * on other CPUs. Offsets are returned as std::string::npos when nothing is
+ * found.
+ */
+class ByteScan {
+  public:
+	/// @brief Instruction set the scans run on
+	enum Level { SCALAR, SSE2, AVX2 };
+
+	/**
+	 * @struct Target
+	 * @brief What one pass over a request target found.
+	 */
+	struct Target {
+		std::size_t firstPercent;  /**< First '%', or npos. */
+		std::size_t firstQuestion; /**< First '?', or npos. */
+		std::size_t nQuestion;     /**< Number of '?'. */
+		std::size_t nEqual;        /**< Number of '='. */
+		std::size_t nAmp;          /**< Number of '&'. */
+		bool hasHash;              /**< A fragment ('#') was sent. */
+		bool hasCtl;               /**< A control byte or DEL was sent. */
+	};
+
+	// Searches
+	static std::size_t findCrlf(const char *buf, std::size_t len);
+	static std::size_t findHeaderEnd(const char *buf, std::size_t len);
+	static std::size_t findNonToken(const char *buf, std::size_t len);
+	static std::size_t findCtl(const char *buf, std::size_t len);
+	static void scanTarget(const char *buf, std::size_t len, Target &target);
+
+	// Dispatch
+	static Level getLevel(void);
+	static void setLevel(Level level);
+	static const char *level2string(Level level);
+
+  private:
+	struct Impl {
+		std::size_t (*findCrlf)(const char *, std::size_t);
+		std::size_t (*findHeaderEnd)(const char *, std::size_t);
+		std::size_t (*findNonToken)(const char *, std::size_t);
+		std::size_t (*findCtl)(const char *, std::size_t);
+		void (*scanTarget)(const char *, std::size_t, Target &);
+	};
+
+	static Level _level;
+	static Impl _impl;
+
+	static Level getSupportedLevel(void);
+
+	// Uninstantiable
+	ByteScan(void);
+};
+
+#endif
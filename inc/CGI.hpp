@@ -21,7 +21,8 @@
 
 class CGI {
   public:
-    CGI(HttpRequest &, HttpResponse &, const std::string &, const std::string &);
+    CGI(const HttpRequest &, HttpResponse &, const std::string &,
+        const std::string &);
     ~CGI();
 
     // Public Methods
@@ -14,9 +14,17 @@
 #define CLUSTER_HPP
 
 #include "AResponse.hpp"
+#include "Connection.hpp"
+#include "DeleteResponse.hpp"
+#include "ErrorResponse.hpp"
+#include "GetResponse.hpp"
+#include "GlobalConf.hpp"
 #include "HttpParser.hpp"
+#include "IoUring.hpp"
+#include "PostResponse.hpp"
 #include "Server.hpp"
 #include "Logger.hpp"
+#include "TimerWheel.hpp"
 #include <sys/socket.h>
 
 class Server;
@@ -36,6 +44,7 @@ class Cluster {
 		std::string name;     /**< Name of the virtual server. */
 		std::string ip;       /**< IP address of the virtual server. */
 		std::string port;     /**< Port number of the virtual server. */
+		ListenOptions options; /**< TCP parameters of its listen directive. */
 
 		bool operator<(const VirtualServer &rhs) const { // For std:set
 			if (this->ip != rhs.ip)
@@ -47,15 +56,18 @@ class Cluster {
 	};
 
 	// Constructor & Destructor
-	Cluster(const std::vector<Server> &servers); // Builds the cluster context of servers
-	~Cluster();                                  // Closes epoll fd
+	Cluster(const std::vector<Server> &servers,
+			const GlobalConf &global); // Builds the cluster context of servers
+	~Cluster();                        // Closes epoll fd
 
 	// Operators
 	const Server &operator[](size_t idx) const;
 
 	// Setup
 	bool hasDuplicates(void) const;
-	void setup(void); // Sets up the cluster listening sockets
+	void setup(void);          // Sets up the cluster listening sockets
+	void setupListeners(void); // Binds & listens (master, before fork)
+	void setupEventLoop(void); // Creates epoll/io_uring & watches listeners
 	void run(void);   // Runs the cluster listening loop
 	void stop(void);
 
@@ -66,37 +78,128 @@ class Cluster {
 	int getEpollFd(void) const;
 
   private:
+	/**
+	 * @struct UringSlot
+	 * @brief io_uring state of a connection slot (same index).
+	 */
+	struct UringSlot {
+		uint32_t gen;  /**< Bumped on close: older completions are stale. */
+		int fd;        /**< Source of the fixed file table update. */
+		bool sending;  /**< A SENDMSG is in flight. */
+		bool recvPaused; /**< recv cancelled until the send completes. */
+		struct msghdr msg;            /**< Header of the in-flight SENDMSG. */
+		struct iovec iov[MAX_IOVECS]; /**< Buffers of the in-flight SENDMSG. */
+		/// Output of closed connections, by generation, until their
+		/// cancelled send completes: the kernel may still read it.
+		std::map<uint32_t, std::deque<OutBuffer> > parked;
+	};
+
 	std::vector<const Server *> _servers;       /**< List of server pointers. */
 	std::vector<VirtualServer> _virtualServers; /**< List of virtual servers. */
 	std::vector<int> _listenSockets; /**< List of listening socket file descriptors. */
+	std::vector<ListenOptions> _listenOptions; /**< Same order as above. */
+	std::vector<HostTable> _hostTables;        /**< Same order as above. */
+	std::vector<std::string> _unixPaths; /**< Socket files bound here. */
+	pid_t _pid;                      /**< Process that created the cluster. */
+	GlobalConf _global;              /**< Main context directives. */
 	int _epollFd;                    /**< Epoll file descriptor. */
-	std::map<int, std::string> _requestBuff; /**< Buffer for incoming requests. */
+	int _wakeFd;                     /**< eventfd written by stop(). */
+	std::vector<Connection> _connections;  /**< Preallocated slots. */
+	std::vector<Connection *> _fdTable;    /**< fd -> slot, NULL if none. */
+	std::vector<Connection *> _freeSlots;  /**< Slots ready for accept. */
+	TimerWheel _timers;              /**< Timeouts of the connections. */
+	TimerWheel::Timer _acceptTimer;  /**< Ends a pause of accept4(). */
+	uint32_t _listenEvents;          /**< epoll events of the listeners. */
+	const std::string _shedResponse; /**< 503 sent by max_connections. */
+	IoUring _ring;                   /**< Open if `use io_uring` is active. */
+	std::vector<UringSlot> _uringSlots; /**< io_uring state of the slots. */
+	std::map<in_addr_t, std::size_t> _headerConns; /**< Per client IP. */
+	GetResponse _getHandler;         /**< Handlers reused by every request */
+	PostResponse _postHandler;       /**< of this event loop, see */
+	DeleteResponse _deleteHandler;   /**< getResponse(). */
+	ErrorResponse _errorHandler;
+	AResponse *_methodHandlers[UNKNOWN + 1]; /**< Method -> handler. */
+
+	static std::map<std::string, int> _unixListeners; /**< Path -> socket. */
 
 	// Private Methods
 	// setupCluster()
 	void setEpollFd(void);
+	void setWakeFd(void);
+	void setConnectionTable(void);
 	std::set<Socket> getVirtualServerSockets(void);
-	int setSocket(const std::string &ip, const std::string &port);
-	void startListen(int socket);
-	void setEpollSocket(int socket);
+	int setSocket(const Socket &addr);
+	int setUnixSocket(const Socket &addr);
+	void startListen(int socket, int backlog);
+	void setClientOptions(int clientFd, const ListenOptions &options);
+	void setEpollSocket(int socket, uint32_t events);
 
 	// run()
-	bool isSocketListening(int socket) const;
-	void setupConnection(int socket);
-	void setSocketToNonBlocking(int socket);
-	void handleRequest(int socket);
-	bool isRequestValid(const std::string &requestBuf) const;
-	void processRequest(int socket, const std::string &requestBuf);
-	const std::string getResponse(HttpRequest &,
-								  unsigned short &errorStatus,
-								  int socket);
-
-	const Server *getContext(const HttpRequest &, int socket);
+	Connection *getConnection(int socket);
+	Connection *allocConnection(int socket);
+	void releaseConnection(Connection &conn);
+	bool admitConnection(Connection &conn);
+	void shedConnection(Connection &conn);
+	void acceptConnections(const Connection &listener);
+	void setupConnection(const Connection &listener, int clientFd,
+						 const struct sockaddr_storage *peer);
+	bool countHeaderConn(Connection &conn,
+						 const struct sockaddr_storage *peer);
+	void uncountHeaderConn(Connection &conn);
+	void pauseAccepts(const std::string &reason);
+	void resumeAccepts(void);
+	void handleRequest(Connection &conn);
+	void serveRequests(Connection &conn);
+	void handleWrite(Connection &conn);
+	void processRequest(Connection &conn);
+	bool flushConnection(Connection &conn);
+	ssize_t sendFileSlice(Connection &conn);
+	void setConnectionEvents(Connection &conn, uint32_t events);
+	void setRequestContext(Connection &conn);
+	void queueContinue(Connection &conn);
+	void updateTimer(Connection &conn);
+	void handleTimeouts(void);
+	std::size_t getMaxBodySize(const Connection &conn) const;
+	std::size_t getReadLimit(const Connection &conn) const;
+	bool isBodyTooLarge(const Connection &conn) const;
+	void sendRejection(Connection &conn, short status);
+	void rejectRequest(Connection &conn, short status);
+	void lingerRequest(Connection &conn, short status);
+	void discardInput(Connection &conn);
+	bool checkRecvRate(Connection &conn, std::size_t nBytes);
+	bool checkSendRate(Connection &conn, std::size_t nBytes);
+	void setMethodHandlers(void);
+	void getResponse(unsigned short &errorStatus, const Server *server,
+					 Connection &conn, OutBuffer &response);
+
+	const Server *getContext(const HttpRequest &, const Connection &conn);
 	const Socket getSocketAddress(int socket);
-	const std::string getHostnameFromRequest(const HttpRequest &);
+	void setHostTable(HostTable &table, const Socket &addr) const;
 
 	void killConnection(int socket, int epollFd);
 
+	// io_uring backend
+	bool setupRing(void);
+	void runRing(void);
+	struct io_uring_sqe *getSqe(void);
+	std::size_t getSlotIndex(const Connection &conn) const;
+	void handleCompletion(const struct io_uring_cqe &cqe);
+	void armAccept(const Connection &listener);
+	void cancelAccept(const Connection &listener);
+	void handleAccept(const Connection &listener,
+					  const struct io_uring_cqe &cqe);
+	void armConnection(Connection &conn);
+	void armRecv(const Connection &conn);
+	void pauseRecv(const Connection &conn);
+	void resumeRecv(Connection &conn);
+	void handleRecv(Connection *conn, const struct io_uring_cqe &cqe);
+	bool isRequestTooLarge(const Connection &conn) const;
+	bool submitSend(Connection &conn);
+	void handleSend(Connection &conn, int sent);
+	void handleSendFile(Connection &conn, int events);
+	void continueSend(Connection &conn);
+	void cancelConnection(Connection &conn);
+
 	// Unnused Constructors & Operators
 	Cluster(void);
 	Cluster(const Cluster &src);
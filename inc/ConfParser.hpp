@@ -13,6 +13,7 @@
 #ifndef CONFPARSER_HPP
 #define CONFPARSER_HPP
 
+#include "GlobalConf.hpp"
 #include "Server.hpp"
 #include "Webserv.hpp"
 #include <sstream>
@@ -41,10 +42,12 @@ class ConfParser {
 
 	// Getters
 	std::vector<Server> getServers(void) const;
+	const GlobalConf &getGlobalConf(void) const;
 	std::string getIdentifier(const std::string &str);
 
 	// Setters
 	void loadContext(std::vector<std::string> &serverBlocks);
+	void loadEventsBlock(const std::string &block);
 
 	// Debug
 	void debugServerLocations(size_t serverN, const std::string &route);
@@ -52,6 +55,7 @@ class ConfParser {
   private:
 	std::string _confFile;
 	std::vector<Server> _servers;
+	GlobalConf _global;
 };
 
 #endif
@@ -0,0 +1,183 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Connection.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/03/24 10:12:31 by passunca          #+#    #+#             */
+/*   Updated: 2025/03/24 10:12:31 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONNECTION_HPP
+#define CONNECTION_HPP
+
+#include "AResponse.hpp"
+#include "HostTable.hpp"
+#include "HttpParser.hpp"
+#include "Server.hpp"
+#include "TimerWheel.hpp"
+#include "Webserv.hpp"
+#include <deque>
+
+// Client sockets read edge-triggered: each EPOLLIN is drained to EAGAIN
+#define CLIENT_READ_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLET)
+
+/**
+ * @struct OutBuffer
+ * @brief A queued response: header block, in-memory body, then an optional
+ * file body.
+ *
+ * The header block and the body stay in separate buffers and are sent as
+ * separate iovecs, so the body is never copied behind the headers. The file
+ * is owned by the output queue holding the buffer: it is closed once sent,
+ * or when the connection is released.
+ */
+struct OutBuffer {
+	std::string head; /**< Status line and headers. */
+	std::string body; /**< In-memory body, empty with a file body. */
+	int fileFd;       /**< Body sent with sendfile() after head, or -1. */
+	off_t fileOffset; /**< Next byte of the file body to send. */
+	off_t fileEnd;    /**< End of the file body. */
+
+	OutBuffer(void);
+
+	std::size_t size(void) const;
+};
+
+/**
+ * @struct RateMeter
+ * @brief Transfer rate of one direction of a connection.
+ *
+ * The bytes are counted over a window that starts with the first transfer.
+ * Once the window has elapsed, the rate is checked and a new window starts.
+ */
+struct RateMeter {
+	uint64_t start;    /**< Start of the window (ms), 0 if not started. */
+	std::size_t bytes; /**< Bytes transferred since start. */
+
+	RateMeter(void);
+
+	void reset(void);
+	bool update(std::size_t nBytes, std::size_t minRate, long windowMs);
+};
+
+/**
+ * @struct Connection
+ * @brief A slot of the Cluster's connection table.
+ *
+ * Slots are preallocated (worker_connections per event loop) and indexed by
+ * file descriptor. A slot either holds a listening socket, whose virtual
+ * hosts are shared with the connections it accepts, or a client connection.
+ *
+ * A connection cycles through READING_HEADERS -> READING_BODY -> WRITING and,
+ * if keep-alive applies, back to IDLE where it waits for the next request on
+ * the same socket. Responses are queued in outQueue and stay in WRITING until
+ * the socket has accepted all of them. A request whose body is too large is
+ * answered before the body is read; the connection then stays LINGERING,
+ * discarding its input, until it is closed.
+ */
+struct Connection {
+	enum State {
+		READING_HEADERS, /**< Waiting for the end of the header block. */
+		READING_BODY,    /**< Headers complete, body still incoming. */
+		WRITING,         /**< Responses queued, waiting for EPOLLOUT. */
+		IDLE,            /**< Between requests on a persistent connection. */
+		LINGERING        /**< Rejected: input discarded until the peer closes. */
+	};
+
+	enum Type {
+		FREE,     /**< Unused slot, in the free list. */
+		LISTENER, /**< Listening socket. */
+		CLIENT    /**< Accepted client connection. */
+	};
+
+	/// @brief Stage of the chunked body decoder
+	enum ChunkState {
+		CHUNK_SIZE,     /**< Reading a chunk-size line. */
+		CHUNK_DATA,     /**< Moving chunk data into the body. */
+		CHUNK_DATA_END, /**< Expecting the CRLF after the data. */
+		CHUNK_TRAILER   /**< Reading trailer fields, up to an empty line. */
+	};
+
+	/// @brief Outcome of readInput()
+	enum ReadStatus {
+		READ_DRAINED, /**< The socket has no more data (EAGAIN). */
+		READ_FULL,    /**< requestBuff reached the limit. */
+		READ_CLOSED,  /**< The peer closed its side. */
+		READ_ERROR    /**< recv() failed, errno set. */
+	};
+
+	Type type;               /**< What the slot currently holds. */
+	int fd;                  /**< Socket file descriptor. */
+	int listenFd;            /**< Listening socket the client came from. */
+	Socket localAddr;        /**< Bound address, of a listener only. */
+	const HostTable *hosts;  /**< Virtual hosts reachable through listenFd. */
+	const Server *admitted;  /**< Server whose max_connections counts us. */
+	State state;             /**< Current stage of the request cycle. */
+	std::string requestBuff; /**< Bytes received but not yet processed. */
+	std::size_t scanPos;     /**< Bytes of requestBuff already framed. */
+	std::size_t headerLen;   /**< Header block length, 0 while incomplete. */
+	std::size_t requestLen;  /**< Framed request length, 0 while unknown. */
+	bool chunked;            /**< Body framed by Transfer-Encoding: chunked. */
+	ChunkState chunkState;   /**< Where the chunked decoder stands. */
+	std::size_t chunkLeft;   /**< Data bytes left in the current chunk. */
+	std::size_t bodyLen;     /**< Body bytes decoded after the header block. */
+	unsigned short framingStatus; /**< OK, or why the body framing failed. */
+	bool mustClose;          /**< The framing forbids a following request. */
+	bool sendContinue;       /**< Expect: 100-continue not answered yet. */
+	std::size_t nRequests;   /**< Requests served on this connection. */
+	bool keepAlive;          /**< Whether to keep the socket after a reply. */
+	bool peerClosed;         /**< Client half-closed: close once served. */
+	in_addr_t peerIp;        /**< Client IPv4 address, network order. */
+	bool ipCounted;          /**< Counted in the header phase of peerIp. */
+	RateMeter recvRate;      /**< Rate the request is received at. */
+	RateMeter sendRate;      /**< Rate the responses are sent at. */
+	std::deque<OutBuffer> outQueue; /**< Responses not fully sent yet. */
+	std::size_t outOffset;   /**< In-memory bytes of the front sent. */
+	uint32_t events;         /**< epoll events currently registered. */
+	TimerWheel::Timer timer; /**< Timeout of the current state. */
+	State timerState;        /**< State the timer was armed for. */
+	const Server *server;    /**< Server (and route) the timeouts come from. */
+	std::string route;       /**< Location route of the last request. */
+	bool hasContext;         /**< server/route set for the pending request. */
+	HttpRequest request;     /**< Request being served, reused by the next. */
+	HttpResponse response;   /**< Response being built, reused by the next. */
+
+	// Constructors
+	Connection(void);
+	explicit Connection(int socket);
+
+	// Slot
+	void release(void);
+
+	// State
+	void resumeReading(void);
+
+	// Input
+	ReadStatus readInput(std::size_t initialSize, std::size_t maxSize);
+
+	// Framing
+	bool frameRequest(void);
+	void consumeRequest(void);
+	void resetFraming(void);
+
+	// Output
+	std::size_t gatherOutput(struct iovec *iov, std::size_t maxIov,
+	                         bool &fileFollows) const;
+	void consumeOutput(std::size_t sent);
+	bool isSendingFile(void) const;
+	void popOutput(void);
+
+	// Keep-alive
+	static bool isKeepAliveRequested(const HttpRequest &request);
+
+  private:
+	void setBodyFraming(void);
+	void frameChunkedBody(void);
+};
+
+std::string connState2string(Connection::State state);
+
+#endif
@@ -0,0 +1,76 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConnectionLimit.hpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/02 11:20:37 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/02 11:20:37 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONNECTIONLIMIT_HPP
+#define CONNECTIONLIMIT_HPP
+
+#include "Webserv.hpp"
+
+#define LOW_WATERMARK_PERCENT 90 // Default low watermark of max_connections
+
+/**
+ * @class ConnectionLimit
+ * @brief Caps the open connections of a server, or of the whole webserv.
+ *
+ * The counter lives in an anonymous shared mapping, so every worker thread
+ * and forked worker process counts against the same limit. Copies of a
+ * limit share its counter. Each worker process also counts its own share,
+ * in the slot given by setWorkerSlot(), so that the master can take back
+ * the connections of a worker that died (see resetWorkerSlot()).
+ *
+ * Admission has hysteresis: once the high watermark is reached, new
+ * connections are shed until the count falls below the low watermark, so a
+ * saturated server does not flap between accepting and rejecting.
+ */
+class ConnectionLimit {
+  public:
+	// Constructors & Destructor
+	ConnectionLimit(void);
+	ConnectionLimit(const ConnectionLimit &copy);
+	~ConnectionLimit(void);
+
+	// Operators
+	ConnectionLimit &operator=(const ConnectionLimit &src);
+
+	// Getters
+	bool isSet(void) const;
+	std::size_t getHighWatermark(void) const;
+	std::size_t getLowWatermark(void) const;
+
+	// Setters
+	void setWatermarks(std::vector<std::string> &tks);
+
+	// Admission
+	bool acquire(void) const;
+	void release(void) const;
+
+	// Worker processes
+	static void setWorkerSlot(std::size_t slot);
+	static void resetWorkerSlot(std::size_t slot);
+
+  private:
+	/// @brief State shared by every worker.
+	struct Counter {
+		std::size_t count; /**< Open connections. */
+		int shedding;      /**< 1 between high and low watermark crossings. */
+		std::size_t share[MAX_WORKERS]; /**< Part of count, per process. */
+	};
+
+	std::size_t _high;  /**< Connections at which shedding starts. */
+	std::size_t _low;   /**< Connections below which shedding stops. */
+	Counter *_counter;  /**< Shared counter, NULL when unlimited. */
+
+	static std::vector<Counter *> _counters; /**< Every mapped counter. */
+	static std::size_t _slot; /**< Share of this worker process. */
+};
+
+#endif
@@ -28,7 +28,7 @@
 class DeleteResponse : public AResponse {
   public:
 	// Constructors
-	DeleteResponse(const Server &, const HttpRequest &);
+	DeleteResponse();
 	DeleteResponse(const DeleteResponse &);
 	~DeleteResponse();
 
@@ -44,7 +44,6 @@ class DeleteResponse : public AResponse {
 
   private:
 	// Unusable
-	DeleteResponse();
 	DeleteResponse &operator=(const DeleteResponse &);
 };
 
@@ -25,14 +25,11 @@
  */
 class ErrorResponse : public AResponse {
   public:
-	ErrorResponse(const Server &, const HttpRequest &, short errorStatus);
+	ErrorResponse();
 	ErrorResponse(const ErrorResponse &);
 	~ErrorResponse();
 
 	std::string generateResponse();
-
-  private:
-	ErrorResponse();
 };
 
 #endif
@@ -0,0 +1,78 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   GlobalConf.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/03/26 09:41:17 by passunca          #+#    #+#             */
+/*   Updated: 2025/03/26 09:41:17 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef GLOBALCONF_HPP
+#define GLOBALCONF_HPP
+
+#include "ConnectionLimit.hpp"
+#include "Webserv.hpp"
+
+/// @brief Directives set in the main context, outside of any server block.
+class GlobalConf {
+  public:
+    // Constructors
+    GlobalConf(void);
+    GlobalConf(const GlobalConf &copy);
+    ~GlobalConf(void);
+
+    // Operators
+    GlobalConf &operator=(const GlobalConf &src);
+
+    // Setup
+    void initDirectiveMap(void);
+    void validate(void) const;
+
+    // Getters
+    std::size_t getWorkerThreads(void) const;
+    std::size_t getWorkerProcesses(void) const;
+    std::size_t getMultiAccept(void) const;
+    std::size_t getWorkerConnections(void) const;
+    std::size_t getEpollBatch(void) const;
+    const ConnectionLimit &getConnectionLimit(void) const;
+    bool getUseIoUring(void) const;
+
+    // Setters
+    void setDirective(std::string &directive);
+    void setEventsDirective(std::string &directive);
+    void setWorkerThreads(std::vector<std::string> &tks);
+    void setWorkerProcesses(std::vector<std::string> &tks);
+    void setMultiAccept(std::vector<std::string> &tks);
+    void setWorkerConnections(std::vector<std::string> &tks);
+    void setEpollBatch(std::vector<std::string> &tks);
+    void setMaxConnections(std::vector<std::string> &tks);
+    void setUse(std::vector<std::string> &tks);
+
+  private:
+    // Main Context
+    std::size_t _workerThreads;
+    std::size_t _workerProcesses;
+
+    // Events Context
+    std::size_t _multiAccept; // Max accepts per readiness event, 0 = no cap
+    std::size_t _workerConnections; // Slots (listeners + clients) per loop
+    std::size_t _epollBatch;        // Max events per epoll_wait()
+    ConnectionLimit _connLimit;     // max_connections of the whole webserv
+    bool _useIoUring;               // io_uring event loop instead of epoll
+
+    // Directive Maps w/ Function Pointer
+    typedef void (GlobalConf::*DirHandler)(std::vector<std::string> &d);
+    std::map<std::string, DirHandler> _directiveMap;
+    std::map<std::string, DirHandler> _eventsDirectiveMap;
+
+    void applyDirective(const std::map<std::string, DirHandler> &dirMap,
+                        std::string &directive, const std::string &context);
+};
+
+// Insertion Operator
+std::ostream &operator<<(std::ostream &os, const GlobalConf &ctx);
+
+#endif
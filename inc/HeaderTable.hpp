@@ -0,0 +1,80 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   HeaderTable.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/14 10:21:07 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/14 10:21:07 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef HEADERTABLE_HPP
+#define HEADERTABLE_HPP
+
+#include "StrView.hpp"
+
+/// @brief Well-known header fields, in the order responses list them
+enum HeaderId {
+    HDR_ACCEPT,
+    HDR_ACCEPT_ENCODING,
+    HDR_ACCEPT_LANGUAGE,
+    HDR_ALLOW,
+    HDR_AUTHORIZATION,
+    HDR_CACHE_CONTROL,
+    HDR_CONNECTION,
+    HDR_CONTENT_DISPOSITION,
+    HDR_CONTENT_LENGTH,
+    HDR_CONTENT_TYPE,
+    HDR_COOKIE,
+    HDR_DATE,
+    HDR_EXPECT,
+    HDR_HOST,
+    HDR_IF_MODIFIED_SINCE,
+    HDR_IF_NONE_MATCH,
+    HDR_KEEP_ALIVE,
+    HDR_LAST_MODIFIED,
+    HDR_LOCATION,
+    HDR_ORIGIN,
+    HDR_RANGE,
+    HDR_REFERER,
+    HDR_RETRY_AFTER,
+    HDR_SERVER,
+    HDR_SET_COOKIE,
+    HDR_TE,
+    HDR_TRAILER,
+    HDR_TRANSFER_ENCODING,
+    HDR_UPGRADE,
+    HDR_USER_AGENT,
+    N_HEADERS,
+    HDR_OTHER = N_HEADERS // Any other name
+};
+
+/**
+ * @class HeaderTable
+ * @brief Resolves header names to a HeaderId.
+ *
+ * Requests and responses keep the well-known headers in an array indexed by
+ * HeaderId, so that reading one is an index instead of a search. The name is
+ * resolved once, when the header is parsed or set, by a perfect hash of its
+ * length and first and last bytes, confirmed by a single case-insensitive
+ * comparison.
+ */
+class HeaderTable {
+  public:
+	static HeaderId lookup(const StrView &name);
+	static HeaderId lookup(const char *name);
+	static const char *getName(HeaderId id);
+
+  private:
+	static const char *const _names[N_HEADERS];
+	static const unsigned char _slots[64];
+
+	static std::size_t hash(const char *name, std::size_t len);
+
+	// Uninstantiable
+	HeaderTable(void);
+};
+
+#endif
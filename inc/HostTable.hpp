@@ -0,0 +1,67 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   HostTable.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/02 10:21:37 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/02 10:21:37 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef HOSTTABLE_HPP
+#define HOSTTABLE_HPP
+
+#include "StrView.hpp"
+#include "Webserv.hpp"
+#include <stdint.h>
+
+class Server;
+
+/**
+ * @class HostTable
+ * @brief Virtual hosts reachable through one listening socket.
+ *
+ * Maps the lowercase server_names of the servers listening on the socket to
+ * their Server, with the socket's default server as fallback. The table is
+ * an open-addressing hash table built once, before the event loop starts:
+ * resolving the Host header of a request hashes it in place, without
+ * allocating.
+ */
+class HostTable {
+  public:
+	// Constructors
+	HostTable(void);
+
+	// Setup
+	void setDefault(const Server *server);
+	void add(const std::string &name, const Server *server);
+
+	// Lookup
+	const Server *getDefault(void) const;
+	const Server *find(const StrView &host) const;
+
+  private:
+	/**
+	 * @struct Entry
+	 * @brief A bucket of the table, empty while server is NULL.
+	 */
+	struct Entry {
+		uint32_t hash;        /**< Hash of name. */
+		std::string name;     /**< Lowercase server_name. */
+		const Server *server; /**< Server the name belongs to. */
+
+		Entry(void) : hash(0), server(NULL) {}
+	};
+
+	std::vector<Entry> _entries; /**< Buckets, a power of two of them. */
+	std::size_t _count;          /**< Buckets in use. */
+	const Server *_default;      /**< Server of requests matching no name. */
+
+	static uint32_t hash(const char *name, std::size_t len);
+	std::size_t probe(uint32_t hash, const char *name, std::size_t len) const;
+	void grow(void);
+};
+
+#endif
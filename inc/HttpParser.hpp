@@ -18,28 +18,58 @@
 #ifndef HTTPPARSER_HPP
 #define HTTPPARSER_HPP
 
+#include "ByteScan.hpp"
+#include "HeaderTable.hpp"
+#include "StrView.hpp"
 #include "Webserv.hpp"
 
+/**
+ * @struct HeaderField
+ * @brief A header of a request that has no slot of its own.
+ */
+struct HeaderField {
+	StrView name;  /**< Name as received: compare it with iequals(). */
+	StrView value; /**< Trimmed value. */
+	HeaderId id;   /**< HDR_OTHER, or the well-known header it repeats. */
+};
+
 /**
  * @struct HttpRequest
  * @brief Represents an HTTP request with its components.
+ *
+ * The StrViews point into the buffer given to parseHttp() (the connection's
+ * receive buffer) and are only valid until the request is consumed from it.
+ * Only the decoded path is materialised, in a string that keeps its capacity
+ * across the requests of a connection.
+ *
+ * A well-known header is stored at its HeaderId, resolved once by the
+ * parser, and read back by index. Other headers, and the repeats of a
+ * well-known one, are kept in order in a flat vector.
  */
 struct HttpRequest {
 	// Request Line
 	enum Method method;
-	std::string uri;
-	std::string encodedUri;
-	std::string protocolVersion;
+	std::string uri;         // Decoded path, without the query
+	StrView target;          // Request target as received (encoded)
+	StrView query;           // Query after the '?', still encoded
+	StrView protocolVersion;
 
 	// Header
-	std::multimap<std::string, std::string> headers;
-	// Query Parameters
-	std::multimap<std::string, std::string> queryParams;
+	StrView knownHeaders[N_HEADERS];       // Well-known headers, by HeaderId
+	std::vector<HeaderField> otherHeaders; // The rest, and repeated ones
 	// Request Body
-	std::string body;
+	StrView body;
+
+	// Connection
+	std::string serverPort; // Port it was received on, empty on a unix socket
 
 	// Constructors
 	HttpRequest() : method(UNKNOWN) {};
+
+	void reset(void);
+	const StrView *getHeader(HeaderId id) const;
+	const StrView *getHeader(const char *name) const;
+	bool hasHeaderToken(HeaderId id, const char *token) const;
 };
 
 /**
@@ -55,6 +85,10 @@ struct HttpRequest {
  * request adheres to the HTTP protocol standards and extracts necessary
  * information for further processing.
  *
+ * The parser keeps no state between calls and is safe to use from several
+ * worker threads at once. It makes a single pass over the buffer and does
+ * not copy it: the request is described by slices of it (see HttpRequest).
+ *
  * The class is designed to be robust and efficient, handling various edge cases
  * and ensuring compliance with HTTP/1.1 standards. It supports common HTTP
  * methods and validates the structure and content of requests to prevent
@@ -63,24 +97,29 @@ struct HttpRequest {
 class HttpRequestParser {
   public:
 	// Public methods
-	static unsigned short parseHttp(const std::string &requestBuf,
+	static unsigned short parseHttp(const char *requestBuf, std::size_t len,
 									HttpRequest &httpReq);
 
   private:
 	// Private helper methods
-	static bool getRequestLine(HttpRequest &httpReq, const std::string &buffer);
-	static bool getHeaderFields(HttpRequest &httpReq, const std::string &headers);
-	static void parseQueries(HttpRequest &httpReq);
+	static StrView getLine(const StrView &buffer, std::size_t &pos);
+	static StrView getToken(const StrView &line, std::size_t &pos);
+	static bool getRequestLine(HttpRequest &httpReq, const StrView &line,
+							   unsigned short &responseStatus);
+	static bool getHeaderFields(HttpRequest &httpReq, const StrView &line,
+								unsigned short &responseStatus);
+	static void splitTarget(HttpRequest &httpReq,
+							const ByteScan::Target &scan);
 
 	// Checking
-	static bool isMethodValid(const std::string &method);
-	static bool isMethodImplemented(const std::string &method);
-	static bool isUrlValid(const std::string &url);
-	static bool isProtocolVersionValid(const std::string &protocolVersion);
+	static bool isMethodValid(const StrView &method);
+	static bool isMethodImplemented(const StrView &method);
+	static bool isUrlValid(const StrView &url, const ByteScan::Target &scan);
+	static bool isProtocolVersionValid(const StrView &protocolVersion);
 	// Decoding
-	static std::string decodeUrl(const std::string &encoded);
+	static void decodeUrl(const StrView &encoded, std::size_t firstPercent,
+						  std::string &decoded);
 	// Trimming
-	static std::string trim(const std::string &str);
 	static void trimNull(std::string &str);
 
 	// Private Constructors (uninstantiable)
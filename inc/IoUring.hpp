@@ -0,0 +1,111 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   IoUring.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/04 10:03:51 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/04 10:03:51 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef IOURING_HPP
+#define IOURING_HPP
+
+#include "Webserv.hpp"
+#include <linux/io_uring.h>
+#include <poll.h> // POLLIN
+#include <stdint.h>
+
+// Multishot accept/recv, provided buffer rings and cancellation of fixed
+// files (Linux >= 6.0 headers)
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_SETUP_SINGLE_ISSUER) &&  \
+    defined(IORING_ASYNC_CANCEL_FD_FIXED)
+#define HAS_IO_URING 1
+#else
+#define HAS_IO_URING 0
+#endif
+
+#define URING_ENTRIES 256       // Submission queue size
+#define URING_BUF_GROUP 0       // Provided buffer group of the recv buffers
+#define URING_BUF_COUNT 256     // Provided recv buffers (power of 2)
+#define URING_BUF_SIZE (8 * KB) // Size of each provided recv buffer
+
+/**
+ * @class IoUring
+ * @brief Minimal io_uring wrapper (raw syscalls, no liburing).
+ *
+ * Owns the submission and completion rings, a sparse table of registered
+ * (fixed) files and a ring of provided buffers used by multishot recv.
+ * Every method reports failures through its return value: an unsupported
+ * kernel makes setup() fail and the Cluster falls back to epoll.
+ */
+class IoUring {
+  public:
+	// Constructor & Destructor
+	IoUring(void);
+	~IoUring(void);
+
+	// Setup
+	bool setup(unsigned entries);
+	bool registerFiles(unsigned nFiles);
+	bool setupBufferRing(void);
+	bool enable(void);
+	void close(void);
+	bool isOpen(void) const;
+
+	// Submission
+	struct io_uring_sqe *getSqe(void);
+	int submit(void);
+	int wait(int timeoutMs);
+
+	// Completion
+	bool peek(struct io_uring_cqe &cqe);
+
+	// Registered files & provided buffers
+	int updateFile(unsigned index, int fd);
+	char *getBuffer(unsigned short bid);
+	void recycleBuffer(unsigned short bid);
+
+  private:
+	int _fd;                 /**< io_uring instance. */
+	unsigned _features;      /**< IORING_FEAT_* of the kernel. */
+
+	// Submission queue
+	void *_sqRing;           /**< Mapped SQ ring. */
+	std::size_t _sqRingSize;
+	struct io_uring_sqe *_sqes; /**< Mapped SQE array. */
+	std::size_t _sqesSize;
+	unsigned *_sqHead;
+	unsigned *_sqTail;
+	unsigned *_sqArray;
+	unsigned _sqMask;
+	unsigned _sqEntries;
+	unsigned _sqeTail;       /**< SQEs handed out by getSqe(). */
+	unsigned _sqeHead;       /**< SQEs published to the kernel. */
+
+	// Completion queue
+	void *_cqRing;           /**< Mapped CQ ring (may alias _sqRing). */
+	std::size_t _cqRingSize;
+	unsigned *_cqHead;
+	unsigned *_cqTail;
+	unsigned _cqMask;
+	struct io_uring_cqe *_cqes;
+
+	// Provided buffers
+	struct io_uring_buf *_bufRing; /**< Ring of provided buffers. */
+	std::size_t _bufRingSize;
+	char *_buffers;
+	unsigned short _bufTail;
+
+	unsigned flushSq(void);
+	int enter(unsigned toSubmit, unsigned minComplete, unsigned flags,
+			  const void *arg, std::size_t argSize);
+
+	// Unnused Constructors & Operators
+	IoUring(const IoUring &src);
+	IoUring &operator=(const IoUring &src);
+};
+
+#endif
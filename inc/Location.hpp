@@ -45,6 +45,7 @@ class Location {
     std::pair<short, std::string> getReturn() const;
     std::string getCgiExt() const;
     std::set<Method> getValidMethods() const;
+    long getTimeout(Timeout timeout) const;
 
     // Setters Handlers
     void setRoot(std::string &root);
@@ -57,6 +58,7 @@ class Location {
     void setUploadStore(std::vector<std::string> &tks);
     void setReturn(std::vector<std::string> &tks);
     void setCgiExt(std::vector<std::string> &tks);
+    void setTimeout(std::vector<std::string> &tks);
 
     static const MethodMapping methodMap[];
 
@@ -70,6 +72,7 @@ class Location {
     std::string _uploadStore;
     std::pair<short, std::string> _return;
     std::string _cgiExt;
+    long _timeouts[N_TIMEOUTS]; // In milliseconds, -1 if unset
 
     typedef void (Location::*DirHandler)(std::vector<std::string> &d);
     std::map<std::string, DirHandler> _directiveMap;
@@ -42,12 +42,13 @@ struct File {
 class PostResponse : public AResponse {
   public:
 	// Constructors
-    PostResponse(const Server &, const HttpRequest &, int clientFd,
-                 int epollFd);
+    PostResponse();
     PostResponse(const PostResponse &);
     ~PostResponse();
 
     // Public Methods
+    void reset(const Server &server, const HttpRequest &request,
+               HttpResponse &response, short status);
     std::string generateResponse();
 
   private:
@@ -56,13 +57,11 @@ class PostResponse : public AResponse {
     std::map<int, std::string> _fileBuffer; /**< Buffer for file data */
     std::string _limit;             /**< Boundary limit for the response */
     struct File _file2upload;       /**< File to be uploaded */
-    int _clientFd;                  /**< Client socket file descriptor */
-    int _epollFd;                   /**< Epoll instance file descriptor */
 
     // Private Methods
     unsigned short parseHttp();
-    bool hasHeader(const std::string &header) const;
-    bool send100continue();
+    bool hasHeader(HeaderId id) const;
+    bool checkExpect();
 
     short checkBody();
     const std::string getLimit();
@@ -80,7 +79,6 @@ class PostResponse : public AResponse {
     short checkForm();
     
     // Unusable
-    PostResponse();
     PostResponse &operator=(const PostResponse &);
 };
 
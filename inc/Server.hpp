@@ -13,9 +13,29 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include "ConnectionLimit.hpp"
 #include "Location.hpp"
 #include "Webserv.hpp"
 
+#define UNIX_SOCKET_PREFIX "unix:" // listen unix:/path
+#define UNIX_SOCKET_IP "unix"       // Socket::ip of a unix domain socket
+
+/// @brief TCP tuning parameters of a listen directive (0 = system default)
+struct ListenOptions {
+    ListenOptions(void)
+        : backlog(SOMAXCONN), rcvBuf(0), sndBuf(0), deferred(false),
+          fastOpen(0), noDelay(false), notSentLowat(0), isSet(false) {};
+
+    int backlog;      // backlog=: accept queue length
+    int rcvBuf;       // rcvbuf=: SO_RCVBUF of the listener (inherited)
+    int sndBuf;       // sndbuf=: SO_SNDBUF of the listener (inherited)
+    bool deferred;    // deferred: TCP_DEFER_ACCEPT, wake on the first data
+    int fastOpen;     // fastopen=: TCP_FASTOPEN queue length
+    bool noDelay;     // nodelay: TCP_NODELAY on accepted sockets
+    int notSentLowat; // notsent_lowat=: TCP_NOTSENT_LOWAT of accepted sockets
+    bool isSet;       // Any parameter was given
+};
+
 /// @brief Network Listening Endpoint
 struct Socket {
     // Constructors
@@ -33,9 +53,13 @@ struct Socket {
         return ((this->ip == rhs.ip) && (this->port == rhs.port));
     }
 
+    // Unix domain sockets keep their path in port: `unix:/path` when joined
+    bool isUnix(void) const { return (this->ip == UNIX_SOCKET_IP); }
+
     // Attributes
     std::string ip;
     std::string port;
+    ListenOptions options; // Not part of the address: ignored by comparisons
 };
 
 class Server {
@@ -77,10 +101,23 @@ class Server {
     std::string getCgiExt(void) const;
     std::set<Method> getValidMethods() const;
     std::set<Method> getValidMethods(const std::string &route) const;
+    std::size_t getKeepaliveRequests(void) const;
+    std::size_t getHeaderBufferSize(void) const;
+    std::size_t getMaxHeaderSize(void) const;
+    std::size_t getClientMinRate(void) const;
+    std::size_t getSendMinRate(void) const;
+    long getMinRateWindow(void) const;
+    std::size_t getHeaderConnsPerIp(void) const;
+    const ConnectionLimit &getConnectionLimit(void) const;
+    long getTimeout(Timeout timeout) const;
+    long getTimeout(Timeout timeout, const std::string &route) const;
+    std::string getLocationRoute(const std::string &uri) const;
 
     // Setters
     void setDirective(std::string &directive);
     void setListen(std::vector<std::string> &tks);
+    void setListenAddress(const std::string &val, Socket &socket) const;
+    void setListenOption(const std::string &param, ListenOptions &options);
     void setServerName(std::vector<std::string> &tks);
     void setClientMaxBodySize(std::vector<std::string> &tks);
     void setErrorPage(std::vector<std::string> &tks);
@@ -91,6 +128,14 @@ class Server {
     void setUploadStore(std::vector<std::string> &tks);
     void setReturn(std::vector<std::string> &tks);
     void setCgiExt(std::vector<std::string> &tks);
+    void setKeepaliveRequests(std::vector<std::string> &tks);
+    void setHeaderBufferSize(std::vector<std::string> &tks);
+    void setLargeHeaderBuffers(std::vector<std::string> &tks);
+    void setMinRate(std::vector<std::string> &tks);
+    void setMinRateWindow(std::vector<std::string> &tks);
+    void setHeaderConnsPerIp(std::vector<std::string> &tks);
+    void setMaxConnections(std::vector<std::string> &tks);
+    void setTimeout(std::vector<std::string> &tks);
     void setIPaddr(const std::string &ip, struct sockaddr_in &sockaadr) const;
 
   private:
@@ -107,6 +152,15 @@ class Server {
     std::set<Method> _validMethods;
     std::pair<short, std::string> _return;
     std::string _cgiExt;
+    std::size_t _keepaliveRequests;
+    std::size_t _headerBufferSize; // Initial read buffer of a request
+    std::size_t _maxHeaderSize;    // Largest header block accepted
+    std::size_t _clientMinRate;    // Bytes/s a request is read at, 0 = off
+    std::size_t _sendMinRate;      // Bytes/s a response is sent at, 0 = off
+    long _minRateWindow;           // Milliseconds the rates are measured over
+    std::size_t _headerConnsPerIp; // Header phase connections per IP, 0 = off
+    ConnectionLimit _connLimit; // max_connections, shared by every worker
+    long _timeouts[N_TIMEOUTS]; // In milliseconds, indexed by Timeout
 
     // Directive Map w/ Function Pointer
     typedef void (Server::*DirHandler)(std::vector<std::string> &d);
@@ -0,0 +1,63 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StrView.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/09 11:02:14 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/09 11:02:14 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef STRVIEW_HPP
+#define STRVIEW_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/**
+ * @struct StrView
+ * @brief A read-only slice of a buffer owned by someone else.
+ *
+ * The parser describes a request with StrViews into the connection's
+ * receive buffer instead of copying every token into a std::string. A view
+ * is only valid as long as the bytes it points to are: str() materialises
+ * it when a copy has to outlive the buffer.
+ */
+struct StrView {
+	const char *data; /**< First byte, NULL for an empty view. */
+	std::size_t size; /**< Number of bytes. */
+
+	// Constructors
+	StrView(void) : data(NULL), size(0) {}
+	StrView(const char *bytes, std::size_t len) : data(bytes), size(len) {}
+	explicit StrView(const std::string &str)
+		: data(str.data()), size(str.size()) {}
+
+	// Accessors
+	bool empty(void) const { return (size == 0); }
+	char operator[](std::size_t i) const { return (data[i]); }
+	std::string str(void) const;
+
+	// Comparison
+	bool equals(const char *str) const;
+	bool iequals(const char *str) const;
+	bool iequals(const StrView &other) const;
+	bool istartsWith(const char *prefix) const;
+
+	// Search
+	std::size_t find(char c, std::size_t pos = 0) const;
+	std::size_t find(const std::string &needle, std::size_t pos = 0) const;
+	std::size_t rfind(char c) const;
+
+	// Slicing
+	StrView substr(std::size_t pos,
+				   std::size_t len = std::string::npos) const;
+	StrView trim(void) const;
+};
+
+std::ostream &operator<<(std::ostream &os, const StrView &view);
+
+#endif
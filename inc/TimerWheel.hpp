@@ -0,0 +1,84 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/03/28 15:02:44 by passunca          #+#    #+#             */
+/*   Updated: 2025/03/28 15:02:44 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include "Webserv.hpp"
+#include <stdint.h>
+
+#define TIMER_TICK_MS 10   // Resolution of the wheel
+#define TIMER_LEVELS 4     // 64^4 ticks of 10ms: ~46 hours
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+#define TIMER_SLOT_MASK (TIMER_SLOTS - 1)
+
+class TimerWheel;
+
+/**
+ * @class TimerWheel
+ * @brief Hierarchical timing wheel driving the event loop's timeouts.
+ *
+ * Timers are intrusive nodes (usually embedded in a Connection), so
+ * scheduling, re-scheduling and cancelling are O(1) and never allocate.
+ * Level 0 holds the timers expiring within the next 64 ticks; each higher
+ * level covers 64 times the range of the previous one, and its slots are
+ * cascaded down as the wheel turns.
+ */
+class TimerWheel {
+  public:
+	/**
+	 * @struct Timer
+	 * @brief A node of the wheel. Copies are never linked.
+	 */
+	struct Timer {
+		Timer *prev;       /**< Previous node in the slot list. */
+		Timer *next;       /**< Next node in the slot list. */
+		uint64_t expires;  /**< Absolute expiry, in ticks. */
+		int fd;            /**< Owner of the timer, reported on expiry. */
+		TimerWheel *wheel; /**< Wheel the timer is linked in, if any. */
+
+		Timer(void);
+		Timer(const Timer &copy);
+		Timer &operator=(const Timer &src);
+		~Timer(void);
+
+		bool isActive(void) const;
+	};
+
+	// Constructor & Destructor
+	TimerWheel(void);
+	~TimerWheel(void);
+
+	// Timers
+	void schedule(Timer &timer, long delayMs);
+	void cancel(Timer &timer);
+	void advance(std::vector<int> &expired);
+	int getNextTimeout(void) const;
+
+	static uint64_t now(void);
+
+  private:
+	Timer _slots[TIMER_LEVELS][TIMER_SLOTS]; /**< Sentinel of each slot. */
+	uint64_t _currentTick;                   /**< Last tick processed. */
+	std::size_t _count;                      /**< Number of linked timers. */
+
+	void link(Timer &timer);
+	void unlink(Timer &timer);
+	void cascade(int level);
+
+	// Unnused Constructors & Operators
+	TimerWheel(const TimerWheel &src);
+	TimerWheel &operator=(const TimerWheel &src);
+};
+
+#endif
@@ -15,6 +15,7 @@
 
 #include "Logger.hpp"
 #include "Server.hpp"
+#include "StrView.hpp"
 #include "Webserv.hpp"
 
 /* ************************************************************************** */
@@ -23,8 +24,10 @@
 
 std::string toLower(const std::string &str);
 Method string2method(const std::string &str);
+Method string2method(const StrView &str);
 std::string method2string(Method method);
 std::string err2string(ErrCodes code);
+bool isHeaderToken(const StrView &value, const char *token);
 
 /// @brief Converts a number to a string
 /// @param num The number to be converted
@@ -50,6 +53,23 @@ template <typename T> T string2number(const std::string &str) {
 	return (num);
 }
 
+/* ************************************************************************** */
+/*                                  Storage                                   */
+/* ************************************************************************** */
+
+/// @brief Atomically accounts for bytes about to be stored on the server
+/// @param bytes The number of bytes to store
+/// @return false (and nothing is accounted) if MAX_STORAGE_SIZE would overflow
+bool reserveStorage(std::size_t bytes);
+
+/// @brief Atomically releases bytes that are no longer stored on the server
+/// @param bytes The number of bytes released
+void releaseStorage(std::size_t bytes);
+
+/// @brief Moves the storage counter to memory shared with forked workers
+/// @throw std::runtime_error if the shared mapping cannot be created
+void shareStorage(void);
+
 /* ************************************************************************** */
 /*                                    Time                                    */
 /* ************************************************************************** */
@@ -69,4 +89,15 @@ time_t getTime(const std::string &httpTime);
 /// @return The current date and time as a string in HTTP-date format
 std::string getHttpDate();
 
+/// @brief Parses a duration: "30" or "30s", "500ms", "2m", "1h"
+/// @param value The duration string
+/// @return The duration in milliseconds
+/// @throws std::runtime_error if the duration is invalid
+long parseDuration(const std::string &value);
+
+/// @brief Maps a timeout directive name to its Timeout
+/// @param directive The directive name (e.g. "keepalive_timeout")
+/// @return The Timeout, or N_TIMEOUTS if it is not a timeout directive
+Timeout directive2timeout(const std::string &directive);
+
 #endif
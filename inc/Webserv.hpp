@@ -26,12 +26,19 @@
 #include <fcntl.h>     // O_NONBLOCK F_GETFL F_SETFL
 #include <limits.h>
 #include <netinet/in.h>   // struct sockaddr_in INADDR_ANY
+#include <netinet/tcp.h>  // TCP_NODELAY TCP_DEFER_ACCEPT TCP_FASTOPEN
+#include <pthread.h>      // pthread_create() pthread_join()
 #include <signal.h>       // signal
 #include <sys/epoll.h>    // epoll_create()
+#include <sys/eventfd.h>  // eventfd()
+#include <sys/mman.h>     // mmap()
 #include <sys/resource.h> // struct rlimit
+#include <sys/sendfile.h> // sendfile()
 #include <sys/socket.h>   // SOMAXCONN
 #include <sys/stat.h>     // stat()
 #include <sys/time.h>     // gettimeofday()
+#include <sys/uio.h>      // struct iovec
+#include <sys/un.h>       // struct sockaddr_un
 #include <sys/wait.h>     // waitpid()
 #include <unistd.h>       // close()
 
@@ -57,24 +64,6 @@
 #define SERVER_NAME "webserv"
 
 #define URL_MAX_SIZE 8192
-#define MAX_EPOLL_FD_PATH "/proc/sys/fs/epoll/max_user_watches"
-
-/// @brief Get the maximum number of open fds for epoll
-static int getMaxClients() {
-    // Get the maximum number of open fds for epoll
-    std::ifstream maxClients(MAX_EPOLL_FD_PATH);
-    int val = 666; // Default value
-
-    if (maxClients.is_open()) { // if file opened successfully
-        maxClients >> val;      // Assign first int in file stream to val
-        return (val);
-    }
-
-    Logger::error("Failed to open " MAX_EPOLL_FD_PATH);
-    return (val);
-}
-
-const int MAX_CLIENTS = getMaxClients();
 
 // Unit constants (cast to unsigned long long to prevent preprocessor overflows)
 #define KB 1024ULL
@@ -87,15 +76,47 @@ const int MAX_CLIENTS = getMaxClients();
 #define MAX_PORTS ((64 * KB) - 1)
 #define MAX_BODY_SIZE MB
 #define REQ_BUFF_SIZE (2 * KB)
+#define READ_CHUNK_SIZE (64 * KB)          // Max bytes per recv() of a drain
+#define DEFAULT_HEADER_BUFFER_SIZE KB      // client_header_buffer_size
+#define DEFAULT_LARGE_HEADER_BUFFERS 4     // large_client_header_buffers N
+#define DEFAULT_LARGE_HEADER_SIZE (8 * KB) // large_client_header_buffers size
 #define CHILD_MAX_MEMORY (200 * MB)
+#define DEFAULT_KEEPALIVE_REQUESTS 1000
+#define MAX_WORKERS 256
+#define WORKER_RESPAWN_DELAY 1 // Seconds between restarts of a crashing worker
+#define DEFAULT_MULTI_ACCEPT 64          // Accepts per listener wakeup
+#define ACCEPT_PAUSE_MS 500              // Accepts paused after EMFILE/ENFILE
+#define DEFAULT_WORKER_CONNECTIONS 1024  // Connection slots per event loop
+#define MAX_PIPELINED_REQUESTS 32        // Responses queued per connection
+#define MAX_IOVECS 64                    // Buffers gathered per sendmsg()
+#define SENDFILE_MIN_SIZE (16 * KB)      // Smaller files are sent from memory
+#define SENDFILE_SLICE (512 * KB)        // Max file bytes sent per wakeup
+#define MAX_WORKER_CONNECTIONS (1 << 20)
+#define DEFAULT_EPOLL_BATCH 512          // Events returned per epoll_wait()
+#define MAX_EPOLL_BATCH 65536
+#define LINGERING_TIME_MS (5 * 1000)     // Input drained after a 413
+#define LINGERING_READS 16               // recv() per wakeup while lingering
+#define SHED_RETRY_AFTER 5               // Retry-After (s) of the 503 on overload
+#define DEFAULT_TIMEOUT_MS (60 * 1000)           // client_header/body, send
+#define DEFAULT_KEEPALIVE_TIMEOUT_MS (75 * 1000) // keepalive_timeout
+#define DEFAULT_MIN_RATE_WINDOW_MS (10 * 1000)   // min_rate_window
+
+#ifndef EPOLLEXCLUSIVE // Linux >= 4.5, missing from older libc headers
+# define EPOLLEXCLUSIVE (1u << 28)
+#endif
 
 /**
  * @brief Global flag indicating if the server is running.
+ *
+ * Cleared from the signal handler and polled by every worker's event loop.
  */
-extern bool isRunning;
+extern volatile sig_atomic_t isRunning;
 
 /**
  * @brief Global variable to store the amount of bytes stored in the server.
+ *
+ * Shared by all worker threads: only update it through reserveStorage() and
+ * releaseStorage(). Worker processes share it after shareStorage().
  */
 extern std::size_t storageSize;
 
@@ -118,6 +139,15 @@ enum Method { // Keep only the methods that we want to implement
 
 enum State { TRUE, FALSE, UNSET };
 
+/// @brief Connection timeouts (indexes of the server/location timeout tables)
+enum Timeout {
+    CLIENT_HEADER_TIMEOUT, // Whole header block must arrive within it
+    CLIENT_BODY_TIMEOUT,   // Max gap between two reads of the body
+    KEEPALIVE_TIMEOUT,     // Max idle time between two requests
+    SEND_TIMEOUT,          // Max gap between two writes of the response
+    N_TIMEOUTS
+};
+
 enum ErrCodes {
     CONTINUE = 100,
     SWITCHING_PROTOCOLS = 101,
@@ -48,6 +48,18 @@
  * The application handles SIGINT signals to ensure a graceful shutdown of the
  * server cluster.
  *
+ * @section workers Worker Threads
+ *
+ * With `worker_threads N;` in the main context, N clusters are set up, each
+ * with its own epoll instance and SO_REUSEPORT listening sockets. The first
+ * one runs on the main thread, the others on their own pthread.
+ *
+ * @section processes Worker Processes
+ *
+ * With `worker_processes N;` the main process becomes a master: it binds the
+ * listening sockets once, forks N workers that each run their own event loop,
+ * restarts workers that die and relays SIGINT to all of them.
+ *
  * @section logging Logging
  *
  * The application uses the Logger class to log information, warnings, and
@@ -82,13 +94,24 @@
 #include "../inc/Webserv.hpp"
 
 /**
- * @brief Global pointer to the Cluster instance.
+ * @brief Global list of the Cluster instances, one per worker thread.
+ *
+ * This list is used to manage the server clusters and handle signals.
+ */
+std::vector<Cluster *> clusters;
+
+/**
+ * @brief PIDs of the forked worker processes (master process only).
  *
- * This pointer is used to manage the server cluster and handle signals.
+ * Sized once before forking so the signal handler can read it safely.
  */
-Cluster *cluster = NULL;
+std::vector<pid_t> workerPids;
 
 void handleSignal(int code);
+static void *runWorker(void *arg);
+static int superviseWorkers(Cluster *cluster, std::size_t nWorkers);
+static pid_t forkWorker(Cluster *cluster, std::size_t slot);
+static void deleteClusters(void);
 
 /**
  * @brief Main function for the Webserv application.
@@ -114,25 +137,23 @@ int main(int argc, char **argv) {
 
     Logger::info("Starting Webserv");
 
-#ifdef DEBUG
-    std::stringstream s;
-    s << "MAX_CLIENTS: " << MAX_CLIENTS;
-    Logger::debug(s.str());
-#endif
-
     // Setup Signal (INT)
     signal(SIGINT, &handleSignal);
+    // Peers closing persistent connections must not kill the server
+    signal(SIGPIPE, SIG_IGN);
 
     // Parse Config
     std::string configFile = argc >= 2 ? argv[1] : "conf/default.conf";
     ConfParser parser(configFile);
 
     std::vector<Server> servers;
+    GlobalConf global;
 
     // Attempt to load Config
     try {
         parser.loadConf();
         servers = parser.getServers();
+        global = parser.getGlobalConf();
     } catch (std::exception &e) {
         Logger::error(e.what());
         return (EXIT_FAILURE);
@@ -142,34 +163,80 @@ int main(int argc, char **argv) {
     showContainer(__func__, "Loaded Servers", servers);
 #endif
 
+    std::size_t nWorkers = global.getWorkerThreads();
+    std::vector<pthread_t> threads;
     try {
         // Init Server Cluster & Check for Duplicates
-        cluster = new Cluster(servers);
-        if (cluster->hasDuplicates()) {
+        clusters.push_back(new Cluster(servers, global));
+        if (clusters[0]->hasDuplicates()) {
             Logger::error("Server config has duplicates");
+            deleteClusters();
             return (EXIT_FAILURE);
         }
 
 #ifdef DEBUG
         showContainer(__func__, "Initialized Cluster",
-                      cluster->getVirtualServers());
+                      clusters[0]->getVirtualServers());
 #endif
 
-        // Attemp to setup Cluster
+        // Attemp to setup Cluster (one per worker thread)
         Logger::info("Setting up the cluster");
-        cluster->setup();
-		std::cout << *cluster << std::endl;
+        std::size_t nProcesses = global.getWorkerProcesses();
+        if (nProcesses > 1) { // Master: bind once, fork the workers
+            clusters[0]->setupListeners();
+            std::cout << *clusters[0] << std::endl;
+            shareStorage();
+            int status = superviseWorkers(clusters[0], nProcesses);
+            deleteClusters();
+            Logger::info("Webserv stopped");
+            return (status);
+        }
+        clusters[0]->setup();
+        for (std::size_t i = 1; i < nWorkers; ++i) {
+            clusters.push_back(new Cluster(servers, global));
+            clusters.back()->setup();
+        }
+        std::cout << *clusters[0] << std::endl;
+
+        // Workers leave signals to the main thread
+        sigset_t mask, oldMask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        pthread_sigmask(SIG_BLOCK, &mask, &oldMask);
+        for (std::size_t i = 1; i < nWorkers; ++i) {
+            pthread_t tid;
+            int err = pthread_create(&tid, NULL, &runWorker, clusters[i]);
+            if (err != 0) {
+                Logger::error("Failed to start worker thread: " +
+                              std::string(std::strerror(err)));
+                clusters[i]->stop();
+                break;
+            }
+            threads.push_back(tid);
+        }
+        pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
 
         // Start running the cluster
-        Logger::info("Ready to receive requests!");
-        cluster->run();
-        delete cluster;
+        std::stringstream ss;
+        ss << "Ready to receive requests on " << (threads.size() + 1)
+           << " worker thread(s)!";
+        Logger::info(ss.str());
+        clusters[0]->run();
     } catch (std::exception &e) {
         Logger::error(e.what());
-        delete cluster;
+        isRunning = false;
+        for (std::size_t i = 0; i < clusters.size(); ++i)
+            clusters[i]->stop();
+        for (std::size_t i = 0; i < threads.size(); ++i)
+            pthread_join(threads[i], NULL);
+        deleteClusters();
         return (EXIT_FAILURE);
     }
 
+    for (std::size_t i = 0; i < threads.size(); ++i)
+        pthread_join(threads[i], NULL);
+    deleteClusters();
+
     Logger::info("Webserv stopped");
     return (EXIT_SUCCESS);
 
@@ -185,13 +252,157 @@ int main(int argc, char **argv) {
  */
 void handleSignal(int code) {
     (void)code;
-    if (cluster == NULL) {
+    if (clusters.empty()) {
         Logger::warn("Signal caught, but the cluster is not active");
         std::exit(0);
     }
 
     std::cout << "\n";
-    cluster->stop();
+    Logger::warn("Stop triggered. Webserv will stop in moments...");
+    if (!workerPids.empty()) { // Master: relay to the workers
+        isRunning = false;
+        for (std::size_t i = 0; i < workerPids.size(); ++i)
+            if (workerPids[i] > 0)
+                kill(workerPids[i], SIGINT);
+        return;
+    }
+    for (std::size_t i = 0; i < clusters.size(); ++i)
+        clusters[i]->stop();
+
+}
+
+/**
+ * @brief Forks the worker processes and restarts them when they die.
+ *
+ * @details Returns once SIGINT has been received and every worker has been
+ * reaped. A worker that dies shortly after being started is restarted after
+ * WORKER_RESPAWN_DELAY seconds, so a crash loop does not spin the CPU.
+ *
+ * @param cluster The cluster whose listening sockets are already bound.
+ * @param nWorkers The number of worker processes to keep running.
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if no worker could be started.
+ */
+static int superviseWorkers(Cluster *cluster, std::size_t nWorkers) {
+    std::vector<std::time_t> started(nWorkers, 0);
+    workerPids.assign(nWorkers, -1);
+
+    std::size_t nStarted = 0;
+    for (std::size_t i = 0; i < nWorkers; ++i) {
+        workerPids[i] = forkWorker(cluster, i);
+        started[i] = std::time(NULL);
+        if (workerPids[i] > 0)
+            ++nStarted;
+    }
+    if (nStarted == 0) {
+        Logger::error("Failed to start any worker process");
+        return (EXIT_FAILURE);
+    }
+
+    std::stringstream ss;
+    ss << "Ready to receive requests on " << nStarted << " worker process(es)!";
+    Logger::info(ss.str());
+
+    while (isRunning) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno == EINTR)
+                continue;
+            break; // No children left
+        }
 
+        std::vector<pid_t>::iterator it =
+            std::find(workerPids.begin(), workerPids.end(), pid);
+        if ((it == workerPids.end()) || !isRunning)
+            continue;
+        std::size_t idx = (it - workerPids.begin());
+
+        std::stringstream s;
+        s << "Worker " << pid;
+        if (WIFSIGNALED(status))
+            s << " killed by signal " << WTERMSIG(status);
+        else
+            s << " exited with status " << WEXITSTATUS(status);
+        s << ", restarting it";
+        Logger::warn(s.str());
+        ConnectionLimit::resetWorkerSlot(idx); // Its connections are gone
+
+        if ((std::time(NULL) - started[idx]) < WORKER_RESPAWN_DELAY)
+            sleep(WORKER_RESPAWN_DELAY);
+        if (!isRunning)
+            break;
+        workerPids[idx] = forkWorker(cluster, idx);
+        started[idx] = std::time(NULL);
+    }
+
+    // Relay the stop (again) and reap every worker
+    for (std::size_t i = 0; i < workerPids.size(); ++i)
+        if (workerPids[i] > 0)
+            kill(workerPids[i], SIGINT);
+    while ((waitpid(-1, NULL, 0) != -1) || (errno == EINTR))
+        ;
+    return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Forks one worker process that runs the cluster's event loop.
+ *
+ * @details The worker inherits the listening sockets bound by the master and
+ * creates its own epoll instance. It never returns to the caller.
+ *
+ * @param cluster The cluster whose listening sockets are already bound.
+ * @param slot The worker index, where max_connections counts its share.
+ * @return The worker's PID in the master, or -1 if fork() failed.
+ */
+static pid_t forkWorker(Cluster *cluster, std::size_t slot) {
+    std::cout.flush(); // Do not duplicate buffered logs in the worker
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid == -1) {
+        Logger::error("Failed to fork worker process: " +
+                      std::string(std::strerror(errno)));
+        return (-1);
+    }
+    if (pid > 0)
+        return (pid);
+
+    // Worker process
+    workerPids.clear();
+    ConnectionLimit::setWorkerSlot(slot);
+    int status = EXIT_SUCCESS;
+    try {
+        cluster->setupEventLoop();
+        cluster->run();
+    } catch (std::exception &e) {
+        Logger::error(e.what());
+        status = EXIT_FAILURE;
+    }
+    deleteClusters();
+    std::exit(status);
+}
+
+/**
+ * @brief Entry point of a worker thread: runs one cluster's event loop.
+ *
+ * @param arg The Cluster owned by this worker.
+ * @return Always NULL.
+ */
+static void *runWorker(void *arg) {
+    Cluster *worker = static_cast<Cluster *>(arg);
+    try {
+        worker->run();
+    } catch (std::exception &e) {
+        Logger::error(e.what());
+    }
+    return (NULL);
+}
+
+/**
+ * @brief Deletes every cluster once all worker threads have been joined.
+ */
+static void deleteClusters(void) {
+    for (std::size_t i = 0; i < clusters.size(); ++i)
+        delete clusters[i];
+    clusters.clear();
 }
 /** @} */
@@ -24,33 +24,101 @@
 
 #include "../inc/AResponse.hpp"
 
+/* ************************************************************************** */
+/*                                HttpResponse                                */
+/* ************************************************************************** */
+
+/**
+ * @brief Empties the response for the next request on the same connection.
+ *
+ * Closes the file body if it was never handed over by takeFile().
+ */
+void HttpResponse::reset(void) {
+    status = OK;
+    for (std::size_t i = 0; i < N_HEADERS; ++i)
+        knownHeaders[i].clear(); // Keeps the capacity for the next response
+    otherHeaders.clear();
+    body.clear();
+    if (fileFd != -1)
+        close(fileFd);
+    fileFd = -1;
+    fileSize = 0;
+}
+
+/**
+ * @brief Sets a well-known header, replacing its previous value.
+ *
+ * @param id The header.
+ * @param value Its value.
+ */
+void HttpResponse::setHeader(HeaderId id, const std::string &value) {
+    knownHeaders[id] = value;
+}
+
+/**
+ * @brief Adds a header by name, as a CGI script sends it.
+ *
+ * @details A well-known header that is not set yet goes to its slot; any
+ * other header, or a repeat, is kept in order with the other headers.
+ *
+ * @param name The header name, in any case.
+ * @param value Its value.
+ */
+void HttpResponse::addHeader(const std::string &name,
+                             const std::string &value) {
+    HeaderId id = HeaderTable::lookup(name.c_str());
+    if ((id != HDR_OTHER) && knownHeaders[id].empty())
+        knownHeaders[id] = value;
+    else
+        otherHeaders.push_back(std::make_pair(name, value));
+}
+
+/**
+ * @brief Checks if a header is set.
+ *
+ * @param name The header name, in any case.
+ * @return true if it is set, false otherwise.
+ */
+bool HttpResponse::hasHeader(const std::string &name) const {
+    HeaderId id = HeaderTable::lookup(name.c_str());
+    if (id != HDR_OTHER)
+        return (!knownHeaders[id].empty());
+    std::vector<std::pair<std::string, std::string> >::const_iterator it;
+    for (it = otherHeaders.begin(); it != otherHeaders.end(); ++it)
+        if (StrView(it->first).iequals(name.c_str()))
+            return (true);
+    return (false);
+}
+
 /* ************************************************************************** */
 /*                                Constructors                                */
 /* ************************************************************************** */
 
 /**
- * @brief Constructs an AResponse object.
- * @param server The server configuration.
- * @param request The HTTP request.
+ * @brief Constructs an AResponse object, bound to no request yet.
  *
- * Initializes the AResponse object with the given server configuration
- * and HTTP request.
+ * Handlers are built once per event loop and bound to each request with
+ * reset().
  */
-AResponse::AResponse(const Server &server, const HttpRequest &request, const short errorStatus)
-    : _request(request), _server(server), _status(errorStatus) {}
+AResponse::AResponse()
+    : _request(NULL), _response(NULL), _server(NULL), _status(OK),
+      _keepAlive(false) {}
 
 /**
  * @brief Copy constructor for AResponse.
  * @param other The AResponse object to copy from.
  *
- * Initializes a new AResponse object as a copy of the given object.
+ * Initializes a new AResponse object bound to the same request.
  */
 AResponse::AResponse(const AResponse &other)
     : _request(other._request), _response(other._response),
-      _server(other._server), _locationRoute(other._locationRoute) {}
+      _server(other._server), _locationRoute(other._locationRoute),
+      _status(other._status), _keepAlive(other._keepAlive) {}
 
 /**
  * @brief Destructor for AResponse.
+ *
+ * The request and response belong to the connection: nothing to release.
  */
 AResponse::~AResponse() {}
 
@@ -72,6 +140,32 @@ const AResponse &AResponse::operator=(const AResponse &other) {
     return (*this);
 }
 
+/* ************************************************************************** */
+/*                              PUBLIC METHODS                                */
+/* ************************************************************************** */
+
+/**
+ * @brief Binds the handler to the next request.
+ * @param server The server configuration selected for the request.
+ * @param request The parsed request, owned by the connection.
+ * @param response The response to fill, owned by the connection and already
+ * reset.
+ * @param status The status of the request, OK or the error to answer.
+ *
+ * Replaces the per-request construction of a handler: the request is
+ * referenced rather than copied, and the response is built in the
+ * connection's buffers, which keep their capacity across requests.
+ */
+void AResponse::reset(const Server &server, const HttpRequest &request,
+                      HttpResponse &response, short status) {
+    _request = &request;
+    _response = &response;
+    _server = &server;
+    _locationRoute.clear();
+    _status = status;
+    _keepAlive = false;
+}
+
 /* ************************************************************************** */
 /*                             PROTECTED METHODS                              */
 /* ************************************************************************** */
@@ -89,9 +183,9 @@ const AResponse &AResponse::operator=(const AResponse &other) {
  * server.
  */
 bool AResponse::isCGI() const {
-    std::string cgiExt = _server.getCgiExt(_locationRoute);
-    size_t dotPos = _request.uri.find_last_of('.');
-    return ((!cgiExt.empty()) && (_request.uri.substr(dotPos) == cgiExt));
+    std::string cgiExt = _server->getCgiExt(_locationRoute);
+    size_t dotPos = _request->uri.find_last_of('.');
+    return ((!cgiExt.empty()) && (_request->uri.substr(dotPos) == cgiExt));
 }
 
 /**
@@ -103,7 +197,7 @@ bool AResponse::isCGI() const {
  * It returns true if a valid return directive is found, otherwise false.
  */
 bool AResponse::hasReturn() const {
-    std::pair<short, std::string> redir = _server.getReturn(_locationRoute);
+    std::pair<short, std::string> redir = _server->getReturn(_locationRoute);
 
     if ((redir.first == -1) || (redir.second.empty()))
         return (false);
@@ -120,15 +214,14 @@ bool AResponse::hasReturn() const {
  * header to "application/octet-stream".
  */
 void AResponse::loadReturn() {
-    std::pair<short, std::string> redir = _server.getReturn(_locationRoute);
-    _response.body = redir.second;
-    _response.status = redir.first;
+    std::pair<short, std::string> redir = _server->getReturn(_locationRoute);
+    _response->body = redir.second;
+    _response->status = redir.first;
     loadHeaders();
 
     if ((redir.first == MOVED_PERMANENTLY) || (redir.first == FOUND))
-        _response.headers.insert(std::make_pair("Location", redir.second));
-    _response.headers.insert(
-        std::make_pair("Content-Type", "application/octet-stream"));
+        _response->setHeader(HDR_LOCATION, redir.second);
+    _response->setHeader(HDR_CONTENT_TYPE, "application/octet-stream");
 }
 
 /**
@@ -149,7 +242,7 @@ int8_t AResponse::isDir(const std::string &path) const {
 }
 
 const std::string AResponse::getIndexFile(const std::string &path) const {
-    std::vector<std::string> indexFiles = _server.getIndex(_locationRoute);
+    std::vector<std::string> indexFiles = _server->getIndex(_locationRoute);
     std::vector<std::string>::const_iterator it;
     for (it = indexFiles.begin(); it != indexFiles.end(); it++) {
         std::string file = getPath(path, *it);
@@ -160,7 +253,7 @@ const std::string AResponse::getIndexFile(const std::string &path) const {
 }
 
 bool AResponse::hasAutoIndex() const {
-    if (_server.getAutoIdx(_locationRoute) == TRUE)
+    if (_server->getAutoIdx(_locationRoute) == TRUE)
         return (true);
     return (false);
 }
@@ -174,10 +267,10 @@ bool AResponse::hasAutoIndex() const {
  */
 short AResponse::checkMethod() const {
     const std::set<Method> allowedMethods =
-        _server.getValidMethods(_locationRoute);
+        _server->getValidMethods(_locationRoute);
     if (allowedMethods.empty())
         return (OK);
-    std::set<Method>::const_iterator it = allowedMethods.find(_request.method);
+    std::set<Method>::const_iterator it = allowedMethods.find(_request->method);
     if (it == allowedMethods.end())
         return (METHOD_NOT_ALLOWED);
     return (OK);
@@ -195,10 +288,9 @@ short AResponse::checkMethod() const {
  * status code indicating that the body size is acceptable.
  */
 short AResponse::checkBodySize() const {
-    std::size_t bodySize = _server
-		.getClientMaxBodySize(_locationRoute);
+    std::size_t bodySize = _server->getClientMaxBodySize(_locationRoute);
 
-    if (_request.body.size() > bodySize)
+    if (_request->body.size > bodySize)
         return (PAYLOAD_TOO_LARGE);
     return (OK);
 }
@@ -249,8 +341,8 @@ short AResponse::checkFile(const std::string &path) const {
  * with a single '/' character between the root and the URI.
  */
 const std::string AResponse::getPath() const {
-    std::string root = _server.getRoot(_locationRoute);
-    return (getPath(root, _request.uri));
+    std::string root = _server->getRoot(_locationRoute);
+    return (getPath(root, _request->uri));
 }
 
 /**
@@ -288,9 +380,10 @@ std::string AResponse::getLastModifiedDate(const std::string &path) const {
     struct stat fileStat;
     if (stat(path.c_str(), &fileStat) != 0)
         return "";
-    struct tm *tm = gmtime(&fileStat.st_mtime);
+    struct tm tm;
+    gmtime_r(&fileStat.st_mtime, &tm);
     char dateBuf[30];
-    std::strftime(dateBuf, sizeof(dateBuf), "%a, %d %b %Y %H:%M:%S GMT", tm);
+    std::strftime(dateBuf, sizeof(dateBuf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
     return (std::string(dateBuf));
 }
 
@@ -373,29 +466,42 @@ static std::map<short, std::string> initStatusMessages() {
 const std::map<short, std::string> STATUS_MESSAGES = initStatusMessages();
 
 /**
- * @brief Constructs the HTTP response string.
- * @return A string representing the complete HTTP response.
+ * @brief Constructs the header block of the HTTP response.
+ * @return The status line and headers, terminated by an empty line.
  *
- * This method constructs and returns the HTTP response string, which
- * includes the status line, headers, and body. The status line is composed
- * of the HTTP version, status code, and status message. Headers are
- * appended in the format "Header-Name: Header-Value", followed by the
- * response body.
+ * The status line is composed of the HTTP version, status code, and status
+ * message. Headers are appended in the format "Header-Name: Header-Value".
+ * The body is not part of it: takeBody() hands it over, so it is sent from
+ * its own buffer instead of being copied after the headers.
  */
-const std::string AResponse::getResponseStr() const {
+const std::string AResponse::getHeaderStr() const {
     std::map<short, std::string>::const_iterator itStat =
-        STATUS_MESSAGES.find(_response.status);
-    std::string msg = (itStat != STATUS_MESSAGES.end()) ? itStat->second : "";
-
-    std::string headerStr;
-    std::multimap<std::string, std::string>::const_iterator itH;
-    for (itH = _response.headers.begin(); itH != _response.headers.end();
-         ++itH) {
-        headerStr += itH->first + ": " + itH->second + "\r\n";
+        STATUS_MESSAGES.find(_response->status);
+
+    std::string headerStr("HTTP/1.1 ");
+    headerStr += number2string<short>(_response->status);
+    headerStr += ' ';
+    if (itStat != STATUS_MESSAGES.end())
+        headerStr += itStat->second;
+    headerStr += "\r\n";
+    for (std::size_t i = 0; i < N_HEADERS; ++i) {
+        if (_response->knownHeaders[i].empty())
+            continue;
+        headerStr += HeaderTable::getName(static_cast<HeaderId>(i));
+        headerStr += ": ";
+        headerStr += _response->knownHeaders[i];
+        headerStr += "\r\n";
     }
-
-    return "HTTP/1.1 " + number2string<short>(_response.status) + " " + msg +
-           "\r\n" + headerStr + "\r\n" + _response.body;
+    std::vector<std::pair<std::string, std::string> >::const_iterator itH;
+    for (itH = _response->otherHeaders.begin();
+         itH != _response->otherHeaders.end(); ++itH) {
+        headerStr += itH->first;
+        headerStr += ": ";
+        headerStr += itH->second;
+        headerStr += "\r\n";
+    }
+    headerStr += "\r\n";
+    return (headerStr);
 }
 
 /**
@@ -544,7 +650,7 @@ std::string AResponse::addFileEntry(std::string &name,
     if (displayName.length() > 51)
         displayName = displayName.substr(0, 48) + "..>";
     if ((name != "./") && (name != "../"))
-        name = getPath(_request.uri, name);
+        name = getPath(_request->uri, name);
     if (isDir(fullPath))
         name += '/';
     std::string blanksL;
@@ -566,7 +672,7 @@ short AResponse::loadDirectoryListing(const std::string &path) {
         return (FORBIDDEN);
 
     std::string dirName = getDirName(path);
-    _response.body = "<!DOCTYPE html>\n<html>\n<head>\n<title>Index of " +
+    _response->body = "<!DOCTYPE html>\n<html>\n<head>\n<title>Index of " +
                      dirName + "</title>\n</head>\n<body>\n<h1>Index of " +
                      dirName + "</h1>\n<hr>\n<pre>";
 
@@ -597,16 +703,16 @@ short AResponse::loadDirectoryListing(const std::string &path) {
     std::vector<std::string>::iterator it;
     for (it = dirs.begin(); it != dirs.end(); it++) {
         std::string entryName = *it;
-        _response.body += addFileEntry(entryName, path);
+        _response->body += addFileEntry(entryName, path);
     }
     for (it = files.begin(); it != files.end(); it++) {
         std::string entryName = *it;
-        _response.body += addFileEntry(entryName, path);
+        _response->body += addFileEntry(entryName, path);
     }
-    _response.body += "</pre>\n<hr></body>\n</html>\n";
+    _response->body += "</pre>\n<hr></body>\n</html>\n";
     closedir(dir);
     loadHeaders();
-    _response.headers.insert(std::make_pair("Content-Type", "text/html"));
+    _response->setHeader(HDR_CONTENT_TYPE, "text/html");
 
     return (OK);
 }
@@ -636,68 +742,72 @@ void AResponse::setMimeType(const std::string &path) {
         std::string ext = path.substr(dotPos + 1);
         std::map<std::string, std::string>::iterator it = mimeTs.find(ext);
         if (it != mimeTs.end()) {
-            _response.headers.insert(
-                std::make_pair("Content-Type", it->second));
+            _response->setHeader(HDR_CONTENT_TYPE, it->second);
             return;
         }
     }
-    _response.headers.insert( // Nginx Defaults
-        std::make_pair("Content-Type", "application/octet-stream"));
+    // Nginx Defaults
+    _response->setHeader(HDR_CONTENT_TYPE, "application/octet-stream");
 }
 
 /**
  * @brief Loads the HTTP headers for the response.
  *
  * This method populates the HTTP headers for the response object. It sets
- * the "Connection" header to "keep-alive", the "Content-Length" header if
- * the response body is not empty, the "Date" header with the current HTTP
- * date, the "Server" header with the server name, and the "Cache-Control"
- * header to "no-cache".
+ * the "Connection" header to "keep-alive" or "close" depending on whether the
+ * connection persists, the "Content-Length" header (also for empty bodies, so
+ * persistent connections stay framed; never for 1xx and 304 responses, which
+ * have no body, RFC 9110 8.6), the "Date" header with the current
+ * HTTP date, the "Server" header with the server name, and the
+ * "Cache-Control" header to "no-cache". Previously set values of these headers
+ * are replaced, so the method can safely run more than once.
  */
 void AResponse::loadHeaders() {
-    _response.headers.insert(std::make_pair("Connection", "keep-alive"));
-    if (_response.body.size() > 0)
-        _response.headers.insert(std::make_pair(
-            "Content-Length",
-            number2string<unsigned long>(_response.body.size())));
-    _response.headers.insert(std::make_pair("Date", getHttpDate()));
-    _response.headers.insert(std::make_pair("Server", SERVER_NAME));
-    _response.headers.insert(std::make_pair("Cache-Control", "no-cache"));
+    _response->setHeader(HDR_CONNECTION, (_keepAlive ? "keep-alive" : "close"));
+    if ((_status < OK) || (_status == NOT_MODIFIED))
+        _response->setHeader(HDR_CONTENT_LENGTH, ""); // Unset
+    else
+        _response->setHeader(
+            HDR_CONTENT_LENGTH,
+            number2string<unsigned long>((_response->fileFd != -1)
+                                             ? _response->fileSize
+                                             : _response->body.size()));
+    _response->setHeader(HDR_DATE, getHttpDate());
+    _response->setHeader(HDR_SERVER, SERVER_NAME);
+    _response->setHeader(HDR_CACHE_CONTROL, "no-cache");
 }
 
 /**
  * @brief Retrieves the error page for a given HTTP status code.
  * @param errStat The HTTP status code for which the error page is
  * retrieved.
- * @return A string representing the complete HTTP response with the error
- * page.
+ * @return The header block of the error response; the page is its body.
  *
  * This method retrieves the error page associated with the specified HTTP
  * status code. It first checks if a custom error page is configured for the
  * status code and attempts to load it. If the custom error page is not
  * found or cannot be loaded, a default error page is generated. The method
- * then loads the necessary HTTP headers and constructs the complete HTTP
- * response string.
+ * then loads the necessary HTTP headers and constructs the header block.
  */
 const std::string AResponse::getErrorPage() {
-    static std::map<short, std::string> errPages =
-        _server.getErrorPages(_locationRoute);
+    std::map<short, std::string> errPages =
+        _server->getErrorPages(_locationRoute);
 
     std::map<short, std::string>::const_iterator it = errPages.find(_status);
     if (it != errPages.end()) {
-        std::string path = getPath(_server.getRoot(), it->second);
+        std::string path = getPath(_server->getRoot(), it->second);
         if (checkFile(path) == OK) {
             std::ifstream file(path.c_str());
-            _response.body.assign(std::istreambuf_iterator<char>(file),
+            _response->body.assign(std::istreambuf_iterator<char>(file),
                                   std::istreambuf_iterator<char>());
         }
     }
     
-    _response.status = _status;
-    if (_response.body.empty())
-        _response.body = loadDefaultErrorPage(_status);
+    _response->status = _status;
+    if (_response->body.empty() && (_status != NOT_MODIFIED)) // 304: no body
+        _response->body = loadDefaultErrorPage(_status);
     loadHeaders();
-    return (getResponseStr());
+    return (getHeaderStr());
 }
 
 /**
@@ -708,34 +818,47 @@ const std::string AResponse::getErrorPage() {
  * for an exact match of the request URI in the server's locations. If no
  * exact match is found, it searches for the longest matching prefix among
  * the available location routes. The location route is then set to the
- * best match found.
+ * best match found. The lookup is Server::getLocationRoute(), which walks
+ * the locations in place instead of copying them.
  */
 void AResponse::setLocationRoute() {
-    std::map<std::string, Location> serverLoci = _server.getLocations();
-
-    std::map<std::string, Location>::iterator it =
-        serverLoci.find(_request.uri);
-    if (it != serverLoci.end()) {
-        _locationRoute = it->first;
-        return;
-    }
-
-    std::size_t bestMatchLen = 0;
-    std::string bestMatchRoute = "";
-    for (it = serverLoci.begin(); it != serverLoci.end(); ++it) {
-        if (_request.uri.compare(0, it->first.size(), it->first) == 0) {
-            std::size_t len = it->first.size();
-            if (len > bestMatchLen) {
-                bestMatchLen = len;
-                bestMatchRoute = it->first;
-            }
-        }
-    }
-    _locationRoute = bestMatchRoute;
+    _locationRoute = _server->getLocationRoute(_request->uri);
 }
 
 short AResponse::getStatus() const {
 	return (_status);
 }
 
+/**
+ * @brief Sets whether the connection is kept open after this response.
+ * @param keepAlive true to advertise `Connection: keep-alive`, false for
+ * `Connection: close`.
+ */
+void AResponse::setKeepAlive(bool keepAlive) {
+	_keepAlive = keepAlive;
+}
+
+/**
+ * @brief Hands the file body over to the caller, who must close it.
+ * @param size Set to the size of the file body.
+ * @return The file descriptor, or -1 if the body is in memory.
+ */
+int AResponse::takeFile(off_t &size) {
+	int fd = _response->fileFd;
+	size = _response->fileSize;
+	_response->fileFd = -1;
+	return (fd);
+}
+
+/**
+ * @brief Hands the in-memory body over to the caller.
+ *
+ * @details The body is swapped, not copied: the response is left without one.
+ *
+ * @param body Receives the body.
+ */
+void AResponse::takeBody(std::string &body) {
+	body.swap(_response->body);
+}
+
 /** @} */
@@ -0,0 +1,522 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ByteScan.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/11 09:12:40 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/11 09:12:40 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup ByteScanModule Byte Scan Module
+ * @{
+ *
+ * Delimiter and byte class searches of the request framing and parser, in
+ * SSE2 and AVX2 with a scalar fallback, dispatched on the CPU at startup.
+ *
+ * Every SIMD scan compares whole blocks and hands the tail (less than a
+ * block, plus the look-ahead of the multi-byte delimiters) to the next
+ * narrower version, so all of them return the same results.
+ *
+ * @version 1.0
+ */
+
+#include "../inc/ByteScan.hpp"
+#include <cstring> // std::memchr()
+#include <string>  // std::string::npos
+
+#if defined(__x86_64__) || defined(__i386__)
+# define BYTESCAN_X86
+# include <emmintrin.h> // SSE2
+# include <immintrin.h> // AVX2
+# define SSE2_FN __attribute__((target("sse2")))
+# define AVX2_FN __attribute__((target("avx2")))
+#endif
+
+static const std::size_t npos = std::string::npos;
+
+/* ************************************************************************** */
+/*                                   Scalar                                   */
+/* ************************************************************************** */
+
+/// @brief Checks for a tchar (RFC 9110, 5.6.2), the bytes of a field name.
+static bool isTokenChar(unsigned char c) {
+    if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+        (c >= 'A' && c <= 'Z'))
+        return (true);
+    return ((c != '\0') && (std::strchr("!#$%&'*+-.^_`|~", c) != NULL));
+}
+
+/// @brief Checks for a control byte other than HTAB, or DEL.
+static bool isCtl(unsigned char c) {
+    return (((c < 0x20) && (c != '\t')) || (c == 0x7f));
+}
+
+static std::size_t findCrlfScalar(const char *buf, std::size_t len) {
+    const char *end = buf + len;
+    const char *p = buf;
+    while ((p = static_cast<const char *>(
+                std::memchr(p, '\r', end - p))) != NULL) {
+        if (((p + 1) < end) && (p[1] == '\n'))
+            return (p - buf);
+        ++p;
+    }
+    return (npos);
+}
+
+static std::size_t findHeaderEndScalar(const char *buf, std::size_t len) {
+    const char *end = buf + len;
+    const char *p = buf;
+    while ((p = static_cast<const char *>(
+                std::memchr(p, '\r', end - p))) != NULL) {
+        if (((p + 3) < end) && (p[1] == '\n') && (p[2] == '\r') &&
+            (p[3] == '\n'))
+            return (p - buf);
+        ++p;
+    }
+    return (npos);
+}
+
+static std::size_t findNonTokenScalar(const char *buf, std::size_t len) {
+    for (std::size_t i = 0; i < len; ++i)
+        if (!isTokenChar(static_cast<unsigned char>(buf[i])))
+            return (i);
+    return (npos);
+}
+
+static std::size_t findCtlScalar(const char *buf, std::size_t len) {
+    for (std::size_t i = 0; i < len; ++i)
+        if (isCtl(static_cast<unsigned char>(buf[i])))
+            return (i);
+    return (npos);
+}
+
+/**
+ * @brief Scans the bytes of a target from an offset, adding to the result.
+ *
+ * @param buf The target.
+ * @param i The offset to start at, the SIMD scans having done the rest.
+ * @param len The length of the target.
+ * @param t The result, accumulated.
+ */
+static void scanTargetTail(const char *buf, std::size_t i, std::size_t len,
+                           ByteScan::Target &t) {
+    for (; (i < len) && !t.hasHash && !t.hasCtl; ++i) {
+        unsigned char c = static_cast<unsigned char>(buf[i]);
+        if (c == '%') {
+            if (t.firstPercent == npos)
+                t.firstPercent = i;
+        } else if (c == '?') {
+            if (t.firstQuestion == npos)
+                t.firstQuestion = i;
+            ++t.nQuestion;
+        } else if (c == '=')
+            ++t.nEqual;
+        else if (c == '&')
+            ++t.nAmp;
+        else if (c == '#')
+            t.hasHash = true;
+        else if ((c <= 0x20) || (c == 0x7f))
+            t.hasCtl = true;
+    }
+}
+
+static void initTarget(ByteScan::Target &t) {
+    t.firstPercent = npos;
+    t.firstQuestion = npos;
+    t.nQuestion = 0;
+    t.nEqual = 0;
+    t.nAmp = 0;
+    t.hasHash = false;
+    t.hasCtl = false;
+}
+
+static void scanTargetScalar(const char *buf, std::size_t len,
+                             ByteScan::Target &t) {
+    initTarget(t);
+    scanTargetTail(buf, 0, len, t);
+}
+
+#ifdef BYTESCAN_X86
+
+/* ************************************************************************** */
+/*                                    SSE2                                    */
+/* ************************************************************************** */
+
+SSE2_FN static inline __m128i load16(const char *p) {
+    return (_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+SSE2_FN static inline __m128i eq16(__m128i v, char c) {
+    return (_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+/// @brief Marks the bytes in [lo, hi] (unsigned): v - lo <= hi - lo.
+SSE2_FN static inline __m128i range16(__m128i v, char lo, char hi) {
+    __m128i off = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return (_mm_cmpeq_epi8(_mm_min_epu8(off, _mm_set1_epi8(hi - lo)), off));
+}
+
+SSE2_FN static std::size_t findCrlfSse2(const char *buf, std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 17) <= len; i += 16) {
+        __m128i m = _mm_and_si128(eq16(load16(buf + i), '\r'),
+                                  eq16(load16(buf + i + 1), '\n'));
+        unsigned mask = _mm_movemask_epi8(m);
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    std::size_t found = findCrlfScalar(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+SSE2_FN static std::size_t findHeaderEndSse2(const char *buf,
+                                             std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 19) <= len; i += 16) {
+        __m128i crlf = _mm_and_si128(eq16(load16(buf + i), '\r'),
+                                     eq16(load16(buf + i + 1), '\n'));
+        unsigned mask = _mm_movemask_epi8(crlf);
+        if (mask == 0)
+            continue; // No line ends here, the usual case
+        __m128i next = _mm_and_si128(eq16(load16(buf + i + 2), '\r'),
+                                     eq16(load16(buf + i + 3), '\n'));
+        mask &= _mm_movemask_epi8(next);
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    std::size_t found = findHeaderEndScalar(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+/// @brief Marks the bytes that are not tchars (delimiters, SP, CTL, 8-bit).
+SSE2_FN static inline __m128i nonToken16(__m128i v) {
+    __m128i m = _mm_xor_si128(range16(v, 0x21, 0x7e), _mm_set1_epi8(-1));
+    m = _mm_or_si128(m, range16(v, ':', '@'));  // :;<=>?@
+    m = _mm_or_si128(m, range16(v, '[', ']'));  // [\]
+    m = _mm_or_si128(m, range16(v, '(', ')'));
+    m = _mm_or_si128(m, _mm_or_si128(eq16(v, '"'), eq16(v, ',')));
+    m = _mm_or_si128(m, _mm_or_si128(eq16(v, '/'), eq16(v, '{')));
+    return (_mm_or_si128(m, eq16(v, '}')));
+}
+
+SSE2_FN static std::size_t findNonTokenSse2(const char *buf,
+                                            std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 16) <= len; i += 16) {
+        unsigned mask = _mm_movemask_epi8(nonToken16(load16(buf + i)));
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    std::size_t found = findNonTokenScalar(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+SSE2_FN static std::size_t findCtlSse2(const char *buf, std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 16) <= len; i += 16) {
+        __m128i v = load16(buf + i);
+        __m128i m = _mm_andnot_si128(eq16(v, '\t'), range16(v, 0x00, 0x1f));
+        m = _mm_or_si128(m, eq16(v, 0x7f));
+        unsigned mask = _mm_movemask_epi8(m);
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    std::size_t found = findCtlScalar(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+SSE2_FN static void scanTargetSse2(const char *buf, std::size_t len,
+                                   ByteScan::Target &t) {
+    initTarget(t);
+    std::size_t i = 0;
+    for (; (i + 16) <= len; i += 16) {
+        __m128i v = load16(buf + i);
+        __m128i bad = _mm_or_si128(eq16(v, '#'), range16(v, 0x00, 0x20));
+        if (_mm_movemask_epi8(_mm_or_si128(bad, eq16(v, 0x7f))) != 0)
+            break; // Rejected anyway: the tail tells which
+        unsigned pct = _mm_movemask_epi8(eq16(v, '%'));
+        unsigned question = _mm_movemask_epi8(eq16(v, '?'));
+        if ((pct != 0) && (t.firstPercent == npos))
+            t.firstPercent = i + __builtin_ctz(pct);
+        if ((question != 0) && (t.firstQuestion == npos))
+            t.firstQuestion = i + __builtin_ctz(question);
+        t.nQuestion += __builtin_popcount(question);
+        t.nEqual += __builtin_popcount(_mm_movemask_epi8(eq16(v, '=')));
+        t.nAmp += __builtin_popcount(_mm_movemask_epi8(eq16(v, '&')));
+    }
+    scanTargetTail(buf, i, len, t);
+}
+
+/* ************************************************************************** */
+/*                                    AVX2                                    */
+/* ************************************************************************** */
+
+AVX2_FN static inline __m256i load32(const char *p) {
+    return (_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+}
+
+AVX2_FN static inline __m256i eq32(__m256i v, char c) {
+    return (_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+AVX2_FN static inline __m256i range32(__m256i v, char lo, char hi) {
+    __m256i off = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return (_mm256_cmpeq_epi8(_mm256_min_epu8(off, _mm256_set1_epi8(hi - lo)),
+                              off));
+}
+
+AVX2_FN static std::size_t findCrlfAvx2(const char *buf, std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 33) <= len; i += 32) {
+        __m256i m = _mm256_and_si256(eq32(load32(buf + i), '\r'),
+                                     eq32(load32(buf + i + 1), '\n'));
+        unsigned mask = _mm256_movemask_epi8(m);
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    _mm256_zeroupper(); // The SSE2 tail would pay for dirty upper lanes
+    std::size_t found = findCrlfSse2(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+AVX2_FN static std::size_t findHeaderEndAvx2(const char *buf,
+                                             std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 35) <= len; i += 32) {
+        __m256i crlf = _mm256_and_si256(eq32(load32(buf + i), '\r'),
+                                        eq32(load32(buf + i + 1), '\n'));
+        unsigned mask = _mm256_movemask_epi8(crlf);
+        if (mask == 0)
+            continue;
+        __m256i next = _mm256_and_si256(eq32(load32(buf + i + 2), '\r'),
+                                        eq32(load32(buf + i + 3), '\n'));
+        mask &= _mm256_movemask_epi8(next);
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    _mm256_zeroupper();
+    std::size_t found = findHeaderEndSse2(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+AVX2_FN static inline __m256i nonToken32(__m256i v) {
+    __m256i m = _mm256_xor_si256(range32(v, 0x21, 0x7e),
+                                 _mm256_set1_epi8(-1));
+    m = _mm256_or_si256(m, range32(v, ':', '@'));
+    m = _mm256_or_si256(m, range32(v, '[', ']'));
+    m = _mm256_or_si256(m, range32(v, '(', ')'));
+    m = _mm256_or_si256(m, _mm256_or_si256(eq32(v, '"'), eq32(v, ',')));
+    m = _mm256_or_si256(m, _mm256_or_si256(eq32(v, '/'), eq32(v, '{')));
+    return (_mm256_or_si256(m, eq32(v, '}')));
+}
+
+AVX2_FN static std::size_t findNonTokenAvx2(const char *buf,
+                                            std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 32) <= len; i += 32) {
+        unsigned mask = _mm256_movemask_epi8(nonToken32(load32(buf + i)));
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    _mm256_zeroupper();
+    std::size_t found = findNonTokenSse2(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+AVX2_FN static std::size_t findCtlAvx2(const char *buf, std::size_t len) {
+    std::size_t i = 0;
+    for (; (i + 32) <= len; i += 32) {
+        __m256i v = load32(buf + i);
+        __m256i m =
+            _mm256_andnot_si256(eq32(v, '\t'), range32(v, 0x00, 0x1f));
+        m = _mm256_or_si256(m, eq32(v, 0x7f));
+        unsigned mask = _mm256_movemask_epi8(m);
+        if (mask != 0)
+            return (i + __builtin_ctz(mask));
+    }
+    _mm256_zeroupper();
+    std::size_t found = findCtlSse2(buf + i, len - i);
+    return ((found == npos) ? npos : (i + found));
+}
+
+AVX2_FN static void scanTargetAvx2(const char *buf, std::size_t len,
+                                   ByteScan::Target &t) {
+    initTarget(t);
+    std::size_t i = 0;
+    for (; (i + 32) <= len; i += 32) {
+        __m256i v = load32(buf + i);
+        __m256i bad = _mm256_or_si256(eq32(v, '#'), range32(v, 0x00, 0x20));
+        if (_mm256_movemask_epi8(_mm256_or_si256(bad, eq32(v, 0x7f))) != 0)
+            break;
+        unsigned pct = _mm256_movemask_epi8(eq32(v, '%'));
+        unsigned question = _mm256_movemask_epi8(eq32(v, '?'));
+        if ((pct != 0) && (t.firstPercent == npos))
+            t.firstPercent = i + __builtin_ctz(pct);
+        if ((question != 0) && (t.firstQuestion == npos))
+            t.firstQuestion = i + __builtin_ctz(question);
+        t.nQuestion += __builtin_popcount(question);
+        t.nEqual += __builtin_popcount(_mm256_movemask_epi8(eq32(v, '=')));
+        t.nAmp += __builtin_popcount(_mm256_movemask_epi8(eq32(v, '&')));
+    }
+    _mm256_zeroupper();
+    scanTargetTail(buf, i, len, t);
+}
+
+#endif // BYTESCAN_X86
+
+/* ************************************************************************** */
+/*                                  Dispatch                                  */
+/* ************************************************************************** */
+
+ByteScan::Level ByteScan::_level = ByteScan::SCALAR;
+ByteScan::Impl ByteScan::_impl = {findCrlfScalar, findHeaderEndScalar,
+                                  findNonTokenScalar, findCtlScalar,
+                                  scanTargetScalar};
+
+/// @brief Selects the widest scans of the CPU before main() runs.
+static struct ByteScanInit {
+    ByteScanInit(void) { ByteScan::setLevel(ByteScan::AVX2); }
+} byteScanInit;
+
+/**
+ * @brief Gets the widest instruction set of the CPU.
+ *
+ * @return AVX2, SSE2, or SCALAR off x86.
+ */
+ByteScan::Level ByteScan::getSupportedLevel(void) {
+#ifdef BYTESCAN_X86
+    __builtin_cpu_init(); // May run before the libgcc constructor
+    if (__builtin_cpu_supports("avx2"))
+        return (AVX2);
+    if (__builtin_cpu_supports("sse2"))
+        return (SSE2);
+#endif
+    return (SCALAR);
+}
+
+/**
+ * @brief Selects the scans to use, up to what the CPU supports.
+ *
+ * @details Called once before main(), with the widest level; a lower one
+ * may be forced afterwards (to compare them, or to rule a level out). Not
+ * thread-safe: call it before the workers start.
+ *
+ * @param level The widest level wanted.
+ */
+void ByteScan::setLevel(Level level) {
+    Level supported = getSupportedLevel();
+    if (level > supported)
+        level = supported;
+    _level = level;
+    switch (level) {
+#ifdef BYTESCAN_X86
+    case AVX2: {
+        Impl impl = {findCrlfAvx2, findHeaderEndAvx2, findNonTokenAvx2,
+                     findCtlAvx2, scanTargetAvx2};
+        _impl = impl;
+        break;
+    }
+    case SSE2: {
+        Impl impl = {findCrlfSse2, findHeaderEndSse2, findNonTokenSse2,
+                     findCtlSse2, scanTargetSse2};
+        _impl = impl;
+        break;
+    }
+#endif
+    default: {
+        Impl impl = {findCrlfScalar, findHeaderEndScalar, findNonTokenScalar,
+                     findCtlScalar, scanTargetScalar};
+        _impl = impl;
+        break;
+    }
+    }
+}
+
+/// @brief Gets the instruction set the scans run on.
+ByteScan::Level ByteScan::getLevel(void) { return (_level); }
+
+/// @brief Gets the printable name of a level.
+const char *ByteScan::level2string(Level level) {
+    switch (level) {
+    case AVX2:
+        return ("AVX2");
+    case SSE2:
+        return ("SSE2");
+    default:
+        return ("scalar");
+    }
+}
+
+/* ************************************************************************** */
+/*                                  Searches                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Finds the first "\r\n".
+ *
+ * @param buf The bytes to search.
+ * @param len The number of bytes.
+ * @return The offset of the '\r', or std::string::npos.
+ */
+std::size_t ByteScan::findCrlf(const char *buf, std::size_t len) {
+    return (_impl.findCrlf(buf, len));
+}
+
+/**
+ * @brief Finds the "\r\n\r\n" that ends a header block.
+ *
+ * @param buf The bytes to search.
+ * @param len The number of bytes.
+ * @return The offset of the first '\r', or std::string::npos.
+ */
+std::size_t ByteScan::findHeaderEnd(const char *buf, std::size_t len) {
+    return (_impl.findHeaderEnd(buf, len));
+}
+
+/**
+ * @brief Finds the first byte that can not be part of a field name.
+ *
+ * @details On a header line, that is the ':' ending a valid name; anything
+ * else (whitespace, a delimiter, a control or 8-bit byte) makes the name
+ * invalid.
+ *
+ * @param buf The bytes to search.
+ * @param len The number of bytes.
+ * @return The offset of the byte, or std::string::npos.
+ */
+std::size_t ByteScan::findNonToken(const char *buf, std::size_t len) {
+    return (_impl.findNonToken(buf, len));
+}
+
+/**
+ * @brief Finds the first control byte (other than HTAB) or DEL.
+ *
+ * @details None may appear in a field value (RFC 9110, 5.5).
+ *
+ * @param buf The bytes to search.
+ * @param len The number of bytes.
+ * @return The offset of the byte, or std::string::npos.
+ */
+std::size_t ByteScan::findCtl(const char *buf, std::size_t len) {
+    return (_impl.findCtl(buf, len));
+}
+
+/**
+ * @brief Finds the delimiters of a request target, in a single pass.
+ *
+ * @details The scan stops at the first '#' or control byte, which make the
+ * target invalid: the counts are then partial.
+ *
+ * @param buf The target, as received.
+ * @param len Its length.
+ * @param target Receives what was found.
+ */
+void ByteScan::scanTarget(const char *buf, std::size_t len, Target &target) {
+    _impl.scanTarget(buf, len, target);
+}
+
+/** @} */
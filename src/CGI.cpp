@@ -31,7 +31,7 @@
  * @param response The HTTP response object.
  * @param path The path to the CGI script.
  */
-CGI::CGI(HttpRequest &request, HttpResponse &response,
+CGI::CGI(const HttpRequest &request, HttpResponse &response,
         const std::string &root, const std::string &path)
     : _request(request), _response(response), _root(root), _path(path), _cgiEnv(NULL) {}
 
@@ -76,20 +76,16 @@ short CGI::generateResponse() {
     }
     
     std::string headers = output.substr(0, pos);
-    std::string body = output.substr(pos + 4);
     std::multimap<std::string, std::string> headerEnv =
         parseCGIheaders(headers);
 
     // Keep existing Headers
     std::multimap<std::string, std::string>::const_iterator it;
-    for (it = headerEnv.begin(); it != headerEnv.end(); ++it) {
-        // Check if header is set
-        std::multimap<std::string, std::string>::iterator resIt =
-            _response.headers.find(it->first);
-        if (resIt == _response.headers.end())
-            _response.headers.insert(*it);
-    }
-    _response.body = body;
+    for (it = headerEnv.begin(); it != headerEnv.end(); ++it)
+        if (!_response.hasHeader(it->first))
+            _response.addHeader(it->first, it->second);
+    _response.body.swap(output);
+    _response.body.erase(0, pos + 4); // Keep the body in place, no copy
     return (OK);
 }
 
@@ -101,6 +97,11 @@ short CGI::generateResponse() {
  * returned as a string. If any errors occur during the setup or execution, an
  * appropriate error message is returned.
  *
+ * The pipes are close-on-exec: with worker threads, a script forked by
+ * another thread at the same time would otherwise keep this one's pipe ends
+ * open, and neither side would see EOF until it exits. The child's stdin
+ * and stdout are dup2() copies, which do not inherit the flag.
+ *
  * @param script The path to the CGI script to be executed.
  * @return A string containing the output from the CGI script, or an error
  * message if the script fails.
@@ -108,8 +109,14 @@ short CGI::generateResponse() {
 std::pair<short, std::string> CGI::execute(const std::string &script) {
     int pipeIn[2], pipeOut[2];
 
-    if (pipe(pipeIn) == -1 || pipe(pipeOut) == -1)
+    // Close-on-exec: the scripts other threads fork must not inherit them
+    if (pipe2(pipeIn, O_CLOEXEC) == -1)
+        return (std::make_pair(INTERNAL_SERVER_ERROR, "Couldn't open pipes"));
+    if (pipe2(pipeOut, O_CLOEXEC) == -1) {
+        close(pipeIn[0]);
+        close(pipeIn[1]);
         return (std::make_pair(INTERNAL_SERVER_ERROR, "Couldn't open pipes"));
+    }
 
     pid_t pid = fork();
     if (pid == -1)
@@ -124,8 +131,8 @@ std::pair<short, std::string> CGI::execute(const std::string &script) {
     close(pipeOut[1]);
     if (!_request.body.empty())
 	{
-        ssize_t retv = write(pipeIn[1], _request.body.c_str(), _request.body.length());
-		if (retv == -1 || (retv == 0 && _request.body.length() > 0))
+        ssize_t retv = write(pipeIn[1], _request.body.data, _request.body.size);
+		if (retv == -1 || (retv == 0 && _request.body.size > 0))
 		{
 			close(pipeIn[1]);
 			close(pipeOut[0]);
@@ -189,8 +196,13 @@ void CGI::runScript(int *pipeIn, int *pipeOut, const std::string &script) {
  * or INTERNAL_SERVER_ERROR if required headers are missing.
  */
 short CGI::setCGIenv() {
+    // A chunked body was decoded by the connection: its length is known now
+    bool chunked = (_request.getHeader(HDR_TRANSFER_ENCODING) != NULL);
+    std::string contentLength = getEnvVal("content-length");
+    if (chunked)
+        contentLength = number2string<std::size_t>(_request.body.size);
     if (((_request.method == POST) && (getEnvVal("content-type").empty())) ||
-        ((_request.method == POST) && (getEnvVal("content-length").empty())))
+        ((_request.method == POST) && contentLength.empty()))
         return (INTERNAL_SERVER_ERROR);
 
     std::vector<std::string> cgiEnv;
@@ -202,10 +214,10 @@ short CGI::setCGIenv() {
     setEnvVar(cgiEnv, "GATEWAY_INTERFACE", "CGI/1.1");
     setEnvVar(cgiEnv, "PATH_INFO", _path.c_str());
     setEnvVar(cgiEnv, "DOCUMENT_ROOT", _root.c_str());
-    setEnvVar(cgiEnv, "CONTENT_LENGTH", getEnvVal("content-length").c_str());
+    setEnvVar(cgiEnv, "CONTENT_LENGTH", contentLength.c_str());
     setEnvVar(cgiEnv, "QUERY_STRING", getQueryFields().c_str());
     setEnvVar(cgiEnv, "SCRIPT_NAME", _request.uri.c_str());
-    setEnvVar(cgiEnv, "SERVER_PROTOCOL", _request.protocolVersion.c_str());
+    setEnvVar(cgiEnv, "SERVER_PROTOCOL", _request.protocolVersion.str());
     setEnvVar(cgiEnv, "SERVER_SOFTWARE", SERVER_NAME);
 
     std::string cookies = getCookies();
@@ -242,61 +254,46 @@ void CGI::setEnvVar(std::vector<std::string> &env, std::string key,
  * "host" header is not present.
  */
 std::string CGI::getServerName() {
-    std::multimap<std::string, std::string>::const_iterator it =
-        _request.headers.find("host");
-    if (it == _request.headers.end())
+    const StrView *host = _request.getHeader(HDR_HOST);
+    if (host == NULL)
         return ("");
 
-    std::string hostname = it->second;
-    std::size_t colonPos = hostname.find_first_of(':');
-    if (colonPos != std::string::npos)
-        hostname = hostname.substr(0, colonPos);
-
-    return (hostname);
+    return (host->substr(0, host->find(':')).str());
 }
 
 /**
- * @brief Retrieve the server port from the request headers.
+ * @brief Retrieve the port the request was received on.
  *
- * This function extracts the server port from the "host" header in the
- * request. If the header does not contain a port number, an empty string
- * is returned.
+ * This function returns the port of the listening socket, as RFC 3875
+ * defines SERVER_PORT. A unix domain socket has no port: the port of the
+ * "host" header is used instead, or the default HTTP port if it has none.
  *
- * @return A string containing the server port, or an empty string if the
- * "host" header is not present or does not include a port number.
+ * @return A string containing the server port.
  */
 std::string CGI::getServerPort() {
-    std::multimap<std::string, std::string>::const_iterator it =
-        _request.headers.find("host");
-    if (it == _request.headers.end())
-        return ("");
-
-    std::string port = it->second;
-    std::size_t colonPos = port.find_first_of(':');
-    if (colonPos != std::string::npos)
-        port = port.substr(colonPos + 1);
-    return (port);
+    if (!_request.serverPort.empty())
+        return (_request.serverPort);
+
+    const StrView *host = _request.getHeader(HDR_HOST);
+    if (host == NULL)
+        return ("80");
+
+    std::size_t colonPos = host->rfind(':');
+    if ((colonPos == std::string::npos) ||
+        (host->find(']', colonPos) != std::string::npos)) // [IPv6] alone
+        return ("80");
+    return (host->substr(colonPos + 1).str());
 }
 
 /**
- * @brief Construct a query string from the request's query parameters.
+ * @brief Get the query string of the request.
  *
- * This function iterates over the query parameters in the request and
- * constructs a query string in the format "key1=value1&key2=value2".
+ * RFC 3875 passes the query as received, still URL-encoded: the script
+ * decodes its fields itself.
  *
- * @return A string containing the constructed query string.
+ * @return A string containing the query string.
  */
-std::string CGI::getQueryFields() {
-    std::string queryStr;
-    std::multimap<std::string, std::string>::const_iterator it;
-    for (it = _request.queryParams.begin(); it != _request.queryParams.end();
-         ++it) {
-        if (!queryStr.empty())
-            queryStr += "&";
-        queryStr += it->first + "=" + it->second;
-    }
-    return (queryStr);
-}
+std::string CGI::getQueryFields() { return (_request.query.str()); }
 
 /**
  * @brief Retrieve cookies from the request headers.
@@ -308,13 +305,16 @@ std::string CGI::getQueryFields() {
  * if no "cookie" headers are present.
  */
 std::string CGI::getCookies() {
-    std::string cookies;
-    std::multimap<std::string, std::string>::const_iterator it;
-    for (it = _request.headers.begin(); it != _request.headers.end(); ++it) {
-        if (it->first == "cookie") {
-            if (!cookies.empty())
-                cookies += "; ";
-            cookies += it->second;
+    const StrView *cookie = _request.getHeader(HDR_COOKIE);
+    if (cookie == NULL)
+        return ("");
+    std::string cookies = cookie->str();
+    std::vector<HeaderField>::const_iterator it;
+    for (it = _request.otherHeaders.begin(); it != _request.otherHeaders.end();
+         ++it) {
+        if (it->id == HDR_COOKIE) {
+            cookies += "; ";
+            cookies.append(it->value.data, it->value.size);
         }
     }
     return (cookies);
@@ -401,23 +401,30 @@ std::pair<short, std::string> CGI::getOutput(pid_t pid, int *pipeOut) {
  * empty string if the key is not found.
  */
 std::string CGI::getEnvVal(std::string key) {
-    std::pair<std::multimap<std::string, std::string>::const_iterator,
-              std::multimap<std::string, std::string>::const_iterator>
-        range = _request.headers.equal_range(key);
-    if (hasSingleValue(key)) {
-        if (range.first != range.second)
-            return (range.first->second);
-    } else {
-        std::string val;
-        std::multimap<std::string, std::string>::const_iterator it;
-        for (it = range.first; it != range.second; ++it) {
-            if (!val.empty())
-                val += ", ";
-            val += it->second;
-        }
+    const StrView *value = _request.getHeader(key.c_str());
+    if (value == NULL)
+        return ("");
+    std::string val = value->str();
+    if (hasSingleValue(key))
         return (val);
+
+    // Repeated fields: the first is in its slot, or first among the others
+    HeaderId id = HeaderTable::lookup(key.c_str());
+    bool skip = (id == HDR_OTHER);
+    std::vector<HeaderField>::const_iterator it;
+    for (it = _request.otherHeaders.begin(); it != _request.otherHeaders.end();
+         ++it) {
+        if ((it->id != id) || ((id == HDR_OTHER) &&
+                               !it->name.iequals(key.c_str())))
+            continue;
+        if (skip) {
+            skip = false;
+            continue;
+        }
+        val += ", ";
+        val.append(it->value.data, it->value.size);
     }
-    return ("");
+    return (val);
 }
 
 /**
@@ -432,20 +439,16 @@ std::string CGI::getEnvVal(std::string key) {
  * can have multiple values.
  */
 bool CGI::hasSingleValue(std::string &key) {
-    // Static list of headers that are not single-value
-    static std::vector<std::string> headers = std::vector<std::string>(6, "");
-    headers.push_back("Accept");
-    headers.push_back("Accept-Encoding");
-    headers.push_back("Cache-Control");
-    headers.push_back("Set-Cookie");
-    headers.push_back("Via");
-    headers.push_back("Forewarded");
-
-    // static const std::vector<std::string> headers = {
-    //     "Accept", "Accept-Encoding", "Cache-Control", "Set-Cookie",
-    //     "Via",    "Forewarded"};
-    // Use std::find to check if the key exists in the list
-    return (std::find(headers.begin(), headers.end(), key) == headers.end());
+    // Headers that are not single-value (read-only, shared by all workers)
+    static const char *headers[] = {"Accept",     "Accept-Encoding",
+                                    "Cache-Control", "Set-Cookie",
+                                    "Via",        "Forewarded"};
+    static const std::size_t nHeaders = sizeof(headers) / sizeof(headers[0]);
+
+    for (std::size_t i = 0; i < nHeaders; ++i)
+        if (key == headers[i])
+            return (false);
+    return (true);
 }
 
 /* ************************************************************************** */
@@ -21,17 +21,78 @@
 /* ************************************************************************** */
 
 #include "../inc/Cluster.hpp"
-#include "../inc/DeleteResponse.hpp"
-#include "../inc/ErrorResponse.hpp"
-#include "../inc/GetResponse.hpp"
-#include "../inc/PostResponse.hpp"
+#include "../inc/ByteScan.hpp"
 #include "../inc/Utils.hpp"
 
 /**
  * @brief Global variable to track the total size of files stored on the server.
  */
 std::size_t storageSize = 0;
-bool isRunning = true;
+volatile sig_atomic_t isRunning = true;
+
+/**
+ * @brief Unix domain sockets bound by the clusters of this process, by path.
+ *
+ * Filled by setUnixSocket() while the worker threads are set up, one after
+ * the other, so that they share each socket.
+ */
+std::map<std::string, int> Cluster::_unixListeners;
+
+/**
+ * @brief Renders the 503 response sent to clients shed by max_connections.
+ *
+ * @details Rendered once per Cluster: shedding must cost no more than a
+ * send(). Being a 5xx, it may omit the Date header (RFC 9110, 6.6.1).
+ *
+ * @return The complete HTTP response.
+ */
+static std::string renderShedResponse(void) {
+    std::string body = "<!DOCTYPE html>\n"
+                       "<html>\n"
+                       "<head><title>503 Service Unavailable</title></head>\n"
+                       "<body>\n"
+                       "\t<h1>503 Service Unavailable</h1>\n"
+                       "<hr>\n"
+                       "\t<p>" SERVER_NAME "</p>\n"
+                       "</body>\n"
+                       "</html>\n";
+    std::stringstream ss;
+    ss << "HTTP/1.1 503 Service Unavailable\r\n"
+       << "Server: " SERVER_NAME "\r\n"
+       << "Content-Type: text/html\r\n"
+       << "Content-Length: " << body.size() << "\r\n"
+       << "Retry-After: " << SHED_RETRY_AFTER << "\r\n"
+       << "Connection: close\r\n"
+       << "\r\n"
+       << body;
+    return (ss.str());
+}
+
+/**
+ * @brief Operations tagged in the user_data of io_uring requests.
+ */
+enum UringOp {
+    URING_IGNORE,  // Cancellations and file updates
+    URING_WAKE,    // Poll of the eventfd written by stop()
+    URING_ACCEPT,  // Multishot accept of a listener
+    URING_RECV,    // Multishot recv of a client
+    URING_SEND,    // Gathered send of a client's output queue
+    URING_SENDFILE // Poll for POLLOUT before a sendfile() slice
+};
+
+#define URING_GEN_MASK 0xffffffU
+
+/**
+ * @brief Packs an operation, a slot generation and a slot index.
+ *
+ * @details The generation lets completions of a closed connection be told
+ * apart from those of the next client using the same slot.
+ */
+static uint64_t uringData(UringOp op, uint32_t gen, std::size_t idx) {
+    return ((static_cast<uint64_t>(op) << 56) |
+            (static_cast<uint64_t>(gen & URING_GEN_MASK) << 32) |
+            static_cast<uint64_t>(idx & 0xffffffffU));
+}
 
 /* ************************************************************************** */
 /*                          Constructor & Destructor                          */
@@ -45,9 +106,12 @@ bool isRunning = true;
  * each network address and server name combination.
  *
  * @param servers A vector of Server objects to be managed by the cluster.
+ * @param global The main context directives (worker_threads, ...).
  */
-Cluster::Cluster(const std::vector<Server> &servers)
-    : _servers(), _epollFd(-1) {
+Cluster::Cluster(const std::vector<Server> &servers, const GlobalConf &global)
+    : _servers(), _pid(getpid()), _global(global), _epollFd(-1), _wakeFd(-1),
+      _listenEvents(EPOLLIN), _shedResponse(renderShedResponse()) {
+    setMethodHandlers();
     _servers.reserve(servers.size());
     std::vector<Server>::const_iterator serverIt;
     for (serverIt = servers.begin(); serverIt != servers.end(); ++serverIt) {
@@ -61,6 +125,7 @@ Cluster::Cluster(const std::vector<Server> &servers)
                 struct VirtualServer vs;
                 vs.ip = sockIt->ip;
                 vs.port = sockIt->port;
+                vs.options = sockIt->options;
                 vs.name = "";
                 vs.server = &(*serverIt);
                 _virtualServers.push_back(vs);
@@ -70,6 +135,7 @@ Cluster::Cluster(const std::vector<Server> &servers)
                     struct VirtualServer vs;
                     vs.ip = sockIt->ip;
                     vs.port = sockIt->port;
+                    vs.options = sockIt->options;
                     vs.name = *nameIt;
                     vs.server = &(*serverIt);
                     _virtualServers.push_back(vs);
@@ -88,10 +154,23 @@ Cluster::~Cluster() {
     // Close epoll instance
     if (_epollFd != -1)
         close(_epollFd);
+    // Close wake-up eventfd
+    if (_wakeFd != -1)
+        close(_wakeFd);
+    // Close client connections
+    std::vector<Connection>::const_iterator connIt;
+    for (connIt = _connections.begin(); connIt != _connections.end(); ++connIt)
+        if (connIt->type == Connection::CLIENT)
+            close(connIt->fd);
     // Close listening sockets
     std::vector<int>::iterator it;
     for (it = _listenSockets.begin(); it != _listenSockets.end(); ++it)
         close(*it);
+    // Remove the unix socket files, unless this is a forked worker's copy
+    std::vector<std::string>::const_iterator pathIt;
+    if (getpid() == _pid)
+        for (pathIt = _unixPaths.begin(); pathIt != _unixPaths.end(); ++pathIt)
+            unlink(pathIt->c_str());
 }
 
 /* ************************************************************************** */
@@ -181,27 +260,98 @@ bool Cluster::hasDuplicates(void) const {
  * @brief Sets up the cluster's listening sockets and epoll instance.
  *
  * @details Initializes the epoll instance and configures all virtual server
- * sockets for listening.
+ * sockets for listening. When several worker threads are configured, every
+ * worker calls setup() on its own Cluster: each one gets a private epoll
+ * instance and its own SO_REUSEPORT copy of every listening socket, so the
+ * kernel load-balances new connections between workers.
  */
 void Cluster::setup(void) {
 #ifdef DEBUG
     Logger::debug("Cluster", __func__, "Starting Cluster Setup");
 #endif
 
-    setEpollFd(); // Create epoll instance
+    setupListeners();
+    setupEventLoop();
+
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__, "Cluster Setup Done");
+#endif
+}
+
+/**
+ * @brief Creates, binds and starts listening on every virtual server socket.
+ *
+ * @details In worker_processes mode the master calls this once, before
+ * forking, so that all workers inherit the same listening sockets.
+ */
+void Cluster::setupListeners(void) {
     std::set<Socket> sockets = getVirtualServerSockets();
     std::set<Socket>::const_iterator it; // To iterate through sockets
 
     for ((it = sockets.begin()); (it != sockets.end()); ++it) {
-        Socket addr(it->ip, it->port);
-        int fd = setSocket(it->ip, it->port);
-        startListen(fd);
-        setEpollSocket(fd);
+        int fd = setSocket(*it);
+        startListen(fd, it->options.backlog);
     }
+}
 
-#ifdef DEBUG
-    Logger::debug("Cluster", __func__, "Cluster Setup Done");
-#endif
+/**
+ * @brief Creates the epoll instance and registers the listening sockets.
+ *
+ * @details Listening sockets shared between worker processes are registered
+ * with EPOLLEXCLUSIVE, so a new connection wakes up a single worker instead
+ * of all of them (thundering herd). With `use io_uring;` an io_uring instance
+ * replaces epoll, unless the kernel does not support it.
+ *
+ * @throw std::runtime_error if worker_connections can not hold the listening
+ * sockets.
+ */
+void Cluster::setupEventLoop(void) {
+    setWakeFd(); // Lets stop() interrupt the event loop from any thread
+    setConnectionTable();
+
+    _hostTables.assign(_listenSockets.size(), HostTable());
+    for (std::size_t i = 0; i < _listenSockets.size(); ++i) {
+        Connection *listener = allocConnection(_listenSockets[i]);
+        if (listener == NULL)
+            throw std::runtime_error("worker_connections is too small for the "
+                                     "listening sockets");
+        listener->type = Connection::LISTENER;
+        listener->fd = _listenSockets[i];
+        listener->localAddr = getSocketAddress(_listenSockets[i]);
+        listener->localAddr.options = _listenOptions[i];
+        setHostTable(_hostTables[i], listener->localAddr);
+        listener->hosts = &_hostTables[i];
+    }
+
+    std::vector<int>::const_iterator it;
+    if (_global.getUseIoUring() && setupRing())
+        return;
+
+    setEpollFd(); // Create epoll instance
+    setEpollSocket(_wakeFd, EPOLLIN);
+    _listenEvents = EPOLLIN;
+    if (_global.getWorkerProcesses() > 1)
+        _listenEvents |= EPOLLEXCLUSIVE;
+    for (it = _listenSockets.begin(); it != _listenSockets.end(); ++it)
+        setEpollSocket(*it, _listenEvents);
+}
+
+/**
+ * @brief Preallocates the connection slots of the event loop.
+ *
+ * @details worker_connections slots are allocated once, so accepting a
+ * client never allocates a Connection and the slots stay contiguous in
+ * memory. The fd table maps each descriptor to its slot, making every event
+ * dispatch a single index lookup.
+ */
+void Cluster::setConnectionTable(void) {
+    std::size_t nSlots = _global.getWorkerConnections();
+    _connections.assign(nSlots, Connection());
+    _fdTable.assign(nSlots, NULL);
+    _freeSlots.clear();
+    _freeSlots.reserve(nSlots);
+    for (std::size_t i = nSlots; i > 0; --i) // Lowest slots are used first
+        _freeSlots.push_back(&_connections[i - 1]);
 }
 
 /**
@@ -214,7 +364,7 @@ void Cluster::setEpollFd(void) {
     Logger::debug("Cluster", __func__, "creating epoll instance");
 #endif
 
-    _epollFd = epoll_create(1);
+    _epollFd = epoll_create1(EPOLL_CLOEXEC); // Not inherited by CGI scripts
     if (_epollFd == -1)
         throw std::runtime_error("Failed to create epoll instance");
 
@@ -225,10 +375,31 @@ void Cluster::setEpollFd(void) {
 #endif
 }
 
+/**
+ * @brief Creates the eventfd used to wake up the event loop on stop().
+ *
+ * @details A signal is delivered to a single thread, so the other workers
+ * would stay blocked in epoll_wait. Writing to this eventfd makes it readable
+ * and wakes up the worker that owns it. It is watched by setupEventLoop().
+ *
+ * @throw std::runtime_error if the eventfd cannot be created.
+ */
+void Cluster::setWakeFd(void) {
+    _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_wakeFd == -1) {
+        std::string reason = std::strerror(errno);
+        throw std::runtime_error("Failed to create eventfd: " + reason);
+    }
+}
+
 /**
  * @brief Retrieves the set of sockets for all virtual servers.
  *
+ * @details Virtual servers sharing an address share its socket, so only one
+ * of their listen directives may set TCP parameters.
+ *
  * @return std::set<Socket> A set of sockets representing the virtual servers.
+ * @throw std::runtime_error if an address is given parameters more than once.
  */
 std::set<Socket> Cluster::getVirtualServerSockets(void) {
     std::vector<VirtualServer> virtualServers = getVirtualServers();
@@ -247,10 +418,23 @@ std::set<Socket> Cluster::getVirtualServerSockets(void) {
             ++vsIt2;
 
     std::set<Socket> serversInterestList;
+    std::map<Socket, const Server *> optionsOwner; // Server that set them
     std::vector<VirtualServer>::const_iterator vsIt3;
     for (vsIt3 = virtualServers.begin(); vsIt3 != virtualServers.end();
          ++vsIt3) {
         Socket addr(vsIt3->ip, vsIt3->port);
+        addr.options = vsIt3->options;
+        if (addr.options.isSet) {
+            std::map<Socket, const Server *>::iterator owner =
+                optionsOwner.find(addr);
+            if (owner == optionsOwner.end())
+                optionsOwner[addr] = vsIt3->server;
+            else if (owner->second != vsIt3->server)
+                throw std::runtime_error("Duplicate listen parameters for " +
+                                         addr.ip + ":" + addr.port);
+            serversInterestList.erase(addr); // Replaces a bare listen
+        } else if (serversInterestList.count(addr) > 0)
+            continue; // Keep the parameters another server may have set
         serversInterestList.insert(addr);
     }
     return (serversInterestList);
@@ -259,27 +443,60 @@ std::set<Socket> Cluster::getVirtualServerSockets(void) {
 /**
  * @brief Configures a socket for a given IP and port.
  *
- * @param ip The IP address for the socket.
- * @param port The port for the socket.
+ * @details The buffer sizes are set before listen(), so the window scale
+ * negotiated during the handshake covers them; accepted sockets inherit
+ * them. TCP_DEFER_ACCEPT only reports a connection once the request starts
+ * arriving, and TCP_FASTOPEN lets a returning client send it in the SYN.
+ *
+ * @param listenAddr The address and listen parameters of the socket.
  * @return int The file descriptor of the configured socket.
  * @throw std::runtime_error if the socket cannot be created or bound.
  */
-int Cluster::setSocket(const std::string &ip, const std::string &port) {
+int Cluster::setSocket(const Socket &listenAddr) {
+    if (listenAddr.isUnix())
+        return (setUnixSocket(listenAddr));
+
+    const std::string &ip = listenAddr.ip;
+    const std::string &port = listenAddr.port;
+    const ListenOptions &options = listenAddr.options;
 #ifdef DEBUG
     Logger::debug("Cluster", __func__,
                   "setting up socket: " YEL + ip + ":" + port + NC);
 #endif
 
-    // Setup Socket
-    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    // Setup Socket (non-blocking: acceptConnections() drains until EAGAIN)
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (fd == -1)
         throw std::runtime_error("Failed to create socket");
     _listenSockets.push_back(fd);
+    _listenOptions.push_back(options);
 
     // Set socket options
     int optval = 1;
     if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) == -1)
         throw std::runtime_error("Failed to set socket options");
+    // Each worker thread binds its own copy of the socket
+    if ((_global.getWorkerThreads() > 1) &&
+        (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) ==
+         -1))
+        throw std::runtime_error("Failed to set SO_REUSEPORT");
+    // listen parameters
+    if ((options.rcvBuf > 0) &&
+        (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options.rcvBuf,
+                    sizeof(options.rcvBuf)) == -1))
+        throw std::runtime_error("Failed to set SO_RCVBUF");
+    if ((options.sndBuf > 0) &&
+        (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &options.sndBuf,
+                    sizeof(options.sndBuf)) == -1))
+        throw std::runtime_error("Failed to set SO_SNDBUF");
+    if (options.deferred &&
+        (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &optval,
+                    sizeof(optval)) == -1))
+        throw std::runtime_error("Failed to set TCP_DEFER_ACCEPT");
+    if ((options.fastOpen > 0) &&
+        (setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &options.fastOpen,
+                    sizeof(options.fastOpen)) == -1))
+        throw std::runtime_error("Failed to set TCP_FASTOPEN");
 
     // Setup socket configuration
     struct sockaddr_in addr;
@@ -311,14 +528,102 @@ int Cluster::setSocket(const std::string &ip, const std::string &port) {
     return (fd);
 }
 
+/**
+ * @brief Checks whether a unix socket file is left over from a dead server.
+ *
+ * @param addr The address of the socket file.
+ * @return true only if connecting is refused: nothing listens on it.
+ */
+static bool isStaleUnixSocket(const struct sockaddr_un &addr) {
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe == -1)
+        return (false);
+    bool isStale = ((connect(probe,
+                             reinterpret_cast<const struct sockaddr *>(&addr),
+                             sizeof(addr)) == -1) &&
+                    (errno == ECONNREFUSED));
+    close(probe);
+    return (isStale);
+}
+
+/**
+ * @brief Configures a unix domain socket bound to a path.
+ *
+ * @details Local frontends skip the TCP stack altogether. A socket file
+ * left behind by a previous run (nothing accepts on it anymore) is removed
+ * before binding, and the file is removed again when the cluster that bound
+ * it is destroyed. One still served by another process is kept: binding
+ * then fails with "address in use", as a busy port does. Worker threads
+ * share the socket of the first one: unlike a port with SO_REUSEPORT, a
+ * path can only be bound once.
+ *
+ * @param listenAddr The path (in port) and listen parameters of the socket.
+ * @return int The file descriptor of the configured socket.
+ * @throw std::runtime_error if the socket cannot be created or bound.
+ */
+int Cluster::setUnixSocket(const Socket &listenAddr) {
+    const std::string &path = listenAddr.port;
+    const ListenOptions &options = listenAddr.options;
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__,
+                  "setting up socket: " YEL UNIX_SOCKET_PREFIX + path + NC);
+#endif
+
+    std::map<std::string, int>::const_iterator bound =
+        _unixListeners.find(path);
+    if (bound != _unixListeners.end()) { // Bound by another worker thread
+        int fd = fcntl(bound->second, F_DUPFD_CLOEXEC, 0);
+        if (fd == -1)
+            throw std::runtime_error("Failed to share unix socket " + path);
+        _listenSockets.push_back(fd);
+        _listenOptions.push_back(options);
+        return (fd);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        throw std::runtime_error("Failed to create socket");
+    _listenSockets.push_back(fd);
+    _listenOptions.push_back(options);
+
+    if ((options.rcvBuf > 0) &&
+        (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options.rcvBuf,
+                    sizeof(options.rcvBuf)) == -1))
+        throw std::runtime_error("Failed to set SO_RCVBUF");
+    if ((options.sndBuf > 0) &&
+        (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &options.sndBuf,
+                    sizeof(options.sndBuf)) == -1))
+        throw std::runtime_error("Failed to set SO_SNDBUF");
+
+    struct sockaddr_un addr;
+    std::memset(&addr, '\0', sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    path.copy(addr.sun_path, sizeof(addr.sun_path) - 1); // Checked by Server
+
+    struct stat st;
+    if ((lstat(path.c_str(), &st) == 0) && S_ISSOCK(st.st_mode) &&
+        isStaleUnixSocket(addr))
+        unlink(path.c_str()); // Left behind by a previous run
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) ==
+        -1) {
+        std::string reason = std::strerror(errno);
+        throw std::runtime_error("Failed to bind socket to " + path + ": " +
+                                 reason);
+    }
+    _unixPaths.push_back(path);
+    _unixListeners[path] = fd;
+    return (fd);
+}
+
 /**
  * @brief Begins listening on a specified socket.
  *
  * @param socket The socket file descriptor to listen on.
+ * @param backlog The length of the accept queue (listen backlog=).
  * @throw std::runtime_error if the socket cannot be listened on.
  */
-void Cluster::startListen(int socket) {
-    if (listen(socket, SOMAXCONN) == -1) {
+void Cluster::startListen(int socket, int backlog) {
+    if (listen(socket, backlog) == -1) {
         close(socket);
         throw std::runtime_error("Failed to listen on socket");
     }
@@ -328,10 +633,11 @@ void Cluster::startListen(int socket) {
  * @brief Adds a socket to the epoll instance for monitoring.
  *
  * @param socket The socket file descriptor to add.
+ * @param events The epoll events to monitor.
  * @throw std::runtime_error if the socket cannot be added to the epoll
  * instance.
  */
-void Cluster::setEpollSocket(int socket) {
+void Cluster::setEpollSocket(int socket, uint32_t events) {
 #ifdef DEBUG
     Logger::debug("Cluster", __func__,
                   "adding socket (epoll_event) to epoll instance");
@@ -339,7 +645,7 @@ void Cluster::setEpollSocket(int socket) {
 
     epoll_event ee;
     std::memset(&ee, '\0', sizeof(ee));
-    ee.events = EPOLLIN;
+    ee.events = events;
     ee.data.fd = socket;
 
     if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, socket, &ee) == -1) {
@@ -368,11 +674,21 @@ void Cluster::run(void) {
 #ifdef DEBUG
     Logger::debug("Cluster", __func__, "Started running cluster");
 #endif
+    if (_ring.isOpen()) {
+        runRing();
+        return;
+    }
 
-    std::vector<struct epoll_event> events(MAX_CLIENTS);
+    // No more events than sockets to report: the slots and the eventfd
+    std::size_t batch = std::min(_global.getEpollBatch(),
+                                 _connections.size() + 1);
+    std::vector<struct epoll_event> events(batch);
     while (isRunning) {
         try {
-            int nEvents = epoll_wait(_epollFd, &events[0], MAX_CLIENTS, -1);
+            // Block until an event or the nearest connection deadline
+            int nEvents =
+                epoll_wait(_epollFd, &events[0], static_cast<int>(batch),
+                           _timers.getNextTimeout());
             if ((nEvents == -1) && (errno == EINTR)) // Loop exit condition
                 continue;
             else if (nEvents == -1) {
@@ -382,15 +698,21 @@ void Cluster::run(void) {
 
             for (long i = 0; i < nEvents; ++i) {
                 int socket = events[i].data.fd;
-                if (events[i].events & EPOLLERR) {
-                    killConnection(socket, _epollFd);
+                if (socket == _wakeFd) // Woken up by stop()
                     continue;
-                }
-                if (isSocketListening(socket))
-                    setupConnection(socket);
+                Connection *conn = getConnection(socket);
+                if (conn == NULL) // Closed earlier in this batch
+                    continue;
+                if (conn->type == Connection::LISTENER)
+                    acceptConnections(*conn);
+                else if (events[i].events & EPOLLOUT)
+                    handleWrite(*conn);
                 else if (events[i].events & EPOLLIN)
-                    handleRequest(socket);
+                    handleRequest(*conn);
+                else if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    killConnection(socket, _epollFd);
             }
+            handleTimeouts();
         } catch (const std::exception &e) {
             Logger::error(e.what());
         }
@@ -404,53 +726,165 @@ void Cluster::run(void) {
 /**
  * @brief Stops the cluster's main event loop.
  *
- * @details Sets the running flag to false, signaling the loop to exit.
+ * @details Sets the running flag to false and wakes up the worker blocked in
+ * epoll_wait. Only async-signal-safe calls are made, as this runs from the
+ * SIGINT handler.
  */
 void Cluster::stop(void) {
-    Logger::warn("Stop triggered. Webserv will stop in moments...");
     isRunning = false;
+    if (_wakeFd == -1)
+        return;
+    uint64_t one = 1;
+    ssize_t ret = write(_wakeFd, &one, sizeof(one));
+    (void)ret;
+}
+
+/**
+ * @brief Returns the slot of a socket.
+ *
+ * @param socket The socket file descriptor.
+ * @return The listener or client slot, or NULL if the fd has none.
+ */
+Connection *Cluster::getConnection(int socket) {
+    if ((socket < 0) || (static_cast<std::size_t>(socket) >= _fdTable.size()))
+        return (NULL);
+    return (_fdTable[socket]);
+}
+
+/**
+ * @brief Takes a free slot for a socket.
+ *
+ * @details The fd table grows when the process hands out descriptors above
+ * its current size (other threads, CGI pipes, ...): it only holds pointers,
+ * the slots themselves never move.
+ *
+ * @param socket The socket file descriptor.
+ * @return The slot, or NULL if all worker_connections are in use.
+ */
+Connection *Cluster::allocConnection(int socket) {
+    if (_freeSlots.empty())
+        return (NULL);
+    if (static_cast<std::size_t>(socket) >= _fdTable.size())
+        _fdTable.resize(std::max(_fdTable.size() * 2,
+                                 static_cast<std::size_t>(socket) + 1),
+                        NULL);
+    Connection *slot = _freeSlots.back();
+    _freeSlots.pop_back();
+    _fdTable[socket] = slot;
+    return (slot);
+}
+
+/**
+ * @brief Gives a client slot back to the free list.
+ *
+ * @param conn The slot to release.
+ */
+void Cluster::releaseConnection(Connection &conn) {
+    uncountHeaderConn(conn);
+    if (conn.admitted != NULL) { // Uncount it from max_connections
+        conn.admitted->getConnectionLimit().release();
+        _global.getConnectionLimit().release();
+    }
+    _fdTable[conn.fd] = NULL;
+    conn.release();
+    _freeSlots.push_back(&conn);
 }
 
 /**
- * @brief Checks if a socket is currently listening.
+ * @brief Accepts the pending connections of a listening socket.
+ *
+ * @details Drains the backlog with accept4() until EAGAIN, up to the
+ * multi_accept cap, so a burst of clients is handled in one wakeup. Client
+ * sockets are created non-blocking and close-on-exec, so CGI children do not
+ * inherit them. When the process runs out of file descriptors, or the event
+ * loop out of connection slots, accepting is paused for ACCEPT_PAUSE_MS
+ * instead of spinning on a listener that stays readable.
  *
- * @param socket The socket file descriptor to check.
- * @return true if the socket is listening, false otherwise.
+ * @param listener The slot of the listening socket.
+ * @throw std::runtime_error if accept4() fails for another reason.
  */
-bool Cluster::isSocketListening(int socket) const {
-    return (std::find(_listenSockets.begin(), _listenSockets.end(), socket) !=
-            _listenSockets.end());
+void Cluster::acceptConnections(const Connection &listener) {
+    std::size_t cap = _global.getMultiAccept();
+    for (std::size_t nAccepted = 0; (cap == 0) || (nAccepted < cap);) {
+        if (_freeSlots.empty()) {
+            pauseAccepts("worker_connections are not enough");
+            return;
+        }
+        struct sockaddr_storage peer;
+        socklen_t peerLen = sizeof(peer);
+        int clientFd =
+            accept4(listener.fd, reinterpret_cast<struct sockaddr *>(&peer),
+                    &peerLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd == -1) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return; // Backlog drained
+            if ((errno == EINTR) || (errno == ECONNABORTED) ||
+                (errno == EPROTO))
+                continue; // Retry, the client is already gone
+            if ((errno == EMFILE) || (errno == ENFILE) ||
+                (errno == ENOBUFS) || (errno == ENOMEM)) {
+                pauseAccepts(std::strerror(errno));
+                return;
+            }
+            std::string reason = std::strerror(errno);
+            throw std::runtime_error("Failed to accept connection: " + reason);
+        }
+        setupConnection(listener, clientFd, &peer);
+        ++nAccepted;
+    }
 }
 
 /**
- * @brief Sets up a new client connection on a listening socket.
+ * @brief Sets up a newly accepted client connection.
  *
- * @param socket The listening socket file descriptor.
- * @throw std::runtime_error if the connection cannot be established.
+ * @details The client socket is registered edge-triggered for EPOLLIN only.
+ * EPOLLOUT (level-triggered, as a file body is sent one slice per wakeup) is
+ * armed by flushConnection() only while a response is pending, so
+ * idle persistent connections never wake the loop. With io_uring a multishot
+ * recv is armed instead.
+ *
+ * @param listener The slot of the listening socket the client came from.
+ * @param clientFd The accepted, non-blocking, client socket.
+ * @param peer The client address, or NULL if accept did not return it.
+ * @throw std::runtime_error if the socket cannot be added to epoll.
  */
-void Cluster::setupConnection(int socket) {
+void Cluster::setupConnection(const Connection &listener, int clientFd,
+                              const struct sockaddr_storage *peer) {
 #ifdef DEBUG
     Logger::debug("Cluster", __func__, "Setting up connection");
 #endif
 
-    int clientFd = accept(socket, NULL, NULL);
-    if (clientFd == -1) {
-        std::string reason = std::strerror(errno);
-        throw std::runtime_error("Failed to accept connection: " + reason);
+    Connection &conn = *allocConnection(clientFd); // Checked by the caller
+    conn = Connection(clientFd);
+    conn.listenFd = listener.fd;
+    conn.hosts = listener.hosts;
+    conn.server = conn.hosts->getDefault();
+    if (!admitConnection(conn) || !countHeaderConn(conn, peer)) {
+        shedConnection(conn);
+        return;
+    }
+    setClientOptions(clientFd, listener.localAddr.options);
+
+    if (_ring.isOpen()) {
+        armConnection(conn);
+        updateTimer(conn); // client_header_timeout
+        return;
     }
-    setSocketToNonBlocking(clientFd);
 
     // Add client socket to epoll instance
     struct epoll_event ee;
     std::memset(&ee, '\0', sizeof(ee));
-    ee.events = (EPOLLIN | EPOLLOUT | EPOLLET);
+    ee.events = conn.events;
     ee.data.fd = clientFd;
     if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, clientFd, &ee) == -1) {
         std::string reason = std::strerror(errno);
+        releaseConnection(conn);
+        close(clientFd);
         throw std::runtime_error("Failed to add client socket to epoll "
                                  "instance: " +
                                  reason);
     }
+    updateTimer(conn); // client_header_timeout
 
 #ifdef DEBUG
     std::stringstream s;
@@ -460,325 +894,951 @@ void Cluster::setupConnection(int socket) {
 }
 
 /**
- * @brief Configures a socket to operate in non-blocking mode.
+ * @brief Applies the per-connection listen parameters to a client socket.
  *
- * @param socket The socket file descriptor to configure.
- * @throw std::runtime_error if the socket cannot be set to non-blocking.
+ * @details TCP_NODELAY sends small responses without waiting for the ACK of
+ * the previous segment. TCP_NOTSENT_LOWAT caps the unsent bytes the kernel
+ * queues, so EPOLLOUT (and the memory held by the socket) follows what the
+ * client actually reads. Failures only cost the tuning: they are logged.
+ *
+ * @param clientFd The accepted client socket.
+ * @param options The parameters of the listen directive it came from.
  */
-void Cluster::setSocketToNonBlocking(int socket) {
-    int flags = fcntl(socket, F_GETFL, 0);
-    if ((flags == -1) || fcntl(socket, F_SETFL, flags | O_NONBLOCK) == -1) {
-        std::string reason = std::strerror(errno);
-        throw std::runtime_error("Failed to set socket to non-blocking: " +
-                                 reason);
-    }
+void Cluster::setClientOptions(int clientFd, const ListenOptions &options) {
+    int optval = 1;
+    if (options.noDelay && (setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY,
+                                       &optval, sizeof(optval)) == -1))
+        Logger::warn("Failed to set TCP_NODELAY: " +
+                     std::string(std::strerror(errno)));
+    if ((options.notSentLowat > 0) &&
+        (setsockopt(clientFd, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                    &options.notSentLowat, sizeof(options.notSentLowat)) == -1))
+        Logger::warn("Failed to set TCP_NOTSENT_LOWAT: " +
+                     std::string(std::strerror(errno)));
 }
 
 /**
- * @brief Handles incoming requests on a socket.
+ * @brief Counts a new client against the max_connections limits.
  *
- * @param socket The socket file descriptor to handle requests on.
- * @details Reads data from the socket and processes valid requests.
+ * @details The webserv-wide limit (events block) and the limit of the
+ * connection's default server must both admit the client.
+ *
+ * @param conn The newly accepted connection.
+ * @return true if the connection is admitted, false if it must be shed.
  */
-void Cluster::handleRequest(int socket) {
-#ifdef DEBUG
-    Logger::debug("Cluster", __func__, "Handling request");
-#endif
-
-    char requestBuf[REQ_BUFF_SIZE] = {};
-    ssize_t bytesRead = recv(socket, requestBuf, REQ_BUFF_SIZE, 0);
-    if (bytesRead == 0) { // If the request wasn't valid until closure, discard it. 
-        _requestBuff.erase(socket);
-        return;
-    }
-    if (bytesRead < 0) {
-        killConnection(socket, _epollFd);
-        std::string reason = std::strerror(errno);
-        throw std::runtime_error("Failed to read request: " + reason);
+bool Cluster::admitConnection(Connection &conn) {
+    const ConnectionLimit &globalLimit = _global.getConnectionLimit();
+    if (!globalLimit.acquire())
+        return (false);
+    if (!conn.server->getConnectionLimit().acquire()) {
+        globalLimit.release();
+        return (false);
     }
-    
-    _requestBuff[socket] += std::string(requestBuf, bytesRead);
-    if (isRequestValid(_requestBuff[socket])) {
-        processRequest(socket, _requestBuff[socket]);
-        _requestBuff.erase(socket); // clear current connect's request buffer
-#ifdef DEBUG
-            std::cout << "handling request on fd: " BLU << socket << NC << std::endl;
-            Logger::debug("Cluster", __func__, "request handled");
-#endif
-      return;               
-    }
-
-    // If request is not valid, reset the socket
-    struct epoll_event ee;
-    std::memset(&ee, '\0', sizeof(ee));
-    ee.events = (EPOLLIN | EPOLLOUT | EPOLLHUP);
-    ee.data.fd = socket;
-
-    /* Change file descriptor epoll_event structure.  */
-    if (epoll_ctl(_epollFd, EPOLL_CTL_MOD, socket, &ee) == -1)
-        killConnection(socket, _epollFd);
+    conn.admitted = conn.server;
+    return (true);
 }
 
 /**
- * @brief Validates an incoming request.
+ * @brief Counts a new client among the connections of its IP that are still
+ * waiting for their header block.
+ *
+ * @details max_header_connections_per_ip of the default server caps them,
+ * so a client holding many sockets open with partial headers (slowloris)
+ * only exhausts its own share of the slots. The connection is uncounted
+ * once its first header block is received, or when it is closed.
  *
- * @param request The request string to validate.
- * @return true if the request is valid, false otherwise.
+ * @param conn The newly accepted connection.
+ * @param peer The client address, or NULL to look it up.
+ * @return true if the connection is admitted, false if it must be shed.
  */
-bool Cluster::isRequestValid(const std::string &request) const {
-#ifdef DEBUG
-    Logger::debug("Cluster", __func__, "checking if request is valid");
-#endif
-
-    // Extract Headers
-    std::size_t headerEnd = request.find("\r\n\r\n");
-    if (headerEnd == std::string::npos)
-        return (false); // Incomplete Headers
-
-    std::string headers = request.substr(0, headerEnd);
-    if (headers.empty())
-        return (false); // Empty Headers
-
-    // Check for `Content-Length`
-    std::size_t contentLengthPos = headers.find("Content-Length:");
-    if (contentLengthPos != std::string::npos) {
-        std::size_t contentLengthStart =
-            (contentLengthPos + std::string("Content-Length:").length());
-        std::size_t contentLengthEnd = headers.find("\r\n", contentLengthStart);
-        if (contentLengthEnd != std::string::npos) {
-            std::string contentLengthStr = headers.substr(
-                contentLengthStart, contentLengthEnd - contentLengthStart);
-            std::size_t contentLength =
-                string2number<std::size_t>(contentLengthStr);
-            // +4 to account for \r\n\r\n
-            return (request.size() >= (headerEnd + 4 + contentLength));
-        }
+bool Cluster::countHeaderConn(Connection &conn,
+                              const struct sockaddr_storage *peer) {
+    std::size_t cap = conn.server->getHeaderConnsPerIp();
+    if (cap == 0)
+        return (true);
+    struct sockaddr_storage addr;
+    if (peer == NULL) { // io_uring accepts do not return the address
+        socklen_t addrLen = sizeof(addr);
+        if (getpeername(conn.fd, reinterpret_cast<struct sockaddr *>(&addr),
+                        &addrLen) == -1)
+            return (true);
+        peer = &addr;
     }
-    // Check for `Transfer-Encoding: chunked`
-    if (headers.find("Transfer-Encoding: chunked") != std::string::npos)
-        // Look for end of chunked transfer
-        return (request.find("0\r\n\r\n") != std::string::npos);
+    if (peer->ss_family != AF_INET)
+        return (true);
 
+    conn.peerIp =
+        reinterpret_cast<const struct sockaddr_in *>(peer)->sin_addr.s_addr;
+    std::size_t &count = _headerConns[conn.peerIp];
+    if (count >= cap) {
 #ifdef DEBUG
-    Logger::debug("Cluster", __func__, "request is valid");
+        Logger::debug("Cluster", __func__,
+                      "max_header_connections_per_ip reached, shedding");
 #endif
-    // Assumme request is complete if no `Content-Length` or
-    // `Transfer-Encoding: chunked` is present
+        return (false);
+    }
+    ++count;
+    conn.ipCounted = true;
     return (true);
 }
 
 /**
- * @brief Processes a valid request.
+ * @brief Takes a connection out of the header phase count of its IP.
  *
- * @param socket The socket file descriptor associated with the request.
- * @param request The request string to process.
- * @details
+ * @param conn The client connection.
  */
-void Cluster::processRequest(int socket, const std::string &request) {
-#ifdef DEBUG
-    Logger::debug("Cluster", __func__, "processing request");
-#endif
-	// static time_t lastTime = -1;
-
-    HttpRequest req;
-    unsigned short errorStatus = HttpRequestParser::parseHttp(request, req);
-    std::string response = getResponse(req, errorStatus, socket);
-
-	// time_t currTime = time(NULL);
-	if (true) {
-		std::stringstream s;
-		s << CYN << "[" << errorStatus << "] " NC << req.uri;
-		Logger::info(s.str());
-		// lastTime = currTime;
-	}
-
-    ssize_t toSend = send(socket, response.c_str(), response.size(), 0);
-    if (toSend == -1 || toSend == 0) {
-        killConnection(socket, _epollFd);
-    }
-
-    killConnection(socket, _epollFd);
+void Cluster::uncountHeaderConn(Connection &conn) {
+    if (!conn.ipCounted)
+        return;
+    std::map<in_addr_t, std::size_t>::iterator it;
+    it = _headerConns.find(conn.peerIp);
+    if ((it != _headerConns.end()) && (--it->second == 0))
+        _headerConns.erase(it);
+    conn.ipCounted = false;
+}
 
-#ifdef DEBUG
-    Logger::debug("Cluster", __func__, "request Processed");
-#endif
+/**
+ * @brief Rejects a connection with the pre-rendered 503 response.
+ *
+ * @details The fast path of load shedding: the request is neither read nor
+ * parsed nor routed, the response is a constant string. The socket is
+ * half-closed and whatever the client already sent is drained, so that
+ * closing it does not reset the connection before the 503 is read.
+ *
+ * @param conn The connection to reject, released here.
+ */
+void Cluster::shedConnection(Connection &conn) {
+    int clientFd = conn.fd;
+    releaseConnection(conn);
+
+    ssize_t ret = send(clientFd, _shedResponse.data(), _shedResponse.size(),
+                       MSG_NOSIGNAL | MSG_DONTWAIT);
+    shutdown(clientFd, SHUT_WR);
+    char drain[REQ_BUFF_SIZE];
+    ret = recv(clientFd, drain, sizeof(drain), MSG_DONTWAIT);
+    (void)ret; // Best effort: the client is turned away anyway
+    close(clientFd);
 }
 
 /**
- * @brief Generates a response for a given HTTP request.
+ * @brief Stops watching the listening sockets for ACCEPT_PAUSE_MS.
  *
- * @param request The HTTP request to process.
- * @param errorStatus The error status code, if any.
- * @param socket The socket file descriptor associated with the request.
- * @return std::string The generated HTTP response.
- * @details Determines the appropriate response type based on the request method
- * and error status, then generates and returns the response.
- */
-const std::string Cluster::getResponse(HttpRequest &request,
-                                       unsigned short &errorStatus,
-                                       int socket) {
-    AResponse *responseCtrl;
-    const Server *server = getContext(request, socket);
-
-    if (errorStatus != OK)
-        responseCtrl = new ErrorResponse(*server, request, errorStatus);
-    else {
-        switch (static_cast<int>(request.method)) {
-        case GET:
-            responseCtrl = new GetResponse(*server, request);
-            break;
-        case POST:
-            responseCtrl = new PostResponse(*server, request, socket, _epollFd);
-            break;
-        case DELETE:
-            responseCtrl = new DeleteResponse(*server, request);
-            break;
-            /// TODO: Add other methods
+ * @details Called when accept4() fails for lack of file descriptors or
+ * memory, or when every connection slot is taken. The pending clients wait
+ * in the kernel backlog until resumeAccepts() runs from handleTimeouts().
+ *
+ * @param reason Why accepting is paused, for the log.
+ */
+void Cluster::pauseAccepts(const std::string &reason) {
+    if (_acceptTimer.isActive())
+        return;
+    Logger::warn(reason + ": pausing new connections");
 
-        default:
-            responseCtrl =
-                new ErrorResponse(*server, request, METHOD_NOT_ALLOWED);
-            break;
-        }
+    std::vector<int>::const_iterator it;
+    for (it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+        if (_ring.isOpen())
+            cancelAccept(*getConnection(*it));
+        else
+            epoll_ctl(_epollFd, EPOLL_CTL_DEL, *it, NULL);
     }
+    _timers.schedule(_acceptTimer, ACCEPT_PAUSE_MS);
+}
 
-    std::string response = responseCtrl->generateResponse();
-	errorStatus = responseCtrl->getStatus();
-
-    delete responseCtrl;
-    return (response);
+/**
+ * @brief Watches the listening sockets again after pauseAccepts().
+ */
+void Cluster::resumeAccepts(void) {
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__, "Resuming new connections");
+#endif
+    std::vector<int>::const_iterator it;
+    for (it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+        if (_ring.isOpen())
+            armAccept(*getConnection(*it));
+        else
+            setEpollSocket(*it, _listenEvents);
+    }
 }
 
 /**
- * @brief Retrieves the server context for a given HTTP request and socket.
+ * @brief Handles incoming requests on a socket.
  *
- * @param request The HTTP request containing headers.
- * @param socket The socket file descriptor associated with the request.
- * @return const Server* Pointer to the server context.
- * @details Determines the appropriate server context based on the request's
- * hostname and the socket's address. If multiple servers match, it returns
- * the first server with a matching hostname. If no server matches, it returns
- * the first server found.
- */
-const Server *Cluster::getContext(const HttpRequest &request, int socket) {
-    const Socket addr = getSocketAddress(socket);
-    std::string hostname = getHostnameFromRequest(request);
-    size_t colonPos = hostname.find_first_of(":");
-    if (colonPos != std::string::npos)
-        hostname.resize(colonPos);
-
-    std::vector<const Server *> validServers;
-    std::vector<const Server *>::const_iterator it;
-    for (it = _servers.begin(); it != _servers.end(); ++it) {
-        std::vector<Socket> netAddrs = (*it)->getNetAddr();
+ * @param conn The client connection to handle requests on.
+ * @details The socket is edge-triggered: it is drained into the connection
+ * buffer (see Connection::readInput()) and the complete requests found in
+ * it are served. Bytes belonging to a following request stay buffered for
+ * the next iteration. If the buffer filled up before the socket was empty,
+ * reading resumes once the served requests made room; the socket is not
+ * reported again otherwise. Reading also resumes when a connection that
+ * waited for EPOLLOUT is switched back to EPOLLIN, as epoll then reports the
+ * data already pending.
+ */
+void Cluster::handleRequest(Connection &conn) {
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__, "Handling request");
+#endif
 
-        std::vector<Socket>::const_iterator sockIt;
-        for (sockIt = netAddrs.begin(); sockIt != netAddrs.end(); ++sockIt)
-            if (*sockIt == addr)
-                validServers.push_back(*it);
+    if (conn.state == Connection::LINGERING) {
+        discardInput(conn);
+        return;
     }
-
-    // If no address was found, check matching port
-    if (validServers.empty()) {
-        std::vector<const Server *>::const_iterator it;
-        for (it = _servers.begin(); it != _servers.end(); ++it) {
-            std::vector<Socket> netAddrs = (*it)->getNetAddr();
-
-            std::vector<Socket>::const_iterator sockIt;
-            for (sockIt = netAddrs.begin(); sockIt != netAddrs.end(); ++sockIt)
-                if (sockIt->port == addr.port)
-                    validServers.push_back(*it);
+    int socket = conn.fd;
+    while (true) {
+        if (conn.state == Connection::IDLE)
+            conn.state = Connection::READING_HEADERS;
+        std::size_t limit = getReadLimit(conn);
+        std::size_t buffered = conn.requestBuff.size();
+        Connection::ReadStatus status =
+            conn.readInput(conn.server->getHeaderBufferSize(), limit);
+        if (status == Connection::READ_ERROR) {
+            std::string reason = std::strerror(errno);
+            killConnection(socket, _epollFd);
+            throw std::runtime_error("Failed to read request: " + reason);
         }
-    }
-
-    // if multiple servers are found...
-    if (validServers.size() > 1) {
-        std::vector<const Server *>::const_iterator it;
-        for (it = validServers.begin(); it != validServers.end(); ++it) {
-            std::vector<std::string> serverNames = (*it)->getServerName();
-
-            if (std::find(serverNames.begin(), serverNames.end(), hostname) !=
-                serverNames.end())
-                return &(**it); // return first matching server
+        if (!checkRecvRate(conn, conn.requestBuff.size() - buffered))
+            return;
+        if (status == Connection::READ_CLOSED)
+            conn.peerClosed = true; // Served what was sent, then closed
+
+        serveRequests(conn);
+        if ((conn.fd != socket) || (conn.state == Connection::WRITING) ||
+            (status != Connection::READ_FULL))
+            return; // Closed, waiting for EPOLLOUT, or drained
+        if (conn.requestBuff.size() >= getReadLimit(conn)) {
+            if (conn.headerLen == 0)
+                rejectRequest(conn, BAD_REQUEST);
+            else
+                lingerRequest(conn, PAYLOAD_TOO_LARGE);
+            return; // Full, and nothing could be served
         }
     }
-
-    // if no server was found, return first server
-    // Return a reference to avoid dangling pointer
-    if (!validServers.empty())
-        return (validServers.front());
-
-    // Return first server
-    return (_servers.front());
 }
 
 /**
- * @brief Retrieves the socket address for a given socket.
+ * @brief Gets the client_max_body_size of the pending request.
  *
- * @param socket The socket file descriptor to retrieve the address for.
- * @return const Socket The socket address containing IP and port.
+ * @param conn The client connection, its context set.
+ * @return The limit of the location, MAX_BODY_SIZE if unset.
  */
-const Socket Cluster::getSocketAddress(int socket) {
-    struct sockaddr addr;
-    socklen_t addrLen = sizeof(addr);
-    struct sockaddr_in *addrIn;
-    std::stringstream portBuf;
-    Socket address;
-
-    if (getsockname(socket, &addr, &addrLen) == -1) {
-        std::string reason = std::strerror(errno);
-        Logger::warn("Failed to get socket address: " + reason);
-        address.ip = "0.0.0.0";
-        address.port = "0";
-        return (address);
-    }
-    
-    addrIn = reinterpret_cast<struct sockaddr_in *>(&addr);
-    address.ip = inet_ntoa(addrIn->sin_addr);
-    
-    portBuf << ntohs(addrIn->sin_port);
-    address.port = portBuf.str();
+std::size_t Cluster::getMaxBodySize(const Connection &conn) const {
+    long maxBody = conn.server->getClientMaxBodySize(conn.route);
+    if (maxBody < 0)
+        maxBody = MAX_BODY_SIZE; // Unset: the default of the response side
+    return (static_cast<std::size_t>(maxBody));
+}
 
-    return (address);
+/**
+ * @brief Gets how much of a request may be buffered.
+ *
+ * @details While the header block is incomplete, large_client_header_buffers
+ * of the default server. Then the length of the request, plus room for the
+ * header block of a pipelined one; or, for a chunked body whose end is not
+ * known yet, client_max_body_size plus the same room for a chunk-size line
+ * or the trailers. The body is decoded in place as it arrives, so this
+ * bounds its decoded size.
+ *
+ * @param conn The client connection.
+ * @return The size requestBuff may grow to.
+ */
+std::size_t Cluster::getReadLimit(const Connection &conn) const {
+    std::size_t maxHeader = conn.server->getMaxHeaderSize();
+    if (conn.headerLen == 0)
+        return (maxHeader);
+    if (conn.requestLen > 0)
+        return (conn.requestLen + maxHeader);
+    return (conn.headerLen + getMaxBodySize(conn) + maxHeader);
 }
 
 /**
- * @brief Extracts the hostname from an HTTP request.
+ * @brief Checks an incoming body against client_max_body_size.
  *
- * This function iterates over the headers of the given HTTP request to find
- * the "Host" header, which contains the hostname. It performs a
- * case-insensitive comparison to locate the header.
+ * @details Runs as soon as the header block is complete, before the body is
+ * buffered: Content-Length gives the size upfront; a chunked body is checked
+ * by its decoded size so far, after each read.
  *
- * @param request The HTTP request containing headers.
- * @return const std::string The extracted hostname or an empty string if the
- * "Host" header is not found.
- */
-const std::string Cluster::getHostnameFromRequest(const HttpRequest &request) {
-    std::multimap<std::string, std::string>::const_iterator hostname;
-    for (hostname = request.headers.begin(); hostname != request.headers.end();
-         ++hostname) {
-        if (strcasecmp(hostname->first.c_str(), "host") == 0) {
-            return (hostname->second);
-        }
-    }
-    return ("");
+ * @param conn A connection in the READING_BODY state, its context set.
+ * @return true if the body is larger than the location accepts.
+ */
+bool Cluster::isBodyTooLarge(const Connection &conn) const {
+    std::size_t bodySize = conn.chunked ? conn.bodyLen
+                                        : (conn.requestLen - conn.headerLen);
+    return (bodySize > getMaxBodySize(conn));
 }
 
 /**
- * @brief Terminates a connection and removes it from the epoll instance.
+ * @brief Sends the error page of a request that can not be served.
  *
- * @param socket The socket file descriptor to close.
- * @param epollFd The epoll instance file descriptor.
- * @throw std::runtime_error if the socket cannot be removed from the epoll
- * instance.
+ * @details The response is sent best effort, without waiting for the
+ * socket: the connection is not kept anyway.
+ *
+ * @param conn The client connection.
+ * @param status The error status of the response.
  */
-void Cluster::killConnection(int socket, int epollFd) {
-#ifdef DEBUG
-    Logger::debug("Cluster", __func__, "killing connection");
-#endif
+void Cluster::sendRejection(Connection &conn, short status) {
+    conn.request.reset();
+    conn.response.reset();
+    _errorHandler.reset(*conn.server, conn.request, conn.response, status);
+    _errorHandler.setKeepAlive(false);
+    OutBuffer response;
+    response.head = _errorHandler.generateResponse();
+    _errorHandler.takeBody(response.body);
+
+    struct iovec iov[2];
+    struct msghdr msg;
+    std::memset(&msg, '\0', sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    iov[0].iov_base = const_cast<char *>(response.head.data());
+    iov[0].iov_len = response.head.size();
+    iov[1].iov_base = const_cast<char *>(response.body.data());
+    iov[1].iov_len = response.body.size();
+    ssize_t ret = sendmsg(conn.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    (void)ret; // Best effort: the connection is not kept anyway
+}
 
-    if (epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, NULL) == -1) {
-        std::string reason = std::strerror(errno);
+/**
+ * @brief Answers a request that can not be served, then closes.
+ *
+ * @details Used when a request times out or its header block outgrows its
+ * buffer.
+ *
+ * @param conn The client connection, released here.
+ * @param status The error status of the response.
+ */
+void Cluster::rejectRequest(Connection &conn, short status) {
+    sendRejection(conn, status);
+    killConnection(conn.fd, _epollFd);
+}
+
+/**
+ * @brief Answers a request without reading its body, then lingers.
+ *
+ * @details Used when the body is larger than client_max_body_size. The
+ * buffered input is dropped and the socket half-closed after the error
+ * page. Closing it outright would reset the connection while the client is
+ * still sending, and the client could lose the response before reading it:
+ * the connection stays LINGERING instead, its input discarded, until the
+ * client closes or LINGERING_TIME_MS have passed.
+ *
+ * @param conn The client connection.
+ * @param status The error status of the response.
+ */
+void Cluster::lingerRequest(Connection &conn, short status) {
+    std::stringstream s;
+    s << "Connection " << conn.fd << " rejected before its body ("
+      << status << ")";
+    Logger::warn(s.str());
+
+    sendRejection(conn, status);
+    shutdown(conn.fd, SHUT_WR);
+    std::string().swap(conn.requestBuff); // Give the memory back now
+    conn.resetFraming();
+    conn.keepAlive = false;
+    conn.state = Connection::LINGERING;
+    conn.timerState = Connection::LINGERING;
+    _timers.schedule(conn.timer, LINGERING_TIME_MS);
+    if (!_ring.isOpen()) // The multishot recv of a ring keeps reading
+        discardInput(conn);
+}
+
+/**
+ * @brief Reads and drops the input of a LINGERING connection.
+ *
+ * @details At most LINGERING_READS reads per wakeup, so that a client
+ * pushing its body at full speed does not hold the event loop: new data
+ * reports the socket again. The connection is closed once the client has
+ * closed its side.
+ *
+ * @param conn The client connection, released once the peer closed.
+ */
+void Cluster::discardInput(Connection &conn) {
+    char drain[READ_CHUNK_SIZE];
+    for (int i = 0; i < LINGERING_READS; ++i) {
+        ssize_t ret = recv(conn.fd, drain, sizeof(drain), MSG_DONTWAIT);
+        if (ret > 0)
+            continue;
+        if ((ret == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+                            (errno == EINTR)))
+            return; // Drained
+        killConnection(conn.fd, _epollFd); // Closed by the peer, or reset
+        return;
+    }
+}
+
+/**
+ * @brief Closes a client that sends its request below client_min_rate.
+ *
+ * @details The timeouts bound the gap between two reads, so a client
+ * trickling a byte now and then would hold its connection indefinitely.
+ * The rate is measured over min_rate_window instead. The client gets a
+ * best-effort 408.
+ *
+ * @param conn The client connection, released if it is too slow.
+ * @param nBytes The number of bytes just received.
+ * @return true if the connection is still open, false if it was closed.
+ */
+bool Cluster::checkRecvRate(Connection &conn, std::size_t nBytes) {
+    if (conn.recvRate.update(nBytes, conn.server->getClientMinRate(),
+                             conn.server->getMinRateWindow()))
+        return (true);
+    std::stringstream s;
+    s << "Connection " << conn.fd << " below client_min_rate ("
+      << connState2string(conn.state) << ")";
+    Logger::warn(s.str());
+    rejectRequest(conn, REQUEST_TIMEOUT);
+    return (false);
+}
+
+/**
+ * @brief Closes a client that reads its responses below send_min_rate.
+ *
+ * @param conn The client connection, released if it is too slow.
+ * @param nBytes The number of bytes just sent.
+ * @return true if the connection is still open, false if it was closed.
+ */
+bool Cluster::checkSendRate(Connection &conn, std::size_t nBytes) {
+    if (conn.sendRate.update(nBytes, conn.server->getSendMinRate(),
+                             conn.server->getMinRateWindow()))
+        return (true);
+    std::stringstream s;
+    s << "Connection " << conn.fd << " below send_min_rate";
+    Logger::warn(s.str());
+    killConnection(conn.fd, _epollFd);
+    return (false);
+}
+
+/**
+ * @brief Processes the buffered requests in order and sends their responses.
+ *
+ * @details Pipelined requests (several requests sent without waiting for the
+ * responses) are split out of the buffer one after the other. Their
+ * responses are queued in request order and sent together by
+ * flushConnection(). At most MAX_PIPELINED_REQUESTS responses are queued at
+ * once: the remaining requests are served once the client has read them.
+ *
+ * @param conn The client connection.
+ */
+void Cluster::serveRequests(Connection &conn) {
+    while (true) {
+        while (conn.keepAlive &&
+               (conn.outQueue.size() < MAX_PIPELINED_REQUESTS) &&
+               conn.frameRequest()) {
+            processRequest(conn); // Parsed in place, then consumed
+            conn.consumeRequest();
+#ifdef DEBUG
+            std::cout << "handling request on fd: " BLU << conn.fd << NC
+                      << std::endl;
+            Logger::debug("Cluster", __func__, "request handled");
+#endif
+        }
+        if (conn.ipCounted && ((conn.headerLen > 0) || (conn.nRequests > 0)))
+            uncountHeaderConn(conn); // Out of its first header phase
+        if (conn.outQueue.empty())
+            break;
+        if (!flushConnection(conn) || (conn.state == Connection::WRITING))
+            return; // Closed, or waiting for EPOLLOUT
+    }
+    if (conn.peerClosed) { // Nothing more will come: drop a partial request
+        killConnection(conn.fd, _epollFd);
+        return;
+    }
+    if (conn.state == Connection::READING_BODY) {
+        if (!conn.hasContext)
+            setRequestContext(conn);
+        if (isBodyTooLarge(conn)) {
+            lingerRequest(conn, PAYLOAD_TOO_LARGE);
+            return;
+        }
+        if (conn.sendContinue) {
+            queueContinue(conn); // Flushed, which arms the timer
+            return;
+        }
+    }
+    updateTimer(conn);
+}
+
+/**
+ * @brief Resumes sending the queued responses once the socket is writable.
+ *
+ * @details Once they are all sent, the pipelined requests left in the buffer
+ * are served.
+ *
+ * @param conn The client connection.
+ */
+void Cluster::handleWrite(Connection &conn) {
+    if (flushConnection(conn) && (conn.state != Connection::WRITING))
+        serveRequests(conn);
+}
+
+/**
+ * @brief Sends as much of the connection's output queue as the socket takes.
+ *
+ * @details The queued responses are gathered in a single sendmsg() (writev
+ * with MSG_NOSIGNAL), header blocks and bodies straight from the buffers
+ * they were built in, so pipelined responses leave in as few syscalls and
+ * segments as possible. File bodies go from the page cache to the socket
+ * with sendfile(), one slice per wakeup, so a large download neither grows
+ * the process nor starves the other clients; the headers before them are
+ * sent with MSG_MORE so they share a segment with the start of the file.
+ * While data is pending the socket only waits for EPOLLOUT: no new
+ * requests are read until the client has consumed the previous responses
+ * (backpressure). Once the queue is drained the socket goes back to EPOLLIN,
+ * or is closed if the last response was not keep-alive. With io_uring the
+ * queue is handed to submitSend() instead.
+ *
+ * @param conn The connection to flush.
+ * @return true if the connection is still open, false if it was closed.
+ */
+bool Cluster::flushConnection(Connection &conn) {
+    if (_ring.isOpen())
+        return (submitSend(conn));
+    bool sentFile = false;
+    std::size_t nSent = 0;
+    while (!conn.outQueue.empty()) {
+        if (conn.isSendingFile()) {
+            if (sentFile)
+                break; // One slice per wakeup, EPOLLOUT brings the next one
+            sentFile = true;
+            ssize_t sent = sendFileSlice(conn);
+            if (sent > 0) {
+                nSent += static_cast<std::size_t>(sent);
+                continue;
+            }
+            if ((sent == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+                break;
+            killConnection(conn.fd, _epollFd); // Failed, or file truncated
+            return (false);
+        }
+
+        struct iovec iov[MAX_IOVECS];
+        struct msghdr msg;
+        std::memset(&msg, '\0', sizeof(msg));
+        msg.msg_iov = iov;
+        bool fileFollows;
+        msg.msg_iovlen = conn.gatherOutput(iov, MAX_IOVECS, fileFollows);
+        ssize_t sent = sendmsg(conn.fd, &msg,
+                               MSG_NOSIGNAL | (fileFollows ? MSG_MORE : 0));
+        if (sent == -1) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break; // Socket buffer full, wait for EPOLLOUT
+            killConnection(conn.fd, _epollFd);
+            return (false);
+        }
+
+        conn.consumeOutput(static_cast<std::size_t>(sent));
+        nSent += static_cast<std::size_t>(sent);
+    }
+    if (!checkSendRate(conn, nSent))
+        return (false);
+
+    if (!conn.outQueue.empty()) {
+        conn.state = Connection::WRITING;
+        setConnectionEvents(conn, EPOLLOUT);
+        updateTimer(conn); // send_timeout, restarted after each write
+        return (true);
+    }
+    if (!conn.keepAlive) {
+        killConnection(conn.fd, _epollFd);
+        return (false);
+    }
+    conn.resumeReading();
+    setConnectionEvents(conn, CLIENT_READ_EVENTS);
+    updateTimer(conn);
+
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__,
+                  "output flushed, connection " + connState2string(conn.state));
+#endif
+    return (true);
+}
+
+/**
+ * @brief Sends a slice of the file body of the front response.
+ *
+ * @details At most SENDFILE_SLICE bytes are sent; the response is popped
+ * (and its file closed) once the whole body is sent.
+ *
+ * @param conn A connection whose front response is sending its file body.
+ * @return The number of bytes sent, 0 if the file is shorter than announced,
+ * or -1 on error (errno set).
+ */
+ssize_t Cluster::sendFileSlice(Connection &conn) {
+    OutBuffer &out = conn.outQueue.front();
+    off_t left = std::min(out.fileEnd - out.fileOffset,
+                          static_cast<off_t>(SENDFILE_SLICE));
+    ssize_t sent = sendfile(conn.fd, out.fileFd, &out.fileOffset,
+                            static_cast<std::size_t>(left));
+    if ((sent > 0) && (out.fileOffset == out.fileEnd))
+        conn.popOutput();
+    return (sent);
+}
+
+/**
+ * @brief Resolves the server and location of a request still being read.
+ *
+ * @details Only the header block is parsed, as soon as it is complete, to
+ * know which client_body_timeout and client_max_body_size apply while the
+ * body is incoming, and whether the client waits for a 100 Continue.
+ *
+ * @param conn A connection in the READING_BODY state.
+ */
+void Cluster::setRequestContext(Connection &conn) {
+    if (conn.headerLen == 0)
+        return;
+
+    HttpRequest &req = conn.request;
+    req.reset();
+    HttpRequestParser::parseHttp(conn.requestBuff.data(), conn.headerLen, req);
+    conn.server = getContext(req, conn);
+    conn.route = conn.server->getLocationRoute(req.uri);
+    conn.hasContext = true;
+
+    const StrView *expect = req.getHeader(HDR_EXPECT);
+    conn.sendContinue = ((expect != NULL) && expect->iequals("100-continue") &&
+                         req.protocolVersion.equals("HTTP/1.1"));
+}
+
+/**
+ * @brief Sends the interim 100 Continue of a request still being read.
+ *
+ * @details A client sending `Expect: 100-continue` may wait for it before
+ * sending the body (RFC 9110, 10.1.1), so it goes out as soon as the header
+ * block is framed and the body size accepted. It is queued like a response,
+ * behind those of the requests before.
+ *
+ * @param conn A connection in the READING_BODY state, its context set.
+ */
+void Cluster::queueContinue(Connection &conn) {
+    conn.sendContinue = false;
+    conn.outQueue.push_back(OutBuffer());
+    conn.outQueue.back().head = "HTTP/1.1 100 Continue\r\n\r\n";
+    flushConnection(conn);
+}
+
+/**
+ * @brief Arms the timeout matching the connection's current state.
+ *
+ * @details client_header_timeout covers the whole header block, so it is
+ * not restarted by each read. client_body_timeout and send_timeout bound the
+ * gap between two successful reads/writes. keepalive_timeout bounds the time
+ * spent IDLE between two requests.
+ *
+ * @param conn The connection whose timer is (re)armed.
+ */
+void Cluster::updateTimer(Connection &conn) {
+    if ((conn.state == Connection::READING_HEADERS) &&
+        (conn.timerState == Connection::READING_HEADERS) &&
+        conn.timer.isActive())
+        return; // Header deadline already running
+
+    Timeout timeout = CLIENT_HEADER_TIMEOUT;
+    switch (conn.state) {
+    case Connection::READING_HEADERS:
+        timeout = CLIENT_HEADER_TIMEOUT;
+        break;
+    case Connection::READING_BODY:
+        timeout = CLIENT_BODY_TIMEOUT;
+        break;
+    case Connection::WRITING:
+        timeout = SEND_TIMEOUT;
+        break;
+    case Connection::IDLE:
+        timeout = KEEPALIVE_TIMEOUT;
+        break;
+    case Connection::LINGERING:
+        return; // Fixed deadline, armed by lingerRequest()
+    }
+    _timers.schedule(conn.timer, conn.server->getTimeout(timeout, conn.route));
+    conn.timerState = conn.state;
+}
+
+/**
+ * @brief Closes the connections whose deadline has passed.
+ *
+ * @details A client that timed out in the middle of a request gets a
+ * best-effort 408 before the socket is closed. Idle keep-alive connections
+ * and clients that stopped reading their response are closed silently.
+ */
+void Cluster::handleTimeouts(void) {
+    std::vector<int> expired;
+    _timers.advance(expired);
+
+    std::vector<int>::const_iterator it;
+    for (it = expired.begin(); it != expired.end(); ++it) {
+        if (*it == _acceptTimer.fd) { // End of pauseAccepts()
+            resumeAccepts();
+            continue;
+        }
+        Connection *slot = getConnection(*it);
+        if ((slot == NULL) || (slot->type != Connection::CLIENT))
+            continue;
+        Connection &conn = *slot;
+        if (conn.state == Connection::LINGERING) { // End of lingerRequest()
+            killConnection(conn.fd, _epollFd);
+            continue;
+        }
+
+        std::stringstream s;
+        s << "Connection " << conn.fd << " timed out ("
+          << connState2string(conn.state) << ")";
+        Logger::warn(s.str());
+
+        bool inRequest = ((conn.state == Connection::READING_HEADERS) ||
+                          (conn.state == Connection::READING_BODY));
+        if (inRequest && !conn.requestBuff.empty())
+            rejectRequest(conn, REQUEST_TIMEOUT);
+        else
+            killConnection(conn.fd, _epollFd);
+    }
+}
+
+/**
+ * @brief Changes the epoll events registered for a client socket.
+ *
+ * @param conn The connection to update.
+ * @param events The new set of epoll events.
+ * @throw std::runtime_error if the epoll instance cannot be updated.
+ */
+void Cluster::setConnectionEvents(Connection &conn, uint32_t events) {
+    if (conn.events == events)
+        return;
+
+    struct epoll_event ee;
+    std::memset(&ee, '\0', sizeof(ee));
+    ee.events = events;
+    ee.data.fd = conn.fd;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_MOD, conn.fd, &ee) == -1) {
+        std::string reason = std::strerror(errno);
+        killConnection(conn.fd, _epollFd);
+        throw std::runtime_error("Failed to update client socket events: " +
+                                 reason);
+    }
+    conn.events = events;
+}
+
+/**
+ * @brief Processes a valid request.
+ *
+ * @param conn The connection the request was received on.
+ * @details The request (its first requestLen bytes of requestBuff) is parsed
+ * in place: conn.request only holds slices of the buffer, so it must be
+ * served before the request is consumed. Decides whether the connection
+ * persists (HTTP version, `Connection` header and the server's
+ * keepalive_requests cap) and queues the response on the connection. It is
+ * sent by flushConnection().
+ */
+void Cluster::processRequest(Connection &conn) {
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__, "processing request");
+#endif
+    conn.state = Connection::WRITING;
+
+    HttpRequest &req = conn.request;
+    req.reset();
+    unsigned short errorStatus = HttpRequestParser::parseHttp(
+        conn.requestBuff.data(), conn.requestLen, req);
+    if ((errorStatus == OK) && (conn.framingStatus != OK))
+        errorStatus = conn.framingStatus; // Untrustworthy body framing
+    const Server *server = getContext(req, conn);
+    const Connection *listener = getConnection(conn.listenFd);
+    if ((listener != NULL) && !listener->localAddr.isUnix())
+        req.serverPort = listener->localAddr.port; // CGI SERVER_PORT
+
+    conn.server = server;
+    conn.route = server->getLocationRoute(req.uri);
+    conn.hasContext = false; // The next request has its own context
+
+    ++conn.nRequests;
+    conn.keepAlive = (isRunning && (errorStatus == OK) && !conn.mustClose &&
+                      (conn.nRequests < server->getKeepaliveRequests()) &&
+                      (server->getTimeout(KEEPALIVE_TIMEOUT, conn.route) > 0) &&
+                      Connection::isKeepAliveRequested(req));
+    // Built in place: the queue never copies the body
+    conn.outQueue.push_back(OutBuffer());
+    getResponse(errorStatus, server, conn, conn.outQueue.back());
+
+    std::stringstream s;
+    s << CYN << "[" << errorStatus << "] " NC << req.uri;
+    Logger::info(s.str());
+
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__, "request processed, response queued");
+#endif
+}
+
+/**
+ * @brief Fills the method -> handler table.
+ *
+ * @details Methods without a handler of their own get the error handler,
+ * which answers 405 (see getResponse()).
+ */
+void Cluster::setMethodHandlers(void) {
+    for (int m = 0; m <= UNKNOWN; ++m)
+        _methodHandlers[m] = &_errorHandler;
+    _methodHandlers[GET] = &_getHandler;
+    _methodHandlers[POST] = &_postHandler;
+    _methodHandlers[DELETE] = &_deleteHandler;
+    /// TODO: Add other methods
+}
+
+/**
+ * @brief Generates the response to the request parsed in conn.request.
+ *
+ * @param errorStatus The error status code, if any.
+ * @param server The server context selected for the request.
+ * @param conn The connection the request was received on.
+ * @param response Receives the header block, and the in-memory or file body.
+ * @details The handler is picked from the method table and bound to the
+ * connection's request and response, so serving a request allocates no
+ * handler: the event loop owns one per method.
+ */
+void Cluster::getResponse(unsigned short &errorStatus, const Server *server,
+                          Connection &conn, OutBuffer &response) {
+    const HttpRequest &request = conn.request;
+    AResponse *responseCtrl = _methodHandlers[request.method];
+    short status = OK;
+
+    if (errorStatus != OK) {
+        responseCtrl = &_errorHandler;
+        status = errorStatus;
+    } else if (responseCtrl == &_errorHandler)
+        status = METHOD_NOT_ALLOWED;
+
+    conn.response.reset();
+    responseCtrl->reset(*server, request, conn.response, status);
+    responseCtrl->setKeepAlive(conn.keepAlive);
+    response.head = responseCtrl->generateResponse();
+	errorStatus = responseCtrl->getStatus();
+    responseCtrl->takeBody(response.body);
+    response.fileFd = responseCtrl->takeFile(response.fileEnd);
+}
+
+/**
+ * @brief Retrieves the server context for a given HTTP request and connection.
+ *
+ * @param request The HTTP request containing headers.
+ * @param conn The connection the request was received on.
+ * @return const Server* Pointer to the server context.
+ * @details The Host header is looked up in the virtual hosts of the listening
+ * socket the connection came from (see setHostTable()): a single hash lookup,
+ * which neither copies nor allocates. Requests without a Host header, or
+ * naming no server, go to the default server of the socket.
+ */
+const Server *Cluster::getContext(const HttpRequest &request,
+                                  const Connection &conn) {
+    const StrView *host = request.getHeader(HDR_HOST);
+    if (host == NULL)
+        return (conn.hosts->getDefault());
+    return (conn.hosts->find(*host));
+}
+
+/**
+ * @brief Builds the virtual hosts table of a listening socket.
+ *
+ * @details The servers reachable through the socket are those listening on
+ * its address or, for a wildcard socket (or if none does), on its port. The
+ * first of them, in configuration order, is the default server; each
+ * server_name goes to the first server declaring it.
+ *
+ * @param table The table to fill.
+ * @param addr The bound address of the listening socket.
+ */
+void Cluster::setHostTable(HostTable &table, const Socket &addr) const {
+    bool wildcard = (addr.ip == "0.0.0.0");
+    std::vector<const Server *> validServers;
+    for (int pass = 0; (pass < 2) && validServers.empty(); ++pass) {
+        bool matchPort = (wildcard || (pass == 1)); // Second pass: port only
+        std::vector<const Server *>::const_iterator it;
+        for (it = _servers.begin(); it != _servers.end(); ++it) {
+            std::vector<Socket> netAddrs = (*it)->getNetAddr();
+
+            std::vector<Socket>::const_iterator sockIt;
+            for (sockIt = netAddrs.begin(); sockIt != netAddrs.end(); ++sockIt)
+                if (matchPort ? (sockIt->port == addr.port) : (*sockIt == addr))
+                    break;
+            if (sockIt != netAddrs.end())
+                validServers.push_back(*it);
+        }
+    }
+
+    table.setDefault(validServers.empty() ? _servers.front()
+                                          : validServers.front());
+    std::vector<const Server *>::const_iterator it;
+    for (it = validServers.begin(); it != validServers.end(); ++it) {
+        std::vector<std::string> names = (*it)->getServerName();
+
+        std::vector<std::string>::const_iterator nameIt;
+        for (nameIt = names.begin(); nameIt != names.end(); ++nameIt)
+            table.add(*nameIt, *it);
+    }
+}
+
+/**
+ * @brief Retrieves the socket address for a given socket.
+ *
+ * @param socket The socket file descriptor to retrieve the address for.
+ * @return const Socket The socket address containing IP and port.
+ */
+const Socket Cluster::getSocketAddress(int socket) {
+    struct sockaddr_storage addr;
+    socklen_t addrLen = sizeof(addr);
+    struct sockaddr_in *addrIn;
+    std::stringstream portBuf;
+    Socket address;
+
+    if (getsockname(socket, reinterpret_cast<struct sockaddr *>(&addr),
+                    &addrLen) == -1) {
+        std::string reason = std::strerror(errno);
+        Logger::warn("Failed to get socket address: " + reason);
+        address.ip = "0.0.0.0";
+        address.port = "0";
+        return (address);
+    }
+    if (addr.ss_family == AF_UNIX) { // Path in port, as in the configuration
+        address.ip = UNIX_SOCKET_IP;
+        address.port = reinterpret_cast<struct sockaddr_un *>(&addr)->sun_path;
+        return (address);
+    }
+
+    addrIn = reinterpret_cast<struct sockaddr_in *>(&addr);
+    char ipBuf[INET_ADDRSTRLEN];
+    if (inet_ntop(AF_INET, &addrIn->sin_addr, ipBuf, sizeof(ipBuf)) == NULL)
+        address.ip = "0.0.0.0";
+    else
+        address.ip = ipBuf;
+    
+    portBuf << ntohs(addrIn->sin_port);
+    address.port = portBuf.str();
+
+    return (address);
+}
+
+/**
+ * @brief Terminates a connection and removes it from the epoll instance.
+ *
+ * @details With io_uring, the operations pending on the socket are cancelled
+ * instead.
+ *
+ * @param socket The socket file descriptor to close.
+ * @param epollFd The epoll instance file descriptor.
+ * @throw std::runtime_error if the socket cannot be removed from the epoll
+ * instance.
+ */
+void Cluster::killConnection(int socket, int epollFd) {
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__, "killing connection");
+#endif
+
+    Connection *conn = getConnection(socket);
+    if ((conn != NULL) && (conn->type == Connection::CLIENT)) {
+        if (_ring.isOpen())
+            cancelConnection(*conn);
+        releaseConnection(*conn);
+    }
+    if (!_ring.isOpen() &&
+        (epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, NULL) == -1)) {
+        std::string reason = std::strerror(errno);
+        close(socket);
         throw std::runtime_error("Failed to remove socket from epoll: " +
                                  reason);
     }
@@ -791,6 +1851,552 @@ void Cluster::killConnection(int socket, int epollFd) {
 #endif
 }
 
+/* ************************************************************************** */
+/*                              io_uring Backend                              */
+/* ************************************************************************** */
+
+/**
+ * @brief Creates the io_uring instance replacing epoll.
+ *
+ * @details The fixed file table has one entry per connection slot, at the
+ * slot's index, so requests on registered sockets skip the fd lookup.
+ * Multishot accepts are armed on the listeners and a multishot poll on the
+ * wake-up eventfd. Any failure (old kernel, io_uring disabled, locked memory
+ * limit...) leaves the event loop on epoll.
+ *
+ * @return true if io_uring drives the event loop, false to use epoll.
+ */
+bool Cluster::setupRing(void) {
+    unsigned nSlots = static_cast<unsigned>(_connections.size());
+    if (!_ring.setup(URING_ENTRIES) || !_ring.registerFiles(nSlots) ||
+        !_ring.setupBufferRing()) {
+        std::string reason = std::strerror(errno);
+        _ring.close();
+        Logger::warn("io_uring unavailable (" + reason +
+                     "): falling back to epoll");
+        return (false);
+    }
+    _uringSlots.assign(nSlots, UringSlot());
+
+    std::vector<int>::const_iterator it;
+    for (it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+        const Connection &listener = *getConnection(*it);
+        int ret = _ring.updateFile(getSlotIndex(listener), listener.fd);
+        if (ret < 0) {
+            _ring.close();
+            Logger::warn("io_uring unavailable (" +
+                         std::string(std::strerror(-ret)) +
+                         "): falling back to epoll");
+            return (false);
+        }
+        armAccept(listener);
+    }
+
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = _wakeFd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = uringData(URING_WAKE, 0, 0);
+    return (true);
+}
+
+/**
+ * @brief Runs the event loop on io_uring.
+ *
+ * @details Each iteration submits the requests queued since the last one and
+ * waits for completions, until the nearest connection deadline, in a single
+ * io_uring_enter().
+ */
+void Cluster::runRing(void) {
+    if (!_ring.enable()) { // Binds the ring to this thread
+        std::string reason = std::strerror(errno);
+        Logger::error("Failed to start io_uring: " + reason);
+        return;
+    }
+
+    struct io_uring_cqe cqe;
+    while (isRunning) {
+        try {
+            int ret = _ring.wait(_timers.getNextTimeout());
+            if ((ret < 0) && (ret != -EINTR) && (ret != -ETIME)) {
+                std::string reason = std::strerror(-ret);
+                throw std::runtime_error("io_uring_enter failed: " + reason);
+            }
+            while (_ring.peek(cqe))
+                handleCompletion(cqe);
+            handleTimeouts();
+        } catch (const std::exception &e) {
+            Logger::error(e.what());
+        }
+    }
+
+#ifdef DEBUG
+    Logger::debug("Cluster", __func__, "Cluster stopped running");
+#endif
+}
+
+/**
+ * @brief Returns a submission queue entry.
+ *
+ * @return The zeroed entry.
+ * @throw std::runtime_error if the kernel does not take the pending entries.
+ */
+struct io_uring_sqe *Cluster::getSqe(void) {
+    struct io_uring_sqe *sqe = _ring.getSqe();
+    if (sqe == NULL)
+        throw std::runtime_error("io_uring submission queue is full");
+    return (sqe);
+}
+
+/**
+ * @brief Returns the index of a slot, which is also its fixed file index.
+ *
+ * @param conn The slot.
+ * @return The index of the slot in the connection table.
+ */
+std::size_t Cluster::getSlotIndex(const Connection &conn) const {
+    return (static_cast<std::size_t>(&conn - &_connections[0]));
+}
+
+/**
+ * @brief Dispatches an io_uring completion.
+ *
+ * @details Completions of a connection closed since the request was
+ * submitted carry an old generation: their provided buffer is recycled and
+ * they are dropped.
+ *
+ * @param cqe The completion.
+ */
+void Cluster::handleCompletion(const struct io_uring_cqe &cqe) {
+    UringOp op = static_cast<UringOp>(cqe.user_data >> 56);
+    uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32) & URING_GEN_MASK;
+    std::size_t idx = static_cast<std::size_t>(cqe.user_data & 0xffffffffU);
+    if ((op == URING_IGNORE) || (op == URING_WAKE))
+        return; // Woken up by stop(), or a cancellation/file update
+
+    Connection &conn = _connections[idx];
+    if (op == URING_ACCEPT) {
+        handleAccept(conn, cqe);
+        return;
+    }
+    bool isLive = ((conn.type == Connection::CLIENT) &&
+                   (_uringSlots[idx].gen == gen));
+    if (!isLive && (op != URING_RECV))
+        _uringSlots[idx].parked.erase(gen); // The send no longer runs
+    if (op == URING_RECV)
+        handleRecv(isLive ? &conn : NULL, cqe);
+    else if (isLive && (op == URING_SEND))
+        handleSend(conn, cqe.res);
+    else if (isLive)
+        handleSendFile(conn, cqe.res);
+}
+
+/**
+ * @brief Arms a multishot accept on a listener.
+ *
+ * @details Each accepted client posts a completion; client sockets are
+ * created non-blocking and close-on-exec, as with accept4().
+ *
+ * @param listener The slot of the listening socket.
+ */
+void Cluster::armAccept(const Connection &listener) {
+    std::size_t idx = getSlotIndex(listener);
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = static_cast<int>(idx);
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = (SOCK_NONBLOCK | SOCK_CLOEXEC);
+    sqe->user_data = uringData(URING_ACCEPT, 0, idx);
+}
+
+/**
+ * @brief Cancels the multishot accept of a listener (pauseAccepts()).
+ *
+ * @param listener The slot of the listening socket.
+ */
+void Cluster::cancelAccept(const Connection &listener) {
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = uringData(URING_ACCEPT, 0, getSlotIndex(listener));
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = uringData(URING_IGNORE, 0, 0);
+}
+
+/**
+ * @brief Handles a completion of a listener's multishot accept.
+ *
+ * @details Mirrors acceptConnections(): running out of slots or file
+ * descriptors pauses accepting. The client accepted while no slot was left
+ * is closed. When the kernel ends the multishot accept it is re-armed,
+ * unless accepting is paused.
+ *
+ * @param listener The slot of the listening socket.
+ * @param cqe The completion.
+ */
+void Cluster::handleAccept(const Connection &listener,
+                           const struct io_uring_cqe &cqe) {
+    if ((cqe.res >= 0) && _freeSlots.empty()) {
+        close(cqe.res);
+        pauseAccepts("worker_connections are not enough");
+    } else if (cqe.res >= 0)
+        setupConnection(listener, cqe.res, NULL);
+    else if ((cqe.res == -EMFILE) || (cqe.res == -ENFILE) ||
+             (cqe.res == -ENOBUFS) || (cqe.res == -ENOMEM))
+        pauseAccepts(std::strerror(-cqe.res));
+
+    if (!(cqe.flags & IORING_CQE_F_MORE) && !_acceptTimer.isActive() &&
+        isRunning)
+        armAccept(listener);
+}
+
+/**
+ * @brief Registers a new client socket and arms its multishot recv.
+ *
+ * @details The fixed file update is linked to the recv, which only starts
+ * once the socket sits in the table.
+ *
+ * @param conn The new client connection.
+ */
+void Cluster::armConnection(Connection &conn) {
+    std::size_t idx = getSlotIndex(conn);
+    UringSlot &slot = _uringSlots[idx];
+    slot.fd = conn.fd;
+    slot.sending = false;
+    slot.recvPaused = false;
+
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_FILES_UPDATE;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&slot.fd);
+    sqe->len = 1;
+    sqe->off = idx;
+    sqe->flags = (IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS);
+    sqe->user_data = uringData(URING_IGNORE, 0, 0);
+    armRecv(conn);
+}
+
+/**
+ * @brief Arms a multishot recv on a client socket.
+ *
+ * @details The kernel picks a provided buffer for each read, so idle
+ * connections hold no receive buffer.
+ *
+ * @param conn The client connection.
+ */
+void Cluster::armRecv(const Connection &conn) {
+    std::size_t idx = getSlotIndex(conn);
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = static_cast<int>(idx);
+    sqe->flags = (IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT);
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = uringData(URING_RECV, _uringSlots[idx].gen, idx);
+}
+
+/**
+ * @brief Stops receiving while the request buffer is full.
+ *
+ * @details The counterpart of READ_FULL on epoll: the multishot recv is
+ * cancelled, so the buffer only grows by the reads already completed.
+ * resumeRecv() arms it again once the send in flight has completed.
+ *
+ * @param conn The client connection.
+ */
+void Cluster::pauseRecv(const Connection &conn) {
+    std::size_t idx = getSlotIndex(conn);
+    UringSlot &slot = _uringSlots[idx];
+    if (slot.recvPaused)
+        return;
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = uringData(URING_RECV, slot.gen, idx);
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = uringData(URING_IGNORE, 0, 0);
+    slot.recvPaused = true;
+}
+
+/**
+ * @brief Receives again after pauseRecv(), unless the request is too large.
+ *
+ * @details Called once the send completed and the buffered requests were
+ * served: a buffer still over getReadLimit() then made no progress, and its
+ * request is rejected as handleRecv() would.
+ *
+ * @param conn A client connection not WRITING.
+ */
+void Cluster::resumeRecv(Connection &conn) {
+    UringSlot &slot = _uringSlots[getSlotIndex(conn)];
+    if (!slot.recvPaused)
+        return;
+    if (isRequestTooLarge(conn)) {
+        if (conn.headerLen == 0) {
+            rejectRequest(conn, BAD_REQUEST);
+            return;
+        }
+        lingerRequest(conn, PAYLOAD_TOO_LARGE); // Drained by the recv
+    }
+    slot.recvPaused = false;
+    armRecv(conn);
+}
+
+/**
+ * @brief Handles a completion of a client's multishot recv.
+ *
+ * @details The data is appended to the request buffer and its provided
+ * buffer recycled. Requests are served right away, unless a send is in
+ * flight: handleSend() serves them once the responses are sent. Meanwhile,
+ * a buffer that reaches getReadLimit() pauses the recv (see pauseRecv()),
+ * as epoll stops reading a WRITING connection. The data of a LINGERING
+ * connection is dropped.
+ *
+ * @param conn The client connection, or NULL if the completion is stale.
+ * @param cqe The completion.
+ */
+void Cluster::handleRecv(Connection *conn, const struct io_uring_cqe &cqe) {
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        unsigned short bid =
+            static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if ((conn != NULL) && (cqe.res > 0) &&
+            (conn->state != Connection::LINGERING)) {
+            if (conn->state == Connection::IDLE)
+                conn->state = Connection::READING_HEADERS;
+            conn->requestBuff.append(_ring.getBuffer(bid), cqe.res);
+        }
+        _ring.recycleBuffer(bid);
+    }
+    if ((conn == NULL) || (cqe.res == -ECANCELED))
+        return; // Stale, or ended by pauseRecv()
+    if ((cqe.res < 0) && (cqe.res != -ENOBUFS)) {
+        killConnection(conn->fd, _epollFd); // Reset
+        return;
+    }
+    if (conn->state == Connection::LINGERING) { // Input discarded
+        if (cqe.res == 0)
+            killConnection(conn->fd, _epollFd);
+        else if (!(cqe.flags & IORING_CQE_F_MORE))
+            armRecv(*conn);
+        return;
+    }
+    if (cqe.res == 0) { // Peer closed: serve what was sent, then close
+        conn->peerClosed = true;
+        if (!_uringSlots[getSlotIndex(*conn)].sending)
+            serveRequests(*conn);
+        return;
+    }
+    if ((cqe.res > 0) && !checkRecvRate(*conn, cqe.res))
+        return;
+
+    UringSlot &slot = _uringSlots[getSlotIndex(*conn)];
+    if (!(cqe.flags & IORING_CQE_F_MORE) && !slot.recvPaused)
+        armRecv(*conn); // Out of buffers, or ended
+    if (slot.sending) {
+        if (conn->requestBuff.size() >= getReadLimit(*conn))
+            pauseRecv(*conn); // Until continueSend()
+        return;
+    }
+    if (cqe.res > 0) {
+        int socket = conn->fd;
+        if (!isRequestTooLarge(*conn))
+            serveRequests(*conn);
+        if ((conn->fd != socket) || (conn->state == Connection::WRITING) ||
+            (conn->state == Connection::LINGERING) || !isRequestTooLarge(*conn))
+            return;
+        if (conn->headerLen == 0)
+            rejectRequest(*conn, BAD_REQUEST);
+        else
+            lingerRequest(*conn, PAYLOAD_TOO_LARGE);
+    }
+}
+
+/**
+ * @brief Checks if the buffered request outgrew getReadLimit().
+ *
+ * @details The recv of a ring can not stop at the limit, as readInput()
+ * does: the buffer may go past it. A header block is then too large if it
+ * does not end within the limit, whatever follows it.
+ *
+ * @param conn The client connection.
+ * @return true if the request must be rejected.
+ */
+bool Cluster::isRequestTooLarge(const Connection &conn) const {
+    std::size_t limit = getReadLimit(conn);
+    if (conn.requestBuff.size() <= limit)
+        return (false);
+    if (conn.headerLen > 0)
+        return (true);
+    std::size_t headerEnd = ByteScan::findHeaderEnd(conn.requestBuff.data(),
+                                                    conn.requestBuff.size());
+    return ((headerEnd == std::string::npos) || ((headerEnd + 4) > limit));
+}
+
+/**
+ * @brief Sends the connection's output queue with a single SENDMSG.
+ *
+ * @details The queued responses are gathered, as in flushConnection(). The
+ * iovecs live in the slot until the completion arrives; one send is in
+ * flight at a time and the connection stays WRITING until the queue is
+ * empty. A file body is sent by sendfile() slices, each one once a poll
+ * reports the socket writable.
+ *
+ * @param conn The connection to flush.
+ * @return true: the connection is closed by handleSend() if need be.
+ */
+bool Cluster::submitSend(Connection &conn) {
+    std::size_t idx = getSlotIndex(conn);
+    UringSlot &slot = _uringSlots[idx];
+    if (!slot.sending && conn.isSendingFile()) {
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = static_cast<int>(idx);
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->poll32_events = POLLOUT;
+        sqe->user_data = uringData(URING_SENDFILE, slot.gen, idx);
+        slot.sending = true;
+    } else if (!slot.sending) {
+        std::memset(&slot.msg, '\0', sizeof(slot.msg));
+        slot.msg.msg_iov = slot.iov;
+        bool fileFollows;
+        slot.msg.msg_iovlen =
+            conn.gatherOutput(slot.iov, MAX_IOVECS, fileFollows);
+
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = static_cast<int>(idx);
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot.msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL | (fileFollows ? MSG_MORE : 0);
+        sqe->user_data = uringData(URING_SEND, slot.gen, idx);
+        slot.sending = true;
+    }
+    conn.state = Connection::WRITING;
+    updateTimer(conn); // send_timeout, restarted after each write
+    return (true);
+}
+
+/**
+ * @brief Handles the completion of a send.
+ *
+ * @param conn The client connection.
+ * @param sent The number of bytes sent, or -errno.
+ */
+void Cluster::handleSend(Connection &conn, int sent) {
+    _uringSlots[getSlotIndex(conn)].sending = false;
+    if ((sent == -EAGAIN) || (sent == -EINTR)) {
+        submitSend(conn);
+        return;
+    }
+    if (sent < 0) {
+        killConnection(conn.fd, _epollFd);
+        return;
+    }
+    conn.consumeOutput(static_cast<std::size_t>(sent));
+    if (checkSendRate(conn, static_cast<std::size_t>(sent)))
+        continueSend(conn);
+}
+
+/**
+ * @brief Sends a slice of a file body once the socket is writable.
+ *
+ * @param conn The client connection.
+ * @param events The poll events reported, or -errno.
+ */
+void Cluster::handleSendFile(Connection &conn, int events) {
+    _uringSlots[getSlotIndex(conn)].sending = false;
+    ssize_t sent = (events < 0) ? -1 : sendFileSlice(conn);
+    if ((sent == -1) && (events >= 0) &&
+        ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+        submitSend(conn);
+        return;
+    }
+    if (sent <= 0) {
+        killConnection(conn.fd, _epollFd); // Failed, or file truncated
+        return;
+    }
+    if (checkSendRate(conn, static_cast<std::size_t>(sent)))
+        continueSend(conn);
+}
+
+/**
+ * @brief Follows up on a completed send.
+ *
+ * @details Sends the rest of the queue, if any. Otherwise the connection is
+ * closed if the last response was not keep-alive, or goes back to reading,
+ * serves the pipelined requests received meanwhile and resumes a paused
+ * recv.
+ *
+ * @param conn The client connection.
+ */
+void Cluster::continueSend(Connection &conn) {
+    if (!conn.outQueue.empty()) {
+        submitSend(conn);
+        return;
+    }
+    if (!conn.keepAlive) {
+        killConnection(conn.fd, _epollFd);
+        return;
+    }
+    conn.resumeReading();
+    int socket = conn.fd;
+    serveRequests(conn);
+    if ((conn.fd == socket) && (conn.state != Connection::WRITING))
+        resumeRecv(conn);
+}
+
+/**
+ * @brief Cancels the requests of a client being closed.
+ *
+ * @details Cancels its recv and send, clears its fixed file entry (so that
+ * closing the fd closes the socket) and bumps the slot's generation. An
+ * in-flight send references the output queue: cancelling it does not stop
+ * the kernel if the send has started, so the queue is parked in the slot
+ * until the completion of the send arrives (see handleCompletion()). Its
+ * files are closed at once, as a send never reads them.
+ *
+ * @param conn The client connection, its output queue taken here.
+ */
+void Cluster::cancelConnection(Connection &conn) {
+    static const int noFile = -1;
+    std::size_t idx = getSlotIndex(conn);
+    UringSlot &slot = _uringSlots[idx];
+
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = static_cast<int>(idx);
+    sqe->cancel_flags = (IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_FD_FIXED |
+                         IORING_ASYNC_CANCEL_ALL);
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = uringData(URING_IGNORE, 0, 0);
+
+    sqe = getSqe();
+    sqe->opcode = IORING_OP_FILES_UPDATE;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&noFile);
+    sqe->len = 1;
+    sqe->off = idx;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = uringData(URING_IGNORE, 0, 0);
+
+    if (slot.sending) {
+        std::deque<OutBuffer> &parked = slot.parked[slot.gen];
+        parked.swap(conn.outQueue);
+        std::deque<OutBuffer>::iterator it;
+        for (it = parked.begin(); it != parked.end(); ++it) {
+            if (it->fileFd != -1)
+                close(it->fileFd);
+            it->fileFd = -1;
+        }
+        _ring.submit();
+        slot.sending = false;
+    }
+    slot.gen = ((slot.gen + 1) & URING_GEN_MASK);
+}
+
 /* ************************************************************************** */
 /*                                  Getters */
 /* ************************************************************************** */
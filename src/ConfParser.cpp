@@ -58,6 +58,7 @@ ConfParser &ConfParser::operator=(const ConfParser &src)
 
 	_confFile = src._confFile;
 	_servers = src._servers;
+	_global = src._global;
 	
 	return (*this);
 }
@@ -110,6 +111,7 @@ void ConfParser::loadConf(void)
 #endif
 
 	loadContext(serverBlocks);
+	_global.validate();
 
 	std::stringstream ss;
 	ss << "Loaded " << serverBlocks.size() << " servers";
@@ -204,10 +206,39 @@ std::vector<std::string> ConfParser::getServerBlocks(std::string &file)
 
 	while (file[start])
 	{                       // Loop until end of file
-		identifier = this->getIdentifier(file); // Get server block identifier
-		if (toLower(identifier) != "server")
+		identifier = this->getIdentifier(file.substr(start)); // Get identifier
+		if (identifier.empty())
 			throw std::runtime_error("Invalid server block: no 'server' at "
 									 "start");
+		if (toLower(identifier) == "events")
+		{ // Connection processing block (e.g. events { multi_accept 64; })
+			start += identifier.size();
+			while (std::isspace(file[start])) // Skip spaces
+				++start;
+			if (file[start] != '{')
+				throw std::runtime_error("Invalid events block: no '{' at "
+										 "start");
+			end = getBlockEnd(file, start);
+			loadEventsBlock(file.substr(start + 1, (end - start - 1)));
+			start = (end + 1);                               // Skip '}'
+			while (file[start] && std::isspace(file[start])) // Skip spaces
+				++start;
+			continue;
+		}
+		if (toLower(identifier) != "server")
+		{ // Main context directive (e.g. worker_threads 4;)
+			end = file.find(';', start);
+			if ((end == std::string::npos) ||
+				(file.find('{', start) < end))
+				throw std::runtime_error("Invalid directive in main context: " +
+										 identifier);
+			std::string directive = file.substr(start, (end - start));
+			_global.setDirective(directive);
+			start = (end + 1);                               // Skip ';'
+			while (file[start] && std::isspace(file[start])) // Skip spaces
+				++start;
+			continue;
+		}
 		start += std::strlen(identifier.c_str());
 
 		while (std::isspace(file[start])) // Skip spaces
@@ -271,6 +302,32 @@ size_t ConfParser::getBlockEnd(std::string &file, size_t start)
 	throw std::runtime_error("Invalid server block: no '}' at end");
 }
 
+/**
+ * @brief Loads the directives of the events block into the global config.
+ * @param block The content of the events block, without the braces.
+ * @throws std::runtime_error if the block holds a nested block or an
+ * invalid directive.
+ */
+void ConfParser::loadEventsBlock(const std::string &block)
+{
+#ifdef DEBUG
+	Logger::debug("ConfParser", __func__, "Loading events block: " + block);
+#endif
+
+	if (block.find_first_of("{}") != std::string::npos)
+		throw std::runtime_error("Invalid events block: nested block");
+
+	std::istringstream stream(block);
+	std::string line;
+	while (std::getline(stream, line, ';'))
+	{
+		removeSpaces(line);
+		if (line.empty())
+			continue;
+		_global.setEventsDirective(line);
+	}
+}
+
 /**
  * @brief Loads the context from server blocks.
  * @param blocks The server blocks to load the context from.
@@ -359,6 +416,15 @@ std::vector<Server> ConfParser::getServers(void) const
 	return (_servers);
 }
 
+/**
+ * @brief Retrieves the directives set in the main context.
+ * @return The GlobalConf object.
+ */
+const GlobalConf &ConfParser::getGlobalConf(void) const
+{
+	return (_global);
+}
+
 /**
  * @brief Extracts the identifier from a string.
  * @param str The string to extract the identifier from.
@@ -369,7 +435,7 @@ std::string ConfParser::getIdentifier(const std::string &str)
 	std::string token;
 	for (size_t i = 0; i < str.length(); i++)
 	{
-		if (isalpha(str[i]))
+		if (isalpha(str[i]) || (str[i] == '_'))
 			token += str[i];
 		else
 			break;
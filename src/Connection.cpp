@@ -0,0 +1,641 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Connection.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/03/24 10:14:02 by passunca          #+#    #+#             */
+/*   Updated: 2025/03/24 10:14:02 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup ConnectionModule Connection Module
+ * @{
+ *
+ * Per-client connection state used by the Cluster event loop to keep sockets
+ * open across several HTTP requests (HTTP/1.1 persistent connections).
+ *
+ * @version 1.0
+ */
+
+#include "../inc/Connection.hpp"
+#include "../inc/ByteScan.hpp"
+#include "../inc/Utils.hpp"
+#include <cstring> // std::memchr()
+
+/* ************************************************************************** */
+/*                                 OutBuffer                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs an empty output buffer.
+ */
+OutBuffer::OutBuffer(void) : fileFd(-1), fileOffset(0), fileEnd(0) {}
+
+/**
+ * @brief Gets the number of bytes sent from memory.
+ *
+ * @return The size of the header block and of the in-memory body.
+ */
+std::size_t OutBuffer::size(void) const {
+    return (head.size() + body.size());
+}
+
+/* ************************************************************************** */
+/*                                 RateMeter                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs a meter whose window has not started.
+ */
+RateMeter::RateMeter(void) : start(0), bytes(0) {}
+
+/**
+ * @brief Stops measuring, until the next transfer starts a new window.
+ */
+void RateMeter::reset(void) {
+    start = 0;
+    bytes = 0;
+}
+
+/**
+ * @brief Counts a transfer and checks the rate once the window is over.
+ *
+ * @param nBytes The number of bytes transferred.
+ * @param minRate The minimum rate, in bytes per second, 0 if unchecked.
+ * @param windowMs The window the rate is measured over.
+ * @return false if the window elapsed below minRate, true otherwise.
+ */
+bool RateMeter::update(std::size_t nBytes, std::size_t minRate,
+                       long windowMs) {
+    if (minRate == 0)
+        return (true);
+    uint64_t now = TimerWheel::now();
+    if (start == 0) {
+        start = now;
+        bytes = nBytes;
+        return (true);
+    }
+    bytes += nBytes;
+    uint64_t elapsed = now - start;
+    if (elapsed < static_cast<uint64_t>(windowMs))
+        return (true);
+
+    bool isFastEnough = ((bytes * 1000ULL) >= (minRate * elapsed));
+    start = now;
+    bytes = 0;
+    return (isFastEnough);
+}
+
+/* ************************************************************************** */
+/*                                Constructors                                */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs a free slot of the connection table.
+ */
+Connection::Connection(void)
+    : type(FREE), fd(-1), listenFd(-1), hosts(NULL), admitted(NULL),
+      state(IDLE),
+      scanPos(0), headerLen(0), requestLen(0), chunked(false),
+      chunkState(CHUNK_SIZE), chunkLeft(0), bodyLen(0), framingStatus(OK),
+      mustClose(false), sendContinue(false), nRequests(0), keepAlive(true),
+      peerClosed(false), peerIp(0), ipCounted(false), outOffset(0), events(0),
+      timerState(IDLE),
+      server(NULL), hasContext(false) {}
+
+/**
+ * @brief Constructs the state of a freshly accepted client socket.
+ *
+ * @param socket The client socket file descriptor.
+ */
+Connection::Connection(int socket)
+    : type(CLIENT), fd(socket), listenFd(-1), hosts(NULL), admitted(NULL),
+      state(READING_HEADERS), scanPos(0), headerLen(0), requestLen(0),
+      chunked(false), chunkState(CHUNK_SIZE), chunkLeft(0), bodyLen(0),
+      framingStatus(OK), mustClose(false), sendContinue(false), nRequests(0),
+      keepAlive(true), peerClosed(false), peerIp(0), ipCounted(false),
+      outOffset(0), events(CLIENT_READ_EVENTS),
+      timerState(IDLE),
+      server(NULL), hasContext(false) {
+    timer.fd = socket;
+}
+
+/* ************************************************************************** */
+/*                                    Slot                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Returns the slot to its free state.
+ *
+ * @details Cancels the timeout and drops the buffered data, so a slot reused
+ * for another client starts clean.
+ */
+void Connection::release(void) {
+    if (timer.wheel != NULL)
+        timer.wheel->cancel(timer);
+    while (!outQueue.empty()) // Close the file bodies not sent
+        popOutput();
+    response.reset();
+    *this = Connection();
+}
+
+/* ************************************************************************** */
+/*                                   State                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Sets the reading state matching what is left in requestBuff.
+ *
+ * @details Called once the queued responses are sent: the buffer may already
+ * hold the start (or the whole header block) of a pipelined request, as
+ * framed by frameRequest(). Both rate windows restart: the time spent
+ * writing is not held against the receive rate, nor the time spent
+ * waiting for the next request against the send rate.
+ */
+void Connection::resumeReading(void) {
+    recvRate.reset();
+    sendRate.reset();
+    if (requestBuff.empty())
+        state = IDLE;
+    else if (headerLen > 0)
+        state = READING_BODY;
+    else
+        state = READING_HEADERS;
+}
+
+/* ************************************************************************** */
+/*                                   Input                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Drains the socket into requestBuff.
+ *
+ * @details Reads until recv() comes back short or fails with EAGAIN, as the
+ * socket is edge-triggered: data left in the kernel would not be reported
+ * again. The buffer is read into directly, with no intermediate copy. It
+ * starts at initialSize and doubles when full; once the length of the
+ * request is known, it is allocated at once. It never grows past maxSize.
+ *
+ * @param initialSize The capacity of an empty buffer.
+ * @param maxSize The size past which no more data is read.
+ * @return Why reading stopped.
+ */
+Connection::ReadStatus Connection::readInput(std::size_t initialSize,
+                                             std::size_t maxSize) {
+    if ((requestLen > requestBuff.capacity()) && (requestLen <= maxSize))
+        requestBuff.reserve(requestLen); // Body length known
+    while (requestBuff.size() < maxSize) {
+        std::size_t used = requestBuff.size();
+        if (used == requestBuff.capacity())
+            requestBuff.reserve(std::min(std::max(used * 2, initialSize),
+                                         maxSize));
+        std::size_t room = std::min(requestBuff.capacity(), maxSize) - used;
+        room = std::min(room, static_cast<std::size_t>(READ_CHUNK_SIZE));
+
+        requestBuff.resize(used + room);
+        ssize_t nRead = recv(fd, &requestBuff[used], room, 0);
+        requestBuff.resize(used + ((nRead > 0) ? nRead : 0));
+        if (nRead == 0)
+            return (READ_CLOSED);
+        if (nRead < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return (READ_DRAINED);
+            return (READ_ERROR);
+        }
+        if (static_cast<std::size_t>(nRead) < room)
+            return (READ_DRAINED); // Short read: the socket is empty
+    }
+    return (READ_FULL);
+}
+
+/* ************************************************************************** */
+/*                                  Framing                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Checks a header block for a line ending other than CRLF.
+ *
+ * @param buf The header block, ending with "\r\n\r\n".
+ * @param len Its length.
+ * @return true if a LF is not preceded by a CR, or a CR not followed by a LF.
+ */
+static bool hasBareLineEnd(const char *buf, std::size_t len) {
+    const char *end = buf + len;
+    const char *p = buf;
+    while ((p = static_cast<const char *>(std::memchr(p, '\n', end - p)))) {
+        if ((p == buf) || (p[-1] != '\r'))
+            return (true);
+        ++p;
+    }
+    p = buf;
+    while ((p = static_cast<const char *>(std::memchr(p, '\r', end - p)))) {
+        if (((p + 1) == end) || (p[1] != '\n'))
+            return (true);
+        ++p;
+    }
+    return (false);
+}
+
+/**
+ * @brief Finds the boundary of the next request in requestBuff.
+ *
+ * @details Resumable: scanPos remembers how far the buffer was framed, so
+ * each received byte is examined once (the header terminator search backs
+ * up 3 bytes to catch a `\r\n\r\n` split across two reads). Once the
+ * header block is complete, its length and the expected body length are
+ * kept until consumeRequest().
+ *
+ * A chunked body is decoded in place as it arrives (see frameChunkedBody()),
+ * so the framed request is the header block followed by the plain body. A
+ * malformed one frames what was decoded and sets framingStatus, so that the
+ * request is answered with an error and the connection closed.
+ *
+ * The parser also ends lines on a bare LF, which the framer does not: a
+ * header block with a bare LF or CR is rejected the same way, before its
+ * body framing is read, so the two never see different fields.
+ *
+ * @return true if requestLen bytes form a complete request, false if more
+ * data is needed.
+ */
+bool Connection::frameRequest(void) {
+    if (headerLen == 0) {
+        if (scanPos == 0) { // Empty lines before the request line are ignored
+            std::size_t start = requestBuff.find_first_not_of("\r\n");
+            requestBuff.erase(0, std::min(start, requestBuff.size()));
+        }
+        std::size_t from = (scanPos > 3) ? (scanPos - 3) : 0;
+        std::size_t headerEnd = ByteScan::findHeaderEnd(
+            requestBuff.data() + from, requestBuff.size() - from);
+        if (headerEnd == std::string::npos) {
+            scanPos = requestBuff.size();
+            return (false); // Incomplete Headers
+        }
+        headerLen = (from + headerEnd + 4);
+        scanPos = headerLen;
+        state = READING_BODY;
+        if (hasBareLineEnd(requestBuff.data(), headerLen))
+            framingStatus = BAD_REQUEST; // The parser would split it otherwise
+        setBodyFraming();
+    }
+    if (chunked && (requestLen == 0))
+        frameChunkedBody();
+    return ((requestLen > 0) && (requestBuff.size() >= requestLen));
+}
+
+/**
+ * @brief Drops the framed request from requestBuff and restarts framing.
+ *
+ * @details A buffer grown for a large body is freed once it is empty, so
+ * idle persistent connections stay small.
+ */
+void Connection::consumeRequest(void) {
+    requestBuff.erase(0, requestLen);
+    if (requestBuff.empty() && (requestBuff.capacity() > READ_CHUNK_SIZE))
+        std::string().swap(requestBuff); // Give back the memory of a body
+    resetFraming();
+}
+
+/**
+ * @brief Forgets the framing state of the current request.
+ */
+void Connection::resetFraming(void) {
+    scanPos = 0;
+    headerLen = 0;
+    requestLen = 0;
+    chunked = false;
+    chunkState = CHUNK_SIZE;
+    chunkLeft = 0;
+    bodyLen = 0;
+    framingStatus = OK;
+    mustClose = false;
+    sendContinue = false;
+}
+
+/**
+ * @brief Points an iovec at a buffer, past the bytes already sent.
+ *
+ * @param iov The iovecs to fill.
+ * @param nIov The number of iovecs filled, incremented if one is added.
+ * @param buf The buffer.
+ * @param skip The bytes already sent, decremented by those of buf.
+ */
+static void addIovec(struct iovec *iov, std::size_t &nIov,
+                     const std::string &buf, std::size_t &skip) {
+    if (skip >= buf.size()) {
+        skip -= buf.size();
+        return;
+    }
+    iov[nIov].iov_base = const_cast<char *>(buf.data() + skip);
+    iov[nIov].iov_len = (buf.size() - skip);
+    skip = 0;
+    ++nIov;
+}
+
+/**
+ * @brief Points iovecs at the in-memory bytes of the output queue.
+ *
+ * @details Each response takes up to two iovecs, its header block and its
+ * body, which are sent from where they were built. Stops after the header
+ * block of a response with a file body: the body must follow before the
+ * next response, so the caller should send with MSG_MORE to have the
+ * headers leave in the same segment as the start of the file.
+ *
+ * @param iov The iovecs to fill.
+ * @param maxIov The number of iovecs available, at least 2.
+ * @param fileFollows Set if a file body follows the gathered bytes.
+ * @return The number of iovecs filled.
+ */
+std::size_t Connection::gatherOutput(struct iovec *iov, std::size_t maxIov,
+                                     bool &fileFollows) const {
+    std::size_t nIov = 0;
+    std::size_t skip = outOffset;
+    fileFollows = false;
+    std::deque<OutBuffer>::const_iterator it = outQueue.begin();
+    for (; (it != outQueue.end()) && (nIov + 2 <= maxIov); ++it) {
+        addIovec(iov, nIov, it->head, skip);
+        addIovec(iov, nIov, it->body, skip);
+        if (it->fileFd != -1) {
+            fileFollows = true;
+            break;
+        }
+    }
+    return (nIov);
+}
+
+/**
+ * @brief Drops the in-memory bytes sent from the output queue.
+ *
+ * @details A response sent in part stays at the front of the queue, with
+ * outOffset past its sent bytes. So does a response whose file body is
+ * still to be sent.
+ *
+ * @param sent The number of bytes the socket accepted.
+ */
+void Connection::consumeOutput(std::size_t sent) {
+    while (sent > 0) {
+        std::size_t pending = (outQueue.front().size() - outOffset);
+        if (sent < pending) {
+            outOffset += sent;
+            return;
+        }
+        sent -= pending;
+        outOffset += pending;
+        if (outQueue.front().fileFd != -1)
+            return; // The file body follows
+        popOutput();
+    }
+}
+
+/**
+ * @brief Checks if the file body of the front response is being sent.
+ *
+ * @return true if its header block is sent and its file body is not.
+ */
+bool Connection::isSendingFile(void) const {
+    return (!outQueue.empty() && (outQueue.front().fileFd != -1) &&
+            (outOffset == outQueue.front().size()));
+}
+
+/**
+ * @brief Removes the front response of the output queue, closing its file.
+ */
+void Connection::popOutput(void) {
+    if (outQueue.front().fileFd != -1)
+        close(outQueue.front().fileFd);
+    outQueue.pop_front();
+    outOffset = 0;
+}
+
+/**
+ * @brief Parses a Content-Length value: 1*DIGIT.
+ *
+ * @param value The field value, trimmed.
+ * @param length Receives the length.
+ * @return false if the value is not a number or overflows.
+ */
+static bool parseContentLength(const StrView &value, std::size_t &length) {
+    length = 0;
+    if (value.empty())
+        return (false);
+    for (std::size_t i = 0; i < value.size; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(value[i])))
+            return (false);
+        std::size_t digit = static_cast<std::size_t>(value[i] - '0');
+        if (length > ((static_cast<std::size_t>(-1) - digit) / 10))
+            return (false);
+        length = (length * 10) + digit;
+    }
+    return (true);
+}
+
+/**
+ * @brief Reads the body framing from the header block.
+ *
+ * @details Transfer-Encoding takes precedence over Content-Length (RFC 9112,
+ * 6.3): chunked must then be its final coding. Without either, the request
+ * has no body. A length that can not be trusted (an invalid or conflicting
+ * Content-Length, or a Transfer-Encoding not ending with chunked) frames the
+ * header block alone and sets framingStatus: the request is answered with an
+ * error and the connection closed, so that the bytes after it are never
+ * taken for a request. A request with both headers is closed after its
+ * response too (RFC 9112, 6.1).
+ */
+void Connection::setBodyFraming(void) {
+    if (framingStatus != OK) { // The header block itself was rejected
+        mustClose = true;
+        requestLen = headerLen;
+        return;
+    }
+    std::size_t contentLength = 0;
+    bool hasLength = false;
+    bool hasEncoding = false;
+    const char *buf = requestBuff.data();
+    // Skip the request line
+    std::size_t lineStart = ByteScan::findCrlf(buf, headerLen) + 2;
+    while (lineStart < (headerLen - 2)) {
+        std::size_t lineEnd =
+            lineStart +
+            ByteScan::findCrlf(buf + lineStart, headerLen - lineStart);
+        StrView line(buf + lineStart, lineEnd - lineStart);
+        std::size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            HeaderId id = HeaderTable::lookup(line.substr(0, colon));
+            StrView value = line.substr(colon + 1).trim();
+            if (id == HDR_TRANSFER_ENCODING) {
+                hasEncoding = true; // The last coding of the last field
+                std::size_t comma = value.rfind(',');
+                StrView last = (comma == std::string::npos)
+                                   ? value
+                                   : value.substr(comma + 1).trim();
+                chunked = last.iequals("chunked");
+            } else if (id == HDR_CONTENT_LENGTH) {
+                std::size_t length = 0;
+                if (!parseContentLength(value, length) ||
+                    (hasLength && (length != contentLength)))
+                    framingStatus = BAD_REQUEST;
+                contentLength = length;
+                hasLength = true;
+            }
+        }
+        lineStart = (lineEnd + 2);
+    }
+    if (contentLength > (static_cast<std::size_t>(-1) - headerLen))
+        framingStatus = BAD_REQUEST; // requestLen would wrap around
+    if (hasEncoding) {
+        mustClose = hasLength;
+        framingStatus = chunked ? OK : BAD_REQUEST;
+    }
+    if (framingStatus != OK) {
+        chunked = false;
+        mustClose = true;
+        requestLen = headerLen;
+    } else if (!chunked)
+        requestLen = (headerLen + contentLength);
+}
+
+/**
+ * @brief Parses a chunk-size line: 1*HEXDIG, then optional extensions.
+ *
+ * @param line The line, without its CRLF.
+ * @param size Receives the chunk size.
+ * @return false if the line is malformed or the size overflows.
+ */
+static bool parseChunkSize(const StrView &line, std::size_t &size) {
+    std::size_t i = 0;
+    size = 0;
+    for (; (i < line.size) && std::isxdigit(
+                                  static_cast<unsigned char>(line[i]));
+         ++i) {
+        if (size > (static_cast<std::size_t>(-1) >> 4))
+            return (false);
+        char c = std::tolower(static_cast<unsigned char>(line[i]));
+        size = (size << 4) | ((c <= '9') ? (c - '0') : (c - 'a' + 10));
+    }
+    if (i == 0)
+        return (false);
+    while ((i < line.size) && ((line[i] == ' ') || (line[i] == '\t')))
+        ++i; // BWS
+    return ((i == line.size) || (line[i] == ';')); // Extensions are ignored
+}
+
+/**
+ * @brief Decodes the chunks received so far, in place.
+ *
+ * @details Resumable at any byte: chunkState and chunkLeft say where the
+ * decoder stands. Chunk data is moved down to the end of the decoded body
+ * and the framing dropped, so requestBuff holds the header block, the body
+ * decoded so far and the bytes not decoded yet; its size, which the read
+ * limit bounds, tracks the decoded size and not the size on the wire.
+ *
+ * Trailer fields are checked and discarded (RFC 9110, 6.5.1): nothing here
+ * consumes them. Sets requestLen once the empty line after the last chunk
+ * is found, or framingStatus if the framing is malformed.
+ */
+void Connection::frameChunkedBody(void) {
+    std::size_t bodyEnd = (headerLen + bodyLen);
+    bool done = false;
+    while (!done && (framingStatus == OK)) {
+        char *buf = &requestBuff[0];
+        std::size_t avail = (requestBuff.size() - scanPos);
+        if (chunkState == CHUNK_DATA) {
+            std::size_t n = std::min(chunkLeft, avail);
+            if (n == 0)
+                break;
+            if (bodyEnd != scanPos)
+                std::memmove(buf + bodyEnd, buf + scanPos, n);
+            bodyEnd += n;
+            scanPos += n;
+            if ((chunkLeft -= n) == 0)
+                chunkState = CHUNK_DATA_END;
+            continue;
+        }
+        if (chunkState == CHUNK_DATA_END) {
+            if (avail < 2)
+                break;
+            if ((buf[scanPos] != '\r') || (buf[scanPos + 1] != '\n'))
+                framingStatus = BAD_REQUEST;
+            scanPos += 2;
+            chunkState = CHUNK_SIZE;
+            continue;
+        }
+        std::size_t lineLen = ByteScan::findCrlf(buf + scanPos, avail);
+        if (lineLen == std::string::npos)
+            break; // Incomplete line
+        StrView line(buf + scanPos, lineLen);
+        scanPos += (lineLen + 2);
+        if (chunkState == CHUNK_SIZE) {
+            if (!parseChunkSize(line, chunkLeft))
+                framingStatus = BAD_REQUEST;
+            chunkState = (chunkLeft == 0) ? CHUNK_TRAILER : CHUNK_DATA;
+        } else if (line.empty()) // CHUNK_TRAILER: the empty line ends them
+            done = true;
+        else {
+            std::size_t colon = ByteScan::findNonToken(line.data, line.size);
+            if ((colon == std::string::npos) || (colon == 0) ||
+                (line[colon] != ':'))
+                framingStatus = BAD_REQUEST;
+        }
+    }
+    requestBuff.erase(bodyEnd, scanPos - bodyEnd); // Drop the framing
+    scanPos = bodyEnd;
+    bodyLen = (bodyEnd - headerLen);
+    if (framingStatus != OK)
+        mustClose = true;
+    if (done || (framingStatus != OK))
+        requestLen = bodyEnd;
+}
+
+/* ************************************************************************** */
+/*                                 Keep-alive                                 */
+/* ************************************************************************** */
+
+/**
+ * @brief Checks if the client asked for the connection to persist.
+ *
+ * @details HTTP/1.1 connections are persistent unless the client sends
+ * `Connection: close`. HTTP/1.0 (and 0.9) connections are closed unless the
+ * client explicitly sends `Connection: keep-alive`.
+ *
+ * @param request The parsed HTTP request.
+ * @return true if the connection should be kept open, false otherwise.
+ */
+bool Connection::isKeepAliveRequested(const HttpRequest &request) {
+    if (request.hasHeaderToken(HDR_CONNECTION, "close"))
+        return (false);
+    return (request.protocolVersion.equals("HTTP/1.1") ||
+            request.hasHeaderToken(HDR_CONNECTION, "keep-alive"));
+}
+
+/* ************************************************************************** */
+/*                                 Overloads                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Converts a connection state to its printable name.
+ *
+ * @param state The connection state.
+ * @return The name of the state.
+ */
+std::string connState2string(Connection::State state) {
+    switch (state) {
+    case Connection::READING_HEADERS:
+        return ("READING_HEADERS");
+    case Connection::READING_BODY:
+        return ("READING_BODY");
+    case Connection::WRITING:
+        return ("WRITING");
+    case Connection::IDLE:
+        return ("IDLE");
+    case Connection::LINGERING:
+        return ("LINGERING");
+    default:
+        return ("UNKNOWN");
+    }
+}
+
+/** @} */
@@ -0,0 +1,226 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConnectionLimit.cpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/02 11:20:37 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/02 11:20:37 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup ConnectionLimitModule Connection Limit Module
+ * @{
+ *
+ * max_connections admission control shared by the worker threads and
+ * processes, used by the Cluster to shed load with a fast 503.
+ *
+ * @version 1.0
+ */
+
+#include "../inc/ConnectionLimit.hpp"
+
+std::vector<ConnectionLimit::Counter *> ConnectionLimit::_counters;
+std::size_t ConnectionLimit::_slot = 0;
+
+/* ************************************************************************** */
+/*                          Constructors & Destructor                         */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs an unlimited connection limit.
+ */
+ConnectionLimit::ConnectionLimit(void) : _high(0), _low(0), _counter(NULL) {}
+
+/**
+ * @brief Copy constructor: the copy shares the original's counter.
+ *
+ * @param copy The limit to copy from.
+ */
+ConnectionLimit::ConnectionLimit(const ConnectionLimit &copy)
+    : _high(copy._high), _low(copy._low), _counter(copy._counter) {}
+
+/**
+ * @brief Destructor.
+ *
+ * @details The shared counter is never unmapped: copies live in every
+ * Cluster and worker until the process exits.
+ */
+ConnectionLimit::~ConnectionLimit(void) {}
+
+/* ************************************************************************** */
+/*                                 Operators                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Assignment operator: shares the source's counter.
+ *
+ * @param src The limit to assign from.
+ * @return A reference to this limit.
+ */
+ConnectionLimit &ConnectionLimit::operator=(const ConnectionLimit &src) {
+    if (this == &src)
+        return (*this);
+    _high = src._high;
+    _low = src._low;
+    _counter = src._counter;
+    return (*this);
+}
+
+/* ************************************************************************** */
+/*                                  Getters                                   */
+/* ************************************************************************** */
+
+/// @brief Checks if max_connections was set.
+/// @return true if connections are counted, false if unlimited.
+bool ConnectionLimit::isSet(void) const { return (_counter != NULL); }
+
+/// @brief Returns the count at which new connections start being shed.
+/// @return The high watermark, 0 if unlimited.
+std::size_t ConnectionLimit::getHighWatermark(void) const { return (_high); }
+
+/// @brief Returns the count below which new connections are accepted again.
+/// @return The low watermark, 0 if unlimited.
+std::size_t ConnectionLimit::getLowWatermark(void) const { return (_low); }
+
+/* ************************************************************************** */
+/*                                  Setters                                   */
+/* ************************************************************************** */
+
+/// @brief Sets the watermarks from a max_connections directive.
+/// @details `max_connections high [low];` The low watermark defaults to
+/// LOW_WATERMARK_PERCENT of the high one. The shared counter is mapped here,
+/// while the configuration is loaded, before any worker is started.
+/// @param tks The tokens of the max_connections directive.
+/// @throw std::runtime_error if the directive is invalid or repeated.
+void ConnectionLimit::setWatermarks(std::vector<std::string> &tks) {
+    if ((tks.size() < 2) || (tks.size() > 3))
+        throw std::runtime_error("Invalid max_connections directive");
+    if (_counter != NULL)
+        throw std::runtime_error("max_connections already set");
+
+    char *end = NULL;
+    long high = std::strtol(tks[1].c_str(), &end, 10);
+    if ((*end != '\0') || (high < 1))
+        throw std::runtime_error("Invalid max_connections directive: " +
+                                 tks[1]);
+    long low = ((high * LOW_WATERMARK_PERCENT) / 100);
+    if (tks.size() == 3) {
+        low = std::strtol(tks[2].c_str(), &end, 10);
+        if ((*end != '\0') || (low < 0) || (low > high))
+            throw std::runtime_error("Invalid max_connections low watermark: " +
+                                     tks[2]);
+    }
+
+    void *shared = mmap(NULL, sizeof(Counter), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+        throw std::runtime_error("Failed to map shared connection counter: " +
+                                 std::string(std::strerror(errno)));
+    _counter = static_cast<Counter *>(shared); // Zero-filled
+    _counters.push_back(_counter);
+    _high = static_cast<std::size_t>(high);
+    _low = static_cast<std::size_t>(low);
+}
+
+/* ************************************************************************** */
+/*                                 Admission                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Counts a new connection, unless the limit sheds it.
+ *
+ * @details The check and the increment are a single compare-and-swap, so
+ * concurrent workers never overshoot the high watermark.
+ *
+ * @return true if the connection is admitted (and counted), false if it
+ * must be shed.
+ */
+bool ConnectionLimit::acquire(void) const {
+    if (_counter == NULL)
+        return (true);
+
+    std::size_t current = _counter->count;
+    while (true) {
+        if (_counter->shedding) {
+            if (current >= _low)
+                return (false);
+            if (__sync_bool_compare_and_swap(&_counter->shedding, 1, 0))
+                Logger::info("Connections below max_connections low "
+                             "watermark: accepting again");
+        }
+        if (current >= _high) {
+            if (__sync_bool_compare_and_swap(&_counter->shedding, 0, 1))
+                Logger::warn("max_connections reached: shedding new "
+                             "connections");
+            return (false);
+        }
+        std::size_t seen = __sync_val_compare_and_swap(&_counter->count,
+                                                       current, current + 1);
+        if (seen == current) {
+            __sync_fetch_and_add(&_counter->share[_slot], 1);
+            return (true);
+        }
+        current = seen;
+    }
+}
+
+/**
+ * @brief Uncounts a connection admitted by acquire().
+ */
+void ConnectionLimit::release(void) const {
+    if (_counter == NULL)
+        return;
+    __sync_fetch_and_sub(&_counter->share[_slot], 1);
+    std::size_t current = _counter->count;
+    while (current > 0) {
+        std::size_t seen = __sync_val_compare_and_swap(&_counter->count,
+                                                       current, current - 1);
+        if (seen == current)
+            return;
+        current = seen;
+    }
+}
+
+/* ************************************************************************** */
+/*                              Worker processes                              */
+/* ************************************************************************** */
+
+/**
+ * @brief Sets the share the connections of this process are counted in.
+ *
+ * @details Called by a forked worker process, with its index among the
+ * workers. Worker threads of a single process all count in slot 0.
+ *
+ * @param slot The worker index, below MAX_WORKERS.
+ */
+void ConnectionLimit::setWorkerSlot(std::size_t slot) { _slot = slot; }
+
+/**
+ * @brief Takes back the connections of a worker process that died.
+ *
+ * @details Called by the master before the worker is restarted: the
+ * connections the worker held are gone, but it could not release them.
+ * Its share is dropped from every limit.
+ *
+ * @param slot The index of the dead worker.
+ */
+void ConnectionLimit::resetWorkerSlot(std::size_t slot) {
+    std::vector<Counter *>::const_iterator it;
+    for (it = _counters.begin(); it != _counters.end(); ++it) {
+        Counter *counter = *it;
+        std::size_t share = __sync_fetch_and_and(&counter->share[slot], 0);
+        std::size_t current = counter->count;
+        while (share > 0) {
+            std::size_t next = (current > share) ? (current - share) : 0;
+            std::size_t seen =
+                __sync_val_compare_and_swap(&counter->count, current, next);
+            if (seen == current)
+                break;
+            current = seen;
+        }
+    }
+}
+/** @} */
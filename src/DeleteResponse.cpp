@@ -23,12 +23,11 @@
 /* ************************************************************************** */
 
 /**
- * @brief Constructs a DeleteResponse object.
- * @param server Reference to the server configuration.
- * @param request Reference to the HTTP request.
+ * @brief Constructs an unbound DeleteResponse object.
+ *
+ * It is bound to a request with reset() before each use.
  */
-DeleteResponse::DeleteResponse(const Server &server, const HttpRequest &request)
-    : AResponse(server, request, OK) {}
+DeleteResponse::DeleteResponse() : AResponse() {}
 
 /**
  * @brief Copy constructor for DeleteResponse.
@@ -48,7 +47,7 @@ DeleteResponse::~DeleteResponse() {}
 
 /**
  * @brief Generates the HTTP response for a DELETE request.
- * @return A string representing the HTTP response.
+ * @return The header block of the HTTP response.
  */
 std::string DeleteResponse::generateResponse() {
     setLocationRoute();
@@ -74,8 +73,8 @@ std::string DeleteResponse::generateResponse() {
             return getErrorPage(); // non-empty directory
 		}
     }
-    _response.status = NO_CONTENT; // Nginx status upon successfull deletion
-    return (getResponseStr());
+    _response->status = NO_CONTENT; // Nginx status upon successfull deletion
+    return (getHeaderStr());
 }
 
 /**
@@ -116,7 +115,7 @@ short DeleteResponse::deleteFile(const std::string &path) {
             return (FORBIDDEN);
         return (INTERNAL_SERVER_ERROR);
     } else {
-        storageSize -= fileSize;
+        releaseStorage(fileSize);
         return (OK);
     }
 }
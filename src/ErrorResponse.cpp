@@ -26,19 +26,12 @@
 /* ************************************************************************** */
 
 /**
- * @brief Constructs an ErrorResponse object.
+ * @brief Constructs an unbound ErrorResponse object.
  *
- * Initializes the ErrorResponse with the given server configuration, HTTP
- * request, and error status code.
- *
- * @param server The server configuration.
- * @param request The HTTP request that triggered the error.
- * @param errorStatus The HTTP error status code.
+ * The error status to answer is given to reset(), with the request that
+ * triggered it.
  */
-
-ErrorResponse::ErrorResponse(const Server &server, const HttpRequest &request,
-                             short errorStatus)
-    : AResponse(server, request, errorStatus) {}
+ErrorResponse::ErrorResponse() : AResponse() {}
 
 /**
  * @brief Copy constructor.
@@ -64,10 +57,9 @@ ErrorResponse::~ErrorResponse() {}
 /**
  * @brief Generates the error response.
  *
- * Constructs and returns a string representing the error page corresponding to
- * the error status.
+ * Loads the error page corresponding to the error status as the body.
  *
- * @return A string containing the error page.
+ * @return The header block of the error response.
  */
 std::string ErrorResponse::generateResponse() {
     return getErrorPage();
@@ -31,15 +31,11 @@
 /* ************************************************************************** */
 
 /**
- * @brief Constructs a GetResponse object.
+ * @brief Constructs an unbound GetResponse object.
  *
- * Initializes a GetResponse object using the provided server and HTTP request.
- *
- * @param server The server configuration used for the response.
- * @param request The HTTP request to be processed.
+ * It is bound to a request with reset() before each use.
  */
-GetResponse::GetResponse(const Server &server, const HttpRequest &request)
-    : AResponse(server, request, OK) {};
+GetResponse::GetResponse() : AResponse() {}
 
 /**
  * @brief Copy constructor for GetResponse.
@@ -67,9 +63,10 @@ GetResponse::~GetResponse() {}
  * This method checks if the request is for a CGI script or a regular file.
  * It handles the "If-Modified-Since" header to determine if the file has been
  * modified since the last request. If the file is not modified, it returns
- * a NOT_MODIFIED status. Otherwise, it loads the file content into the response
- * body and sets the appropriate headers, including content disposition for
- * downloads.
+ * a NOT_MODIFIED status. Otherwise, it sets the appropriate headers, including
+ * content disposition for downloads. Files of SENDFILE_MIN_SIZE or more are
+ * kept open and sent with sendfile() after the headers (see takeFile());
+ * smaller ones are loaded into the response body.
  *
  * @param path The path to the file to be loaded.
  * @return A status code indicating the result of the operation.
@@ -80,31 +77,31 @@ GetResponse::~GetResponse() {}
  */
 short GetResponse::loadFile(std::string &path) {
     if (isCGI()) {
-        std::string root = _server.getRoot(_locationRoute);
+        std::string root = _server->getRoot(_locationRoute);
         CGI cgi(
-            _request,
-            _response,
+            *_request,
+            *_response,
             root,
             path
         );
         if ((_status = cgi.generateResponse()) != OK)
             getErrorPage();
     } else {
-        std::ifstream file(path.c_str());
-        if (!file.is_open())
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
             return (INTERNAL_SERVER_ERROR);
 
         // Check for "If-Modified-Since Header"
-        std::multimap<std::string, std::string> headers = _request.headers;
-        std::multimap<std::string, std::string>::iterator it;
-        it = headers.find("If-Modified-Since");
-        if (it != headers.end()) {
+        const StrView *since = _request->getHeader(HDR_IF_MODIFIED_SINCE);
+        if (since != NULL) {
             std::string lastModified = getLastModifiedDate(path);
             try {
-                time_t requestTime = getTime(it->second);
+                time_t requestTime = getTime(since->str());
                 time_t fileTime = getTime(lastModified);
-                if (requestTime <= fileTime)
+                if ((requestTime != -1) && (fileTime <= requestTime)) {
+                    close(fd);
                     return (NOT_MODIFIED);
+                }
             } catch (const std::exception &e) {
                 // Log error parsing the date
                 std::stringstream s;
@@ -112,21 +109,30 @@ short GetResponse::loadFile(std::string &path) {
                 Logger::error(s.str());
             }
         }
-        // Load file content into the response body
-        _response.body.assign((std::istreambuf_iterator<char>(file)),
-                              (std::istreambuf_iterator<char>()));
-        file.close();
+        // Stream the file body, or load it if small
+        struct stat st;
+        if ((fstat(fd, &st) == -1) || !S_ISREG(st.st_mode)) {
+            close(fd);
+            return (INTERNAL_SERVER_ERROR);
+        }
+        if (st.st_size >= static_cast<off_t>(SENDFILE_MIN_SIZE)) {
+            _response->fileFd = fd;
+            _response->fileSize = st.st_size;
+        } else if (!readFile(fd, st.st_size)) {
+            close(fd);
+            return (INTERNAL_SERVER_ERROR);
+        } else
+            close(fd);
 
         // Check for specific download path pattern
-        if (_request.uri.compare(0, 10, "/download/") == 0 ||
-            _request.uri == "/download") {
-            size_t lastSlash = _request.uri.find_last_of('/');
-            std::string filename = _request.uri.substr(lastSlash + 1);
+        if (_request->uri.compare(0, 10, "/download/") == 0 ||
+            _request->uri == "/download") {
+            size_t lastSlash = _request->uri.find_last_of('/');
+            std::string filename = _request->uri.substr(lastSlash + 1);
             if (filename.empty())
                 filename = "download";
-            _response.headers.insert(std::make_pair(
-                std::string("Content-Disposition"),
-                std::string("attachment; filename=\"" + filename + "\"")));
+            _response->setHeader(HDR_CONTENT_DISPOSITION,
+                                 "attachment; filename=\"" + filename + "\"");
         }
         setMimeType(path);
     }
@@ -134,6 +140,28 @@ short GetResponse::loadFile(std::string &path) {
     return (_status);
 }
 
+/**
+ * @brief Reads a small file into the response body.
+ *
+ * @param fd The open file.
+ * @param size The size of the file.
+ * @return true on success, false if the file could not be read.
+ */
+bool GetResponse::readFile(int fd, off_t size) {
+    _response->body.resize(static_cast<std::size_t>(size));
+    std::size_t done = 0;
+    while (done < _response->body.size()) {
+        ssize_t nRead = read(fd, &_response->body[done],
+                             _response->body.size() - done);
+        if ((nRead == -1) && (errno == EINTR))
+            continue;
+        if (nRead <= 0)
+            return (false);
+        done += static_cast<std::size_t>(nRead);
+    }
+    return (true);
+}
+
 /**
  * @brief Generates the HTTP response based on the request and server
  * configuration.
@@ -141,14 +169,14 @@ short GetResponse::loadFile(std::string &path) {
  * This method processes the HTTP request to generate an appropriate response.
  * It first sets the location route and checks the HTTP method for validity.
  * If the method is not allowed, it returns an error page. If a redirect is
- * required, it loads the redirect information and returns the response string.
+ * required, it loads the redirect information and returns the header block.
  * The method then determines the file path and checks its validity. If the
  * path is a file, it loads the file content. If the path is a directory, it
  * attempts to load an index file or generate a directory listing if auto-index
  * is enabled. If none of these conditions are met, it returns a forbidden error
  * page.
  *
- * @return A string containing the generated HTTP response.
+ * @return The header block of the generated HTTP response.
  */
 std::string GetResponse::generateResponse() {
     setLocationRoute();
@@ -156,7 +184,7 @@ std::string GetResponse::generateResponse() {
         return getErrorPage();
     if (hasReturn()) {
         loadReturn();
-        return (getResponseStr());
+        return (getHeaderStr());
     }
     std::string path = getPath();
 
@@ -180,7 +208,7 @@ std::string GetResponse::generateResponse() {
             return getErrorPage();
         }
     }
-    return (getResponseStr());
+    return (getHeaderStr());
 }
 
 /** @} */
\ No newline at end of file
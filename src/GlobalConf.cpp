@@ -0,0 +1,320 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   GlobalConf.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/03/26 09:41:17 by passunca          #+#    #+#             */
+/*   Updated: 2025/03/26 09:41:17 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/GlobalConf.hpp"
+#include "../inc/ConfParser.hpp"
+
+/* ************************************************************************** */
+/*                                Constructors                                */
+/* ************************************************************************** */
+
+/**
+ * @brief Default constructor: a single worker thread in a single process.
+ */
+GlobalConf::GlobalConf(void)
+    : _workerThreads(1), _workerProcesses(1),
+      _multiAccept(DEFAULT_MULTI_ACCEPT),
+      _workerConnections(DEFAULT_WORKER_CONNECTIONS),
+      _epollBatch(DEFAULT_EPOLL_BATCH), _useIoUring(false) {
+    initDirectiveMap();
+}
+
+/**
+ * @brief Copy constructor for the GlobalConf class.
+ * @param copy The GlobalConf object to copy from.
+ */
+GlobalConf::GlobalConf(const GlobalConf &copy)
+    : _workerThreads(copy.getWorkerThreads()),
+      _workerProcesses(copy.getWorkerProcesses()),
+      _multiAccept(copy.getMultiAccept()),
+      _workerConnections(copy.getWorkerConnections()),
+      _epollBatch(copy.getEpollBatch()),
+      _connLimit(copy.getConnectionLimit()),
+      _useIoUring(copy.getUseIoUring()) {
+    initDirectiveMap();
+}
+
+/**
+ * @brief Destructor for the GlobalConf class.
+ */
+GlobalConf::~GlobalConf(void) {}
+
+/* ************************************************************************** */
+/*                                 Operators                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Assignment operator for the GlobalConf class.
+ * @param src The GlobalConf object to assign from.
+ * @return A reference to the assigned GlobalConf object.
+ */
+GlobalConf &GlobalConf::operator=(const GlobalConf &src) {
+    if (this == &src)
+        return (*this);
+    _workerThreads = src.getWorkerThreads();
+    _workerProcesses = src.getWorkerProcesses();
+    _multiAccept = src.getMultiAccept();
+    _workerConnections = src.getWorkerConnections();
+    _epollBatch = src.getEpollBatch();
+    _connLimit = src.getConnectionLimit();
+    _useIoUring = src.getUseIoUring();
+    return (*this);
+}
+
+/**
+ * @brief Overloads the << operator to print the main context configuration.
+ * @param os The output stream.
+ * @param ctx The GlobalConf object to print.
+ * @return The output stream.
+ */
+std::ostream &operator<<(std::ostream &os, const GlobalConf &ctx) {
+    os << BRED "Global Configuration:" NC << std::endl;
+    os << BYEL "Worker Threads:\n" NC << ctx.getWorkerThreads() << std::endl;
+    os << BYEL "Worker Processes:\n" NC << ctx.getWorkerProcesses()
+       << std::endl;
+    os << BYEL "Multi Accept:\n" NC << ctx.getMultiAccept() << std::endl;
+    os << BYEL "Worker Connections:\n" NC << ctx.getWorkerConnections()
+       << std::endl;
+    os << BYEL "Epoll Batch:\n" NC << ctx.getEpollBatch() << std::endl;
+    os << BYEL "Max Connections:\n" NC
+       << ctx.getConnectionLimit().getHighWatermark() << std::endl;
+    os << BYEL "Use:\n" NC << (ctx.getUseIoUring() ? "io_uring" : "epoll")
+       << std::endl;
+    return (os);
+}
+
+/* ************************************************************************** */
+/*                                   Setup                                    */
+/* ************************************************************************** */
+
+/// @brief Initializes the directive map of the main context.
+void GlobalConf::initDirectiveMap(void) {
+    _directiveMap["worker_threads"] = &GlobalConf::setWorkerThreads;
+    _directiveMap["worker_processes"] = &GlobalConf::setWorkerProcesses;
+    _eventsDirectiveMap["multi_accept"] = &GlobalConf::setMultiAccept;
+    _eventsDirectiveMap["worker_connections"] =
+        &GlobalConf::setWorkerConnections;
+    _eventsDirectiveMap["epoll_batch"] = &GlobalConf::setEpollBatch;
+    _eventsDirectiveMap["max_connections"] = &GlobalConf::setMaxConnections;
+    _eventsDirectiveMap["use"] = &GlobalConf::setUse;
+}
+
+/// @brief Checks the main context directives against each other.
+/// @throw std::runtime_error if worker_threads and worker_processes are both
+/// greater than one (pick one concurrency model).
+void GlobalConf::validate(void) const {
+    if ((_workerThreads > 1) && (_workerProcesses > 1))
+        throw std::runtime_error("worker_threads and worker_processes can not "
+                                 "both be greater than 1");
+}
+
+/* ************************************************************************** */
+/*                                  Getters                                   */
+/* ************************************************************************** */
+
+/// @brief Returns the number of event loops to run in parallel.
+/// @return The worker_threads value.
+std::size_t GlobalConf::getWorkerThreads(void) const { return (_workerThreads); }
+
+/// @brief Returns the number of worker processes forked by the master.
+/// @return The worker_processes value.
+std::size_t GlobalConf::getWorkerProcesses(void) const {
+    return (_workerProcesses);
+}
+
+/// @brief Returns how many connections may be accepted per readiness event.
+/// @return The multi_accept cap, 0 meaning "until the backlog is empty".
+std::size_t GlobalConf::getMultiAccept(void) const { return (_multiAccept); }
+
+/// @brief Returns the size of each event loop's connection table.
+/// @return The worker_connections value (listening sockets included).
+std::size_t GlobalConf::getWorkerConnections(void) const {
+    return (_workerConnections);
+}
+
+/// @brief Returns how many events a single epoll_wait() may return.
+/// @return The epoll_batch value.
+std::size_t GlobalConf::getEpollBatch(void) const { return (_epollBatch); }
+
+/// @brief Returns the max_connections limit of the whole webserv.
+/// @return The limit, unset (unlimited) by default.
+const ConnectionLimit &GlobalConf::getConnectionLimit(void) const {
+    return (_connLimit);
+}
+
+/// @brief Returns the event notification method of the event loops.
+/// @return true for io_uring, false for epoll (the default).
+bool GlobalConf::getUseIoUring(void) const { return (_useIoUring); }
+
+/* ************************************************************************** */
+/*                                  Setters                                   */
+/* ************************************************************************** */
+
+/// @brief Sets a main context directive.
+/// @param directive The directive line (without the trailing ';').
+/// @throw std::runtime_error if the directive is unknown or invalid.
+void GlobalConf::setDirective(std::string &directive) {
+    applyDirective(_directiveMap, directive, "main");
+}
+
+/// @brief Sets a directive of the events block.
+/// @param directive The directive line (without the trailing ';').
+/// @throw std::runtime_error if the directive is unknown or invalid.
+void GlobalConf::setEventsDirective(std::string &directive) {
+    applyDirective(_eventsDirectiveMap, directive, "events");
+}
+
+/// @brief Tokenizes a directive and calls its handler.
+/// @param dirMap The directives allowed in the context.
+/// @param directive The directive line (without the trailing ';').
+/// @param context The name of the context, for error messages.
+/// @throw std::runtime_error if the directive is unknown or invalid.
+void GlobalConf::applyDirective(
+    const std::map<std::string, DirHandler> &dirMap, std::string &directive,
+    const std::string &context) {
+#ifdef DEBUG
+    Logger::debug("GlobalConf", __func__, "Directive: " GRN + directive);
+#endif
+
+    std::vector<std::string> tks = ConfParser::tokenizer(directive);
+    if (tks.size() < 2)
+        throw std::runtime_error("Directive " + directive + " is invalid");
+
+    std::map<std::string, DirHandler>::const_iterator it;
+    it = dirMap.find(tks[0]);
+    if (it == dirMap.end())
+        throw std::runtime_error("Unknown directive in " + context +
+                                 " context: " + tks[0]);
+    (this->*(it->second))(tks);
+}
+
+/// @brief Sets the number of worker threads.
+/// @details `auto` starts one worker per online CPU.
+/// @param tks The tokens of the worker_threads directive.
+/// @throw std::runtime_error if the worker_threads is invalid.
+void GlobalConf::setWorkerThreads(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid worker_threads directive");
+
+    if (tks[1] == "auto") {
+        long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        _workerThreads = (nCpus > 0) ? static_cast<std::size_t>(nCpus) : 1;
+        return;
+    }
+
+    char *end = NULL;
+    long nThreads = std::strtol(tks[1].c_str(), &end, 10);
+    if ((*end != '\0') || (nThreads < 1) || (nThreads > MAX_WORKERS))
+        throw std::runtime_error("Invalid worker_threads directive: " +
+                                 tks[1]);
+    _workerThreads = static_cast<std::size_t>(nThreads);
+}
+
+/// @brief Sets the number of worker processes.
+/// @details `auto` forks one worker per online CPU.
+/// @param tks The tokens of the worker_processes directive.
+/// @throw std::runtime_error if the worker_processes is invalid.
+void GlobalConf::setWorkerProcesses(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid worker_processes directive");
+
+    if (tks[1] == "auto") {
+        long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        _workerProcesses = (nCpus > 0) ? static_cast<std::size_t>(nCpus) : 1;
+        return;
+    }
+
+    char *end = NULL;
+    long nProcs = std::strtol(tks[1].c_str(), &end, 10);
+    if ((*end != '\0') || (nProcs < 1) || (nProcs > MAX_WORKERS))
+        throw std::runtime_error("Invalid worker_processes directive: " +
+                                 tks[1]);
+    _workerProcesses = static_cast<std::size_t>(nProcs);
+}
+
+/// @brief Sets how many connections are accepted per readiness event.
+/// @details `on` drains the backlog until accept4() returns EAGAIN, `off`
+/// accepts a single connection, a number caps the batch.
+/// @param tks The tokens of the multi_accept directive.
+/// @throw std::runtime_error if the multi_accept is invalid.
+void GlobalConf::setMultiAccept(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid multi_accept directive");
+
+    if (tks[1] == "on") {
+        _multiAccept = 0;
+        return;
+    }
+    if (tks[1] == "off") {
+        _multiAccept = 1;
+        return;
+    }
+
+    char *end = NULL;
+    long nAccepts = std::strtol(tks[1].c_str(), &end, 10);
+    if ((*end != '\0') || (nAccepts < 1))
+        throw std::runtime_error("Invalid multi_accept directive: " + tks[1]);
+    _multiAccept = static_cast<std::size_t>(nAccepts);
+}
+
+/// @brief Sets the number of connection slots of each event loop.
+/// @details The slots are preallocated when the loop starts; the listening
+/// sockets use one slot each.
+/// @param tks The tokens of the worker_connections directive.
+/// @throw std::runtime_error if the worker_connections is invalid.
+void GlobalConf::setWorkerConnections(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid worker_connections directive");
+
+    char *end = NULL;
+    long nConnections = std::strtol(tks[1].c_str(), &end, 10);
+    if ((*end != '\0') || (nConnections < 2) ||
+        (nConnections > MAX_WORKER_CONNECTIONS))
+        throw std::runtime_error("Invalid worker_connections directive: " +
+                                 tks[1]);
+    _workerConnections = static_cast<std::size_t>(nConnections);
+}
+
+/// @brief Sets how many events each epoll_wait() call may return.
+/// @details The event array is allocated once per event loop; the events
+/// left over are returned by the next call.
+/// @param tks The tokens of the epoll_batch directive.
+/// @throw std::runtime_error if the epoll_batch is invalid.
+void GlobalConf::setEpollBatch(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid epoll_batch directive");
+
+    char *end = NULL;
+    long nEvents = std::strtol(tks[1].c_str(), &end, 10);
+    if ((*end != '\0') || (nEvents < 1) || (nEvents > MAX_EPOLL_BATCH))
+        throw std::runtime_error("Invalid epoll_batch directive: " + tks[1]);
+    _epollBatch = static_cast<std::size_t>(nEvents);
+}
+
+/// @brief Sets the max_connections of the whole webserv.
+/// @details Counts the client connections of every worker thread and process.
+/// @param tks The tokens of the max_connections directive.
+/// @throw std::runtime_error if the max_connections is invalid.
+void GlobalConf::setMaxConnections(std::vector<std::string> &tks) {
+    _connLimit.setWatermarks(tks);
+}
+
+/// @brief Sets the event notification method of the event loops.
+/// @details `io_uring` falls back to epoll at startup when the kernel does not
+/// support it.
+/// @param tks The tokens of the use directive.
+/// @throw std::runtime_error if the method is unknown.
+void GlobalConf::setUse(std::vector<std::string> &tks) {
+    if ((tks.size() != 2) || ((tks[1] != "epoll") && (tks[1] != "io_uring")))
+        throw std::runtime_error("Invalid use directive");
+    _useIoUring = (tks[1] == "io_uring");
+}
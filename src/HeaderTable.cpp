@@ -0,0 +1,110 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   HeaderTable.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/14 10:21:07 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/14 10:21:07 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup HeaderTableModule Header Table Module
+ * @{
+ *
+ * Perfect hash of the well-known header names.
+ *
+ * @version 1.0
+ */
+
+#include "../inc/HeaderTable.hpp"
+#include <cstring>   // std::strlen()
+
+/// @brief Canonical names, indexed by HeaderId
+const char *const HeaderTable::_names[N_HEADERS] = {
+    "Accept", "Accept-Encoding", "Accept-Language", "Allow", "Authorization",
+    "Cache-Control", "Connection", "Content-Disposition", "Content-Length",
+    "Content-Type", "Cookie", "Date", "Expect", "Host", "If-Modified-Since",
+    "If-None-Match", "Keep-Alive", "Last-Modified", "Location", "Origin",
+    "Range", "Referer", "Retry-After", "Server", "Set-Cookie", "TE", "Trailer",
+    "Transfer-Encoding", "Upgrade", "User-Agent",
+};
+
+/**
+ * @brief HeaderId of each hash value, HDR_OTHER where no name lands.
+ *
+ * @details Every well-known name hashes to its own slot; if the list of
+ * names changes, the multipliers of hash() must be searched again so that
+ * it stays collision-free.
+ */
+const unsigned char HeaderTable::_slots[64] = {
+    HDR_OTHER, HDR_EXPECT, HDR_OTHER, HDR_OTHER,
+    HDR_OTHER, HDR_OTHER, HDR_OTHER, HDR_ORIGIN,
+    HDR_OTHER, HDR_KEEP_ALIVE, HDR_OTHER, HDR_IF_MODIFIED_SINCE,
+    HDR_OTHER, HDR_ACCEPT, HDR_OTHER, HDR_CONTENT_LENGTH,
+    HDR_RANGE, HDR_COOKIE, HDR_OTHER, HDR_OTHER,
+    HDR_OTHER, HDR_OTHER, HDR_DATE, HDR_OTHER,
+    HDR_LAST_MODIFIED, HDR_IF_NONE_MATCH, HDR_REFERER, HDR_ACCEPT_LANGUAGE,
+    HDR_OTHER, HDR_OTHER, HDR_TE, HDR_CONTENT_DISPOSITION,
+    HDR_HOST, HDR_USER_AGENT, HDR_OTHER, HDR_SERVER,
+    HDR_OTHER, HDR_OTHER, HDR_OTHER, HDR_ALLOW,
+    HDR_LOCATION, HDR_CONTENT_TYPE, HDR_RETRY_AFTER, HDR_OTHER,
+    HDR_OTHER, HDR_AUTHORIZATION, HDR_TRANSFER_ENCODING, HDR_ACCEPT_ENCODING,
+    HDR_OTHER, HDR_SET_COOKIE, HDR_OTHER, HDR_CACHE_CONTROL,
+    HDR_TRAILER, HDR_OTHER, HDR_OTHER, HDR_OTHER,
+    HDR_OTHER, HDR_OTHER, HDR_OTHER, HDR_CONNECTION,
+    HDR_OTHER, HDR_OTHER, HDR_OTHER, HDR_UPGRADE,
+};
+
+/**
+ * @brief Hashes a header name into a slot.
+ *
+ * @details The first and last bytes are folded to lower case (all the
+ * well-known names start and end with a letter).
+ *
+ * @param name The name, not empty.
+ * @param len Its length.
+ * @return The slot, in [0, 63].
+ */
+std::size_t HeaderTable::hash(const char *name, std::size_t len) {
+    std::size_t first = static_cast<unsigned char>(name[0]) | 0x20;
+    std::size_t last = static_cast<unsigned char>(name[len - 1]) | 0x20;
+    return (((len * 4) + (first * 13) + (last * 10)) & 63);
+}
+
+/**
+ * @brief Resolves a header name, ignoring its case.
+ *
+ * @param name The name, as received.
+ * @return Its HeaderId, or HDR_OTHER if it is not a well-known one.
+ */
+HeaderId HeaderTable::lookup(const StrView &name) {
+    if (name.empty())
+        return (HDR_OTHER);
+    HeaderId id = static_cast<HeaderId>(_slots[hash(name.data, name.size)]);
+    if ((id == HDR_OTHER) || !name.iequals(_names[id]))
+        return (HDR_OTHER);
+    return (id);
+}
+
+/**
+ * @brief Resolves a NUL-terminated header name, ignoring its case.
+ *
+ * @param name The name.
+ * @return Its HeaderId, or HDR_OTHER if it is not a well-known one.
+ */
+HeaderId HeaderTable::lookup(const char *name) {
+    return (lookup(StrView(name, std::strlen(name))));
+}
+
+/**
+ * @brief Gets the canonical name of a well-known header.
+ *
+ * @param id The header, below N_HEADERS.
+ * @return Its name, as responses send it.
+ */
+const char *HeaderTable::getName(HeaderId id) { return (_names[id]); }
+
+/** @} */
@@ -0,0 +1,168 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   HostTable.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/02 10:21:37 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/02 10:21:37 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup HostTableModule Host Table Module
+ * @{
+ *
+ * Per listening socket routing of requests to their virtual server, by the
+ * name in their Host header.
+ *
+ * @version 1.0
+ */
+
+#include "../inc/HostTable.hpp"
+#include "../inc/Utils.hpp" // toLower()
+#include <cctype>          // std::tolower()
+#include <strings.h>       // strncasecmp()
+
+#define HOST_TABLE_MIN_SIZE 8 // Buckets of a new table, a power of two
+
+/* ************************************************************************** */
+/*                                Constructors                                */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs an empty table, without a default server.
+ */
+HostTable::HostTable(void) : _count(0), _default(NULL) {}
+
+/* ************************************************************************** */
+/*                                   Setup                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Sets the server of the requests that match no server_name.
+ *
+ * @param server The default server of the listening socket.
+ */
+void HostTable::setDefault(const Server *server) { _default = server; }
+
+/**
+ * @brief Adds a server_name to the table.
+ *
+ * @details Names are matched case-insensitively. When several servers share
+ * a name, the first one added keeps it, as the first matching server block
+ * of the configuration wins.
+ *
+ * @param name The server_name.
+ * @param server The server it belongs to.
+ */
+void HostTable::add(const std::string &name, const Server *server) {
+    if ((_count + 1) * 2 > _entries.size()) // Keep the load under 1/2
+        grow();
+
+    std::string lower = toLower(name);
+    uint32_t h = hash(lower.data(), lower.size());
+    Entry &entry = _entries[probe(h, lower.data(), lower.size())];
+    if (entry.server != NULL)
+        return; // Taken by a previous server
+    entry.hash = h;
+    entry.name = lower;
+    entry.server = server;
+    ++_count;
+}
+
+/**
+ * @brief Doubles the number of buckets and rehashes the names.
+ */
+void HostTable::grow(void) {
+    std::vector<Entry> old;
+    old.swap(_entries);
+    std::size_t size = old.empty() ? HOST_TABLE_MIN_SIZE : (old.size() * 2);
+    _entries.resize(size);
+
+    std::vector<Entry>::const_iterator it;
+    for (it = old.begin(); it != old.end(); ++it)
+        if (it->server != NULL)
+            _entries[probe(it->hash, it->name.data(), it->name.size())] = *it;
+}
+
+/* ************************************************************************** */
+/*                                   Lookup                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Gets the default server of the listening socket.
+ *
+ * @return The server of requests without a known Host.
+ */
+const Server *HostTable::getDefault(void) const { return (_default); }
+
+/**
+ * @brief Resolves the value of a Host header.
+ *
+ * @details The port, if any, is ignored ("example.com:8080"); the brackets
+ * of an IPv6 literal are kept ("[::1]:8080" is looked up as "[::1]").
+ *
+ * @param host The Host header value, or an empty string.
+ * @return The server named host, or the default server.
+ */
+const Server *HostTable::find(const StrView &host) const {
+    std::size_t len = host.size;
+    if ((len > 0) && (host[0] == '[')) {
+        std::size_t end = host.find(']');
+        if (end != std::string::npos)
+            len = end + 1;
+    } else {
+        std::size_t colon = host.find(':');
+        if (colon != std::string::npos)
+            len = colon;
+    }
+    if ((len == 0) || _entries.empty())
+        return (_default);
+
+    const Entry &entry =
+        _entries[probe(hash(host.data, len), host.data, len)];
+    return ((entry.server != NULL) ? entry.server : _default);
+}
+
+/**
+ * @brief Hashes a name, ignoring case (FNV-1a over the lowercase bytes).
+ *
+ * @param name The name.
+ * @param len The length of the name.
+ * @return The hash.
+ */
+uint32_t HostTable::hash(const char *name, std::size_t len) {
+    uint32_t h = 2166136261u;
+    for (std::size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(std::tolower(name[i]));
+        h *= 16777619u;
+    }
+    return (h);
+}
+
+/**
+ * @brief Finds the bucket of a name (linear probing).
+ *
+ * @param h The hash of the name.
+ * @param name The name, in any case.
+ * @param len The length of the name.
+ * @return The index of the bucket holding the name, or of the empty bucket
+ * where it would be inserted.
+ */
+std::size_t HostTable::probe(uint32_t h, const char *name,
+                             std::size_t len) const {
+    std::size_t mask = _entries.size() - 1;
+    std::size_t idx = h & mask;
+    while (_entries[idx].server != NULL) {
+        const Entry &entry = _entries[idx];
+        if ((entry.hash == h) && (entry.name.size() == len) &&
+            (strncasecmp(entry.name.data(), name, len) == 0))
+            return (idx);
+        idx = (idx + 1) & mask;
+    }
+    return (idx);
+}
+
+/** @} */
@@ -32,13 +32,75 @@
 #include "../inc/Webserv.hpp"
 
 /**
- * @brief Status of the HTTP response.
+ * @brief Empties the request for the next one on the same connection.
  *
- * This static variable holds the HTTP response status code, which is updated
- * during the parsing process to reflect the outcome of the request validation.
- * It is initialized to OK and modified as needed during parsing.
+ * Strings and the header vector are cleared, not replaced, so they keep the
+ * capacity they grew to on earlier requests.
  */
-static int responseStatus = OK;
+void HttpRequest::reset(void) {
+	method = UNKNOWN;
+	uri.clear();
+	target = StrView();
+	query = StrView();
+	protocolVersion = StrView();
+	for (std::size_t i = 0; i < N_HEADERS; ++i)
+		knownHeaders[i] = StrView();
+	otherHeaders.clear();
+	body = StrView();
+	serverPort.clear();
+}
+
+/**
+ * @brief Gets the first value of a well-known header.
+ *
+ * @param id The header.
+ * @return The value, or NULL if the request has no such header.
+ */
+const StrView *HttpRequest::getHeader(HeaderId id) const {
+	if ((id == HDR_OTHER) || (knownHeaders[id].data == NULL))
+		return (NULL);
+	return (&knownHeaders[id]);
+}
+
+/**
+ * @brief Gets the first value of a header.
+ *
+ * @details Well-known names are resolved to their slot; only the others
+ * are searched for.
+ *
+ * @param name The header name, in any case.
+ * @return The value, or NULL if the request has no such header.
+ */
+const StrView *HttpRequest::getHeader(const char *name) const {
+	HeaderId id = HeaderTable::lookup(name);
+	if (id != HDR_OTHER)
+		return (getHeader(id));
+	std::vector<HeaderField>::const_iterator it;
+	for (it = otherHeaders.begin(); it != otherHeaders.end(); ++it)
+		if ((it->id == HDR_OTHER) && it->name.iequals(name))
+			return (&it->value);
+	return (NULL);
+}
+
+/**
+ * @brief Checks if a list header holds a token, in any of its fields.
+ *
+ * @param id The header, e.g. HDR_CONNECTION.
+ * @param token The token, compared case-insensitively.
+ * @return true if one of the comma-separated elements is the token.
+ */
+bool HttpRequest::hasHeaderToken(HeaderId id, const char *token) const {
+	const StrView *value = getHeader(id);
+	if (value == NULL)
+		return (false);
+	if (isHeaderToken(*value, token))
+		return (true);
+	std::vector<HeaderField>::const_iterator it;
+	for (it = otherHeaders.begin(); it != otherHeaders.end(); ++it)
+		if ((it->id == id) && isHeaderToken(it->value, token))
+			return (true);
+	return (false);
+}
 
 /**
  * @class HttpRequestParser
@@ -51,48 +113,80 @@ static int responseStatus = OK;
  * The parser handles various HTTP methods and ensures compliance with HTTP/1.1
  * protocol standards. It checks for malformed requests and updates the response
  * status accordingly.
+ *
+ * The buffer is walked once, line by line, and every token is stored as a
+ * slice of it: nothing is copied but the decoded path.
+ *
+ * @param requestBuf The request, from its first byte.
+ * @param len The length of the request (header block, or up to the body end).
+ * @param httpReq The request to fill, reset beforehand.
+ * @return OK, or the error status of a malformed request.
  */
-unsigned short HttpRequestParser::parseHttp(const std::string &requestBuf,
+unsigned short HttpRequestParser::parseHttp(const char *requestBuf,
+											std::size_t len,
 											HttpRequest &httpReq) {
-	responseStatus = OK;
+	unsigned short responseStatus = OK;
+	StrView request(requestBuf, len);
 
 	// Catch invalid requests
-	if (requestBuf.empty() ||
-		(requestBuf.find_first_of("\r\n\t") == std::string::npos)) {
+	if (request.empty() || (request.find('\n') == std::string::npos)) {
 		responseStatus = BAD_REQUEST;
 		return responseStatus;
 	}
 
-	// Prepare Buffers & flags for parsing
-	std::stringstream bufferStream(requestBuf);
-	std::string buffer;
-	bool requestLineParsed = false;
-	bool headerParsed = false;
-
-	while (std::getline(bufferStream, buffer)) {
-		if (!requestLineParsed) { // Parse request lines
-			if (!getRequestLine(httpReq, buffer))
-				return responseStatus;
-			requestLineParsed = true;
-		} else if (!headerParsed && (buffer != "\r")) { // Header fields
-			if (!getHeaderFields(httpReq, buffer))
-				return responseStatus;
-		} else if (buffer.empty() || (buffer == "\r")) { // Header End
-			headerParsed = true;
+	std::size_t pos = 0;
+	if (!getRequestLine(httpReq, getLine(request, pos), responseStatus))
+		return responseStatus;
+	while (pos < request.size) { // Header fields, up to the empty line
+		StrView line = getLine(request, pos);
+		if (line.empty())
 			break;
-		}
+		if (!getHeaderFields(httpReq, line, responseStatus))
+			return responseStatus;
 	}
-	parseQueries(httpReq);
 
-	// Get body
-	std::string body((std::istreambuf_iterator<char>(bufferStream)),
-					 std::istreambuf_iterator<char>());
-	// Append body
-	httpReq.body = body;
+	// Body
+	httpReq.body = request.substr(pos);
 
 	return responseStatus;
 }
 
+/**
+ * @brief Gets the next line of the buffer.
+ *
+ * @param buffer The request.
+ * @param pos The offset of the line, moved past its terminator.
+ * @return The line, without its "\n" or "\r\n" terminator.
+ */
+StrView HttpRequestParser::getLine(const StrView &buffer, std::size_t &pos) {
+	std::size_t start = pos;
+	std::size_t end = buffer.find('\n', start);
+	if (end == std::string::npos) {
+		end = buffer.size;
+		pos = end;
+	} else
+		pos = end + 1;
+	if ((end > start) && (buffer[end - 1] == '\r'))
+		--end;
+	return (buffer.substr(start, end - start));
+}
+
+/**
+ * @brief Gets the next whitespace-separated token of a line.
+ *
+ * @param line The line.
+ * @param pos The offset the search starts at, moved past the token.
+ * @return The token, empty if the line has no more.
+ */
+StrView HttpRequestParser::getToken(const StrView &line, std::size_t &pos) {
+	while ((pos < line.size) && std::isspace(line[pos]))
+		++pos;
+	std::size_t start = pos;
+	while ((pos < line.size) && !std::isspace(line[pos]))
+		++pos;
+	return (line.substr(start, pos - start));
+}
+
 /**
  * @brief Parses the request line of an HTTP request.
  *
@@ -106,18 +200,20 @@ unsigned short HttpRequestParser::parseHttp(const std::string &requestBuf,
  * any issues encountered during parsing.
  *
  * @param httpReq The HttpRequest object to populate with parsed data.
- * @param buffer The string containing the request line to be parsed.
+ * @param line The request line, without its terminator.
+ * @param responseStatus Set to the error status if parsing fails.
  * @return True if the request line is successfully parsed and valid, false otherwise.
  */
 bool HttpRequestParser::getRequestLine(HttpRequest &httpReq,
-									   const std::string &buffer) {
-	if (std::isspace(buffer[0]))
+									   const StrView &line,
+									   unsigned short &responseStatus) {
+	if (line.empty() || std::isspace(line[0])) {
+		responseStatus = BAD_REQUEST;
 		return false;
+	}
 
-	std::stringstream bufferStream(buffer);
-	std::string method;
-
-	bufferStream >> method;
+	std::size_t pos = 0;
+	StrView method = getToken(line, pos);
 	if (method.empty() || !isMethodValid(method)) {
 		responseStatus = METHOD_NOT_ALLOWED;
 		if (isMethodImplemented(method))
@@ -126,30 +222,29 @@ bool HttpRequestParser::getRequestLine(HttpRequest &httpReq,
 		return false;
 	}
 
-	std::string url;
-	bufferStream >> url;
-	std::string decodedUrl = decodeUrl(url);
-	if (decodedUrl.empty() || !isUrlValid(decodedUrl)) {
+	StrView url = getToken(line, pos);
+	ByteScan::Target scan;
+	ByteScan::scanTarget(url.data, url.size, scan);
+	if (url.empty() || !isUrlValid(url, scan)) {
 		responseStatus = BAD_REQUEST;
 		return false;
 	}
 
-	if (decodedUrl.size() > URL_MAX_SIZE) {
+	if (url.size > URL_MAX_SIZE) {
 		responseStatus = URI_TOO_LONG;
 		return false;
 	}
 
-	std::string protocolVersion;
-	bufferStream >> protocolVersion;
+	StrView protocolVersion = getToken(line, pos);
 	if (protocolVersion.empty() || !isProtocolVersionValid(protocolVersion)) {
 		responseStatus = HTTP_VERSION_NOT_SUPPORTED;
 		return false;
 	}
 
 	httpReq.method = string2method(method);
-	httpReq.uri = decodedUrl;
-	httpReq.encodedUri =  trim(url);
-	httpReq.protocolVersion = trim(protocolVersion);
+	httpReq.target = url;
+	httpReq.protocolVersion = protocolVersion;
+	splitTarget(httpReq, scan);
 
 	return true;
 }
@@ -158,86 +253,79 @@ bool HttpRequestParser::getRequestLine(HttpRequest &httpReq,
  * @brief Parses the header fields of an HTTP request.
  *
  * This function extracts key-value pairs from the header section of the HTTP
- * request. It validates the presence of a colon to separate keys and values and
- * handles special cases for date-related headers.
+ * request. It validates that the key is a token ending at a colon and that
+ * the value holds no control bytes. A well-known header goes to its slot
+ * the first time, to the other headers when repeated; values are kept
+ * whole, list headers are split by their readers.
  *
  * @param httpReq The HttpRequest object to populate with parsed header data.
- * @param headers The string containing the header fields to be parsed.
+ * @param line The header line, without its terminator.
+ * @param responseStatus Set to the error status if parsing fails.
  * @return True if the headers are successfully parsed and valid, false
  * otherwise.
  */
 bool HttpRequestParser::getHeaderFields(HttpRequest &httpReq,
-										const std::string &headers) {
-	// check for colon
-	size_t colonPos = headers.find_first_of(':');
-	if (colonPos == std::string::npos) {
+										const StrView &line,
+										unsigned short &responseStatus) {
+	// The name is a token ending at the colon: no whitespace before it
+	size_t colonPos = ByteScan::findNonToken(line.data, line.size);
+	if ((colonPos == std::string::npos) || (colonPos == 0) ||
+		(line[colonPos] != ':')) {
 		responseStatus = BAD_REQUEST;
 		return false;
 	}
 
 	// Extract key value pair
-	std::string key = toLower(trim(headers.substr(0, colonPos)));
-	std::string value = trim(headers.substr(colonPos + 1));
-	if (key.empty() || value.empty()) {
+	HeaderField field;
+	field.name = line.substr(0, colonPos);
+	StrView value = line.substr(colonPos + 1).trim();
+	if (value.empty() ||
+		(ByteScan::findCtl(value.data, value.size) != std::string::npos)) {
 		responseStatus = BAD_REQUEST;
 		return false;
 	}
 
-	std::stringstream ss(value);
-	std::string val;
-
-	if ((key == "date") || (key == "if-modified-since") ||
-		(key == "last-modified")) {
-		httpReq.headers.insert(std::pair<std::string, std::string>(key, value));
+	field.value = value;
+	field.id = HeaderTable::lookup(field.name);
+	if (field.id == HDR_OTHER) {
+		httpReq.otherHeaders.push_back(field);
 		return true;
 	}
-	while (std::getline(ss, val, ',')) {
-		val.erase(val.find_last_not_of(" \t\r\n") + 1);
-		val.erase(0, val.find_first_not_of(" \t\r\n"));
-
-		if (!val.empty()) // Ingnore empty fields
-			httpReq.headers.insert(std::pair<std::string, std::string>(key, val));
+	StrView &slot = httpReq.knownHeaders[field.id];
+	if (slot.data == NULL) {
+		slot = value;
+		return true;
+	}
+	// Repeated: a second Host, or a conflicting length, can not be trusted
+	if ((field.id == HDR_HOST) ||
+		((field.id == HDR_CONTENT_LENGTH) && !slot.iequals(value))) {
+		responseStatus = BAD_REQUEST;
+		return false;
 	}
+	httpReq.otherHeaders.push_back(field);
 	return true;
 }
 
 /**
- * @brief Parses the query parameters from the URI of an HTTP request.
+ * @brief Splits the request target into its path and query.
  *
- * This function extracts query parameters from the URI of the HttpRequest object.
- * It identifies the query string, splits it into key-value pairs, and populates
- * the queryParams map in the HttpRequest object with these pairs.
+ * The query stays a slice of the buffer, still encoded as CGI scripts
+ * expect it in QUERY_STRING. The path is decoded into httpReq.uri.
  *
- * @param httpReq The HttpRequest object whose URI will be parsed for query parameters.
+ * @param httpReq The request whose target was parsed.
+ * @param scan What ByteScan::scanTarget() found in the target.
  */
-void HttpRequestParser::parseQueries(HttpRequest &httpReq) {
-	std::size_t delimPos = httpReq.uri.find('?');
-	if (delimPos == std::string::npos)
-		return;
-
-	std::string query = httpReq.uri.substr(delimPos + 1); // Findf query
-	httpReq.uri = httpReq.uri.substr(0, delimPos);        // Extract query
-	std::stringstream ss(query);
-	std::string pair;
-
-	while (std::getline(ss, pair, '&')) {
-		size_t equalPos = pair.find('=');
-		std::string key;
-		std::string value;
-		if (equalPos == std::string::npos)
-			key = pair; // empty
-		else {
-			key = pair.substr(0, equalPos);
-			value = pair.substr(equalPos + 1);
-		}
-		trim(key);
-		trim(value);
-
-		if (!key.empty())
-			httpReq.queryParams.insert(
-				std::pair<std::string, std::string>(key, value));
+void HttpRequestParser::splitTarget(HttpRequest &httpReq,
+									const ByteScan::Target &scan) {
+	StrView path = httpReq.target;
+	std::size_t firstPercent = scan.firstPercent;
+	if (scan.firstQuestion != std::string::npos) {
+		httpReq.query = path.substr(scan.firstQuestion + 1);
+		path = path.substr(0, scan.firstQuestion);
+		if (firstPercent > scan.firstQuestion) // Only in the query
+			firstPercent = std::string::npos;
 	}
-	return;
+	decodeUrl(path, firstPercent, httpReq.uri);
 }
 
 /* ************************************************************************** */
@@ -253,8 +341,9 @@ void HttpRequestParser::parseQueries(HttpRequest &httpReq) {
  * @param method The HTTP method to validate.
  * @return True if the method is valid and supported, false otherwise.
  */
-bool HttpRequestParser::isMethodValid(const std::string &method) {
-	if (method == "GET" || method == "POST" || method == "DELETE")
+bool HttpRequestParser::isMethodValid(const StrView &method) {
+	if (method.equals("GET") || method.equals("POST") ||
+		method.equals("DELETE"))
 		return true;
 	return false;
 }
@@ -268,9 +357,9 @@ bool HttpRequestParser::isMethodValid(const std::string &method) {
  * @param method The HTTP method to check for implementation.
  * @return True if the method is implemented, false otherwise.
  */
-bool HttpRequestParser::isMethodImplemented(const std::string &method) {
-	if (method == "PUT" || method == "HEAD" || method == "OPTIONS" ||
-		method == "PATCH")
+bool HttpRequestParser::isMethodImplemented(const StrView &method) {
+	if (method.equals("PUT") || method.equals("HEAD") ||
+		method.equals("OPTIONS") || method.equals("PATCH"))
 		return true;
 	return false;
 }
@@ -283,29 +372,31 @@ bool HttpRequestParser::isMethodImplemented(const std::string &method) {
  * contain fragment identifiers, contains at most one '?', and has a valid
  * number of '=' and '&' characters when a '?' is present.
  *
- * @param url The URL string to validate.
+ * @param url The request target, as received.
+ * @param scan What ByteScan::scanTarget() found in it.
  * @return True if the URL is valid according to the specified rules, false otherwise.
  *
  * @details The validation rules are as follows:
  * - The URL must start with a '/' character.
  * - Fragment identifiers (indicated by '#') are not allowed.
+ * - Control bytes and DEL are not allowed.
  * - The URL can contain at most one '?' character.
  * - If a '?' is present, the number of '=' characters must match the number
  *   of '&' characters plus one.
+ * They apply to the target as received: an encoded delimiter is data.
  */
-bool HttpRequestParser::isUrlValid(const std::string &url) {
+bool HttpRequestParser::isUrlValid(const StrView &url,
+								   const ByteScan::Target &scan) {
 	if (url[0] != '/')
 		return false;
-	// No fragment urls allowed
-	if (url.find("#") != std::string::npos)
+	// No fragment urls, nor control bytes, allowed
+	if (scan.hasHash || scan.hasCtl)
 		return false;
 	// Check for a single ?
-	if (std::count(url.begin(), url.end(), '?') > 1)
+	if (scan.nQuestion > 1)
 		return false;
 	// The number of '=' must match the number of '&' plus one when a '?' is present.
-	if ((url.find('?') != std::string::npos) &&
-		(std::count(url.begin(), url.end(), '=') !=
-		 std::count(url.begin(), url.end(), '&') + 1))
+	if ((scan.nQuestion == 1) && (scan.nEqual != scan.nAmp + 1))
 		return false;
 	return true;
 }
@@ -319,9 +410,10 @@ bool HttpRequestParser::isUrlValid(const std::string &url) {
  * @param protocolVersion The protocol version string to validate.
  * @return True if the protocol version is valid and supported, false otherwise.
  */
-bool HttpRequestParser::isProtocolVersionValid(const std::string &protocolVersion) {
-	if ((protocolVersion == "HTTP/1.1") || (protocolVersion == "HTTP/1.0") ||
-		(protocolVersion == "HTTP/0.9"))
+bool HttpRequestParser::isProtocolVersionValid(const StrView &protocolVersion) {
+	if (protocolVersion.equals("HTTP/1.1") ||
+		protocolVersion.equals("HTTP/1.0") ||
+		protocolVersion.equals("HTTP/0.9"))
 		return true;
 	return false;
 }
@@ -330,52 +422,46 @@ bool HttpRequestParser::isProtocolVersionValid(const std::string &protocolVersio
 /*                                  Decoding                                  */
 /* ************************************************************************** */
 
+/// @brief Gets the value of a hexadecimal digit.
+static int hexValue(char c) {
+	if ((c >= '0') && (c <= '9'))
+		return (c - '0');
+	return ((std::tolower(c) - 'a') + 10);
+}
+
 /**
  * @brief Decodes a percent-encoded URL string.
  *
  * This function converts percent-encoded characters in a URL to their ASCII
- * equivalents. It processes the input string and returns a decoded version.
+ * equivalents. The bytes before the first '%' are copied as they are.
  *
- * @param encoded The percent-encoded URL string to decode.
- * @return A decoded string with percent-encoded characters converted to ASCII.
+ * @param encoded The percent-encoded URL slice to decode.
+ * @param firstPercent The offset of its first '%', or std::string::npos.
+ * @param decoded Receives the decoded URL; its capacity is reused.
  */
-std::string HttpRequestParser::decodeUrl(const std::string &encoded) {
-	std::ostringstream decoded;
-	for (size_t i = 0; i < encoded.length(); ++i) {
-		if ((encoded[i] == '%') && ((i + 2) < encoded.length()) &&
+void HttpRequestParser::decodeUrl(const StrView &encoded,
+								  std::size_t firstPercent,
+								  std::string &decoded) {
+	if (firstPercent >= encoded.size) {
+		decoded.assign(encoded.data, encoded.size);
+		return;
+	}
+	decoded.assign(encoded.data, firstPercent);
+	for (size_t i = firstPercent; i < encoded.size; ++i) {
+		if ((encoded[i] == '%') && ((i + 2) < encoded.size) &&
 			std::isxdigit(encoded[i + 1]) && std::isxdigit(encoded[i + 2])) {
-			int value;
-			std::istringstream ss(encoded.substr((i + 1), 2));
-			ss >> std::hex >> value;
-			decoded << static_cast<char>(value);
+			decoded += static_cast<char>((hexValue(encoded[i + 1]) << 4) |
+										 hexValue(encoded[i + 2]));
 			i += 2;
 		} else
-			decoded << encoded[i];
+			decoded += encoded[i];
 	}
-	return decoded.str();
 }
 
 /* ************************************************************************** */
 /*                                  Trimming */
 /* ************************************************************************** */
 
-/**
- * @brief Trims whitespace characters from both ends of a string.
- *
- * This function removes leading and trailing whitespace characters from the
- * input string and returns the trimmed result.
- *
- * @param str The string to be trimmed.
- * @return A new string with leading and trailing whitespace removed.
- */
-std::string HttpRequestParser::trim(const std::string &str) {
-	size_t start = str.find_first_not_of(" \t\r\n");
-	if (start == std::string::npos)
-		return "";
-	size_t end = str.find_last_not_of(" \t\r\n");
-	return str.substr(start, (end - start + 1));
-}
-
 /**
  * @brief Trims null characters from the end of a string.
  *
@@ -403,13 +489,15 @@ std::ostream &operator<<(std::ostream &os, const HttpRequest &httpReq) {
 	os << BYEL "URI: " NC << httpReq.uri << std::endl;
 	os << BYEL "Protocol Version: " NC << httpReq.protocolVersion << std::endl;
 	os << BYEL "Headers: " NC << std::endl;
-	std::multimap<std::string, std::string>::const_iterator it;
-	for (it = httpReq.headers.begin(); it != httpReq.headers.end(); ++it)
-		os << "\t" << it->first << ": " << it->second << std::endl;
-	os << BYEL "Query Fields: " NC << std::endl;
-	std::multimap<std::string, std::string>::const_iterator itq;
-	for (itq = httpReq.queryParams.begin(); itq != httpReq.queryParams.end(); ++itq)
-		os << "\t" << itq->first << ": " << itq->second << std::endl;
+	for (std::size_t i = 0; i < N_HEADERS; ++i)
+		if (httpReq.knownHeaders[i].data != NULL)
+			os << "\t" << HeaderTable::getName(static_cast<HeaderId>(i))
+			   << ": " << httpReq.knownHeaders[i] << std::endl;
+	std::vector<HeaderField>::const_iterator it;
+	for (it = httpReq.otherHeaders.begin(); it != httpReq.otherHeaders.end();
+		 ++it)
+		os << "\t" << it->name << ": " << it->value << std::endl;
+	os << BYEL "Query: " NC << httpReq.query << std::endl;
 	os << BYEL "Body: " NC << std::endl << httpReq.body << std::endl;
 
 	return (os);
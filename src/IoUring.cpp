@@ -0,0 +1,416 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   IoUring.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/04 10:03:51 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/04 10:03:51 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup IoUringModule io_uring Module
+ * @{
+ *
+ * Thin wrapper over the io_uring syscalls used by the optional io_uring
+ * backend of the Cluster event loop.
+ *
+ * @version 1.0
+ */
+
+#include "../inc/IoUring.hpp"
+#include <cerrno>
+#include <sys/syscall.h> // __NR_io_uring_*
+
+#if HAS_IO_URING
+
+/// @brief Reads a ring index shared with the kernel.
+static inline unsigned loadAcquire(const unsigned *ptr) {
+    unsigned value = *const_cast<const volatile unsigned *>(ptr);
+    __sync_synchronize();
+    return (value);
+}
+
+/// @brief Publishes a ring index shared with the kernel.
+static inline void storeRelease(unsigned *ptr, unsigned value) {
+    __sync_synchronize();
+    *const_cast<volatile unsigned *>(ptr) = value;
+}
+
+/* ************************************************************************** */
+/*                          Constructor & Destructor                          */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs a closed ring.
+ */
+IoUring::IoUring(void)
+    : _fd(-1), _features(0), _sqRing(MAP_FAILED), _sqRingSize(0),
+      _sqes(NULL), _sqesSize(0), _sqHead(NULL), _sqTail(NULL),
+      _sqArray(NULL), _sqMask(0), _sqEntries(0), _sqeTail(0), _sqeHead(0),
+      _cqRing(MAP_FAILED), _cqRingSize(0), _cqHead(NULL), _cqTail(NULL),
+      _cqMask(0), _cqes(NULL), _bufRing(NULL), _bufRingSize(0),
+      _buffers(NULL), _bufTail(0) {}
+
+/**
+ * @brief Closes the ring, releasing its mappings and registrations.
+ */
+IoUring::~IoUring(void) { close(); }
+
+/* ************************************************************************** */
+/*                                   Setup                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Creates the ring and maps its queues.
+ *
+ * @details The completion queue is four times the submission queue: every
+ * multishot request posts many completions. The ring is single issuer and
+ * starts disabled: enable() binds it to the thread running the event loop,
+ * which may not be the one setting it up. Kernels without deferred task work
+ * (< 6.1) get cooperative task work instead; kernels without single issuer
+ * rings (< 6.0) also lack multishot recv and are rejected.
+ *
+ * @param entries The size of the submission queue.
+ * @return true on success, false (errno set) if io_uring is not usable.
+ */
+bool IoUring::setup(unsigned entries) {
+    struct io_uring_params params;
+    static const unsigned flags = (IORING_SETUP_CQSIZE |
+                                   IORING_SETUP_R_DISABLED |
+                                   IORING_SETUP_SINGLE_ISSUER);
+    static const unsigned taskRun[] = {IORING_SETUP_DEFER_TASKRUN,
+                                       IORING_SETUP_COOP_TASKRUN};
+
+    for (std::size_t i = 0; (i < 2) && (_fd < 0); ++i) {
+        std::memset(&params, 0, sizeof(params));
+        params.flags = (flags | taskRun[i]);
+        params.cq_entries = (entries * 4);
+        _fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if ((_fd < 0) && (errno != EINVAL))
+            return (false);
+    }
+    if (_fd < 0)
+        return (false);
+    _features = params.features;
+    if (!(_features & IORING_FEAT_EXT_ARG) ||
+        !(_features & IORING_FEAT_NODROP)) {
+        close();
+        errno = ENOSYS;
+        return (false);
+    }
+
+    _sqRingSize = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+    _cqRingSize = params.cq_off.cqes +
+                  (params.cq_entries * sizeof(struct io_uring_cqe));
+    if (_features & IORING_FEAT_SINGLE_MMAP)
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+
+    _sqRing = mmap(NULL, _sqRingSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    if (_sqRing == MAP_FAILED)
+        return (close(), false);
+    if (_features & IORING_FEAT_SINGLE_MMAP)
+        _cqRing = _sqRing;
+    else {
+        _cqRing = mmap(NULL, _cqRingSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+        if (_cqRing == MAP_FAILED)
+            return (close(), false);
+    }
+    _sqesSize = (params.sq_entries * sizeof(struct io_uring_sqe));
+    void *sqes = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return (close(), false);
+    _sqes = static_cast<struct io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(_sqRing);
+    _sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    _sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    _sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    _sqEntries = params.sq_entries;
+    _sqeTail = _sqeHead = *_sqTail;
+    for (unsigned i = 0; i < _sqEntries; ++i) // SQE i always sits at slot i
+        _sqArray[i] = i;
+
+    char *cq = static_cast<char *>(_cqRing);
+    _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    return (true);
+}
+
+/**
+ * @brief Registers a sparse table of fixed files.
+ *
+ * @details Every entry starts empty (-1); the Cluster stores each socket at
+ * the index of its connection slot.
+ *
+ * @param nFiles The size of the table.
+ * @return true on success, false (errno set) otherwise.
+ */
+bool IoUring::registerFiles(unsigned nFiles) {
+    std::vector<int> fds(nFiles, -1);
+    return (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_FILES,
+                    &fds[0], nFiles) == 0);
+}
+
+/**
+ * @brief Registers the ring of buffers picked by multishot recv.
+ *
+ * @return true on success, false (errno set) otherwise.
+ */
+bool IoUring::setupBufferRing(void) {
+    _bufRingSize = (URING_BUF_COUNT * sizeof(struct io_uring_buf));
+    void *ring = mmap(NULL, _bufRingSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+        return (false);
+    _bufRing = static_cast<struct io_uring_buf *>(ring);
+    _buffers = new char[URING_BUF_COUNT * URING_BUF_SIZE];
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(_bufRing);
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PBUF_RING, &reg,
+                1) != 0)
+        return (false);
+
+    _bufTail = 0;
+    for (unsigned bid = 0; bid < URING_BUF_COUNT; ++bid)
+        recycleBuffer(static_cast<unsigned short>(bid));
+    return (true);
+}
+
+/**
+ * @brief Starts the ring, binding it to the calling thread.
+ *
+ * @return true on success, false (errno set) otherwise.
+ */
+bool IoUring::enable(void) {
+    return (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_ENABLE_RINGS,
+                    NULL, 0) == 0);
+}
+
+/**
+ * @brief Closes the ring. Safe to call on a closed ring.
+ */
+void IoUring::close(void) {
+    if (_sqes != NULL)
+        munmap(_sqes, _sqesSize);
+    if ((_cqRing != MAP_FAILED) && (_cqRing != _sqRing))
+        munmap(_cqRing, _cqRingSize);
+    if (_sqRing != MAP_FAILED)
+        munmap(_sqRing, _sqRingSize);
+    if (_fd >= 0)
+        ::close(_fd);
+    if (_bufRing != NULL)
+        munmap(_bufRing, _bufRingSize);
+    delete[] _buffers;
+    _fd = -1;
+    _sqes = NULL;
+    _sqRing = _cqRing = MAP_FAILED;
+    _bufRing = NULL;
+    _buffers = NULL;
+}
+
+/// @brief Checks if the ring is set up.
+/// @return true if the ring is usable, false otherwise.
+bool IoUring::isOpen(void) const { return (_fd >= 0); }
+
+/* ************************************************************************** */
+/*                                 Submission                                 */
+/* ************************************************************************** */
+
+/**
+ * @brief Returns a zeroed submission entry.
+ *
+ * @details When the submission queue is full the pending entries are
+ * submitted first.
+ *
+ * @return The entry, or NULL if the queue is still full.
+ */
+struct io_uring_sqe *IoUring::getSqe(void) {
+    if ((_sqeTail - loadAcquire(_sqHead)) >= _sqEntries) {
+        submit();
+        if ((_sqeTail - loadAcquire(_sqHead)) >= _sqEntries)
+            return (NULL);
+    }
+    struct io_uring_sqe *sqe = &_sqes[_sqeTail & _sqMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++_sqeTail;
+    return (sqe);
+}
+
+/**
+ * @brief Submits the pending entries without waiting.
+ *
+ * @return The number of entries submitted, or -errno.
+ */
+int IoUring::submit(void) {
+    unsigned toSubmit = flushSq();
+    if (toSubmit == 0)
+        return (0);
+    return (enter(toSubmit, 0, 0, NULL, 0));
+}
+
+/**
+ * @brief Submits the pending entries and waits for a completion.
+ *
+ * @param timeoutMs Max time to block, -1 blocks until a completion arrives.
+ * @return 0 on success, -ETIME on timeout, or -errno.
+ */
+int IoUring::wait(int timeoutMs) {
+    unsigned toSubmit = flushSq();
+    bool ready = (loadAcquire(_cqTail) != *_cqHead);
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    std::memset(&arg, 0, sizeof(arg));
+    if ((timeoutMs >= 0) && !ready) {
+        ts.tv_sec = (timeoutMs / 1000);
+        ts.tv_nsec = ((timeoutMs % 1000) * 1000000L);
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    int ret = enter(toSubmit, ready ? 0 : 1,
+                    IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                    sizeof(arg));
+    return ((ret < 0) ? ret : 0);
+}
+
+/* ************************************************************************** */
+/*                                 Completion                                 */
+/* ************************************************************************** */
+
+/**
+ * @brief Pops the next completion.
+ *
+ * @param cqe Filled with the completion.
+ * @return true if a completion was popped, false if the queue is empty.
+ */
+bool IoUring::peek(struct io_uring_cqe &cqe) {
+    unsigned head = *_cqHead;
+    if (head == loadAcquire(_cqTail))
+        return (false);
+    cqe = _cqes[head & _cqMask];
+    storeRelease(_cqHead, head + 1);
+    return (true);
+}
+
+/* ************************************************************************** */
+/*                      Registered Files & Provided Buffers                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Sets an entry of the fixed file table right away.
+ *
+ * @param index The entry.
+ * @param fd The file descriptor, or -1 to clear the entry.
+ * @return 0 on success, -errno otherwise.
+ */
+int IoUring::updateFile(unsigned index, int fd) {
+    struct io_uring_files_update update;
+    std::memset(&update, 0, sizeof(update));
+    update.offset = index;
+    update.fds = reinterpret_cast<uint64_t>(&fd);
+    if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_FILES_UPDATE,
+                &update, 1) < 0)
+        return (-errno);
+    return (0);
+}
+
+/**
+ * @brief Returns the memory of a provided buffer.
+ *
+ * @param bid The buffer id reported by the completion.
+ * @return The start of the buffer.
+ */
+char *IoUring::getBuffer(unsigned short bid) {
+    return (_buffers + (static_cast<std::size_t>(bid) * URING_BUF_SIZE));
+}
+
+/**
+ * @brief Gives a provided buffer back to the kernel.
+ *
+ * @details struct io_uring_buf_ring is not used: in C++ its flexible array
+ * does not start at offset 0. The ring tail overlays the resv field of the
+ * first entry.
+ *
+ * @param bid The buffer id reported by the completion.
+ */
+void IoUring::recycleBuffer(unsigned short bid) {
+    struct io_uring_buf *buf = &_bufRing[_bufTail & (URING_BUF_COUNT - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(getBuffer(bid));
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    ++_bufTail;
+    __sync_synchronize();
+    *const_cast<volatile unsigned short *>(&_bufRing[0].resv) = _bufTail;
+}
+
+/* ************************************************************************** */
+/*                                  Private                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Publishes the entries handed out by getSqe() to the kernel.
+ *
+ * @return The number of entries not submitted yet.
+ */
+unsigned IoUring::flushSq(void) {
+    if (_sqeTail != _sqeHead) {
+        storeRelease(_sqTail, _sqeTail);
+        _sqeHead = _sqeTail;
+    }
+    return (_sqeTail - loadAcquire(_sqHead));
+}
+
+/**
+ * @brief Calls io_uring_enter(), retrying when interrupted.
+ *
+ * @return The syscall result, or -errno.
+ */
+int IoUring::enter(unsigned toSubmit, unsigned minComplete, unsigned flags,
+                   const void *arg, std::size_t argSize) {
+    long ret = syscall(__NR_io_uring_enter, _fd, toSubmit, minComplete, flags,
+                       arg, argSize);
+    if (ret < 0)
+        return (-errno);
+    return (static_cast<int>(ret));
+}
+
+#else // !HAS_IO_URING: every setup fails and the Cluster keeps epoll
+
+IoUring::IoUring(void) : _fd(-1) {}
+IoUring::~IoUring(void) {}
+bool IoUring::setup(unsigned entries) {
+    (void)entries;
+    errno = ENOSYS;
+    return (false);
+}
+bool IoUring::registerFiles(unsigned nFiles) { return ((void)nFiles, false); }
+bool IoUring::setupBufferRing(void) { return (false); }
+bool IoUring::enable(void) { return (false); }
+void IoUring::close(void) {}
+bool IoUring::isOpen(void) const { return (false); }
+struct io_uring_sqe *IoUring::getSqe(void) { return (NULL); }
+int IoUring::submit(void) { return (-ENOSYS); }
+int IoUring::wait(int timeoutMs) { return ((void)timeoutMs, -ENOSYS); }
+bool IoUring::peek(struct io_uring_cqe &cqe) { return ((void)cqe, false); }
+int IoUring::updateFile(unsigned index, int fd) {
+    (void)index;
+    (void)fd;
+    return (-ENOSYS);
+}
+char *IoUring::getBuffer(unsigned short bid) { return ((void)bid, NULL); }
+void IoUring::recycleBuffer(unsigned short bid) { (void)bid; }
+
+#endif
+/** @} */
@@ -13,6 +13,7 @@
 #include "../inc/Location.hpp"
 #include "../inc/ConfParser.hpp"
 #include "../inc/Logger.hpp"
+#include "../inc/Utils.hpp"
 #include "../inc/Webserv.hpp"
 
 /* ************************************************************************** */
@@ -22,6 +23,8 @@
 Location::Location(void) : _autoIndex(UNSET), _clientMaxBodySize(-1) {
     initDirectiveMap();
     _return = std::make_pair(-1, "");
+    for (int i = 0; i < N_TIMEOUTS; ++i)
+        _timeouts[i] = -1;
 }
 
 Location::Location(const Location &copy)
@@ -30,7 +33,10 @@ Location::Location(const Location &copy)
       _clientMaxBodySize(copy.getClientMaxBodySize()),
       _validMethods(copy.getLimitExcept()), _errorPage(copy.getErrorPage()),
       _uploadStore(copy.getUploadStore()), _return(copy.getReturn()),
-      _cgiExt(copy.getCgiExt()) {}
+      _cgiExt(copy.getCgiExt()) {
+    for (int i = 0; i < N_TIMEOUTS; ++i)
+        _timeouts[i] = copy.getTimeout(static_cast<Timeout>(i));
+}
 
 Location::~Location(void) {}
 
@@ -61,6 +67,8 @@ Location &Location::operator=(const Location &src) {
     _uploadStore = src.getUploadStore();
     _return = src.getReturn();
     _cgiExt = src.getCgiExt();
+    for (int i = 0; i < N_TIMEOUTS; ++i)
+        _timeouts[i] = src.getTimeout(static_cast<Timeout>(i));
     return (*this);
 }
 
@@ -134,6 +142,10 @@ void Location::initDirectiveMap(void) {
     _directiveMap["upload_store"] = &Location::setUploadStore;
     _directiveMap["return"] = &Location::setReturn;
     _directiveMap["cgi_ext"] = &Location::setCgiExt;
+    // client_header_timeout is server-only: the location is not known yet
+    _directiveMap["client_body_timeout"] = &Location::setTimeout;
+    _directiveMap["keepalive_timeout"] = &Location::setTimeout;
+    _directiveMap["send_timeout"] = &Location::setTimeout;
 }
 
 /* ************************************************************************** */
@@ -174,6 +186,9 @@ std::string Location::getCgiExt(void) const { return (_cgiExt); }
 
 std::set<Method> Location::getValidMethods() const { return _validMethods; }
 
+/// @brief Get a connection timeout (in milliseconds, -1 if unset)
+long Location::getTimeout(Timeout timeout) const { return (_timeouts[timeout]); }
+
 /* ************************************************************************** */
 /*                                  Setters                                   */
 /* ************************************************************************** */
@@ -447,3 +462,16 @@ void Location::setCgiExt(std::vector<std::string> &tks) {
         throw std::runtime_error("Cgi_ext already set");
     _cgiExt = tks[1];
 }
+
+/// @brief Set one of the connection timeouts of the location
+/// @param tks The tokens of a client_body_timeout, keepalive_timeout or
+/// send_timeout directive
+/// @throw std::runtime_error if the timeout is invalid
+void Location::setTimeout(std::vector<std::string> &tks) {
+    Timeout timeout = directive2timeout(tks[0]);
+    if ((tks.size() != 2) || (timeout == N_TIMEOUTS))
+        throw std::runtime_error("Invalid " + tks[0] + " directive");
+    if (_timeouts[timeout] != -1)
+        throw std::runtime_error(tks[0] + " already set");
+    _timeouts[timeout] = parseDuration(tks[1]);
+}
@@ -25,12 +25,13 @@
 /// @return Current time
 const std::string Logger::currentTime() {
 	std::time_t tm = std::time(NULL);
-	std::tm *now = localtime(&tm);
+	std::tm now;
+	localtime_r(&tm, &now);
 
 	std::stringstream res;
-	res << std::setfill('0') << std::setw(2) << now->tm_hour << ":"
-		<< std::setfill('0') << std::setw(2) << now->tm_min << ":"
-		<< std::setfill('0') << std::setw(2) << now->tm_sec;
+	res << std::setfill('0') << std::setw(2) << now.tm_hour << ":"
+		<< std::setfill('0') << std::setw(2) << now.tm_min << ":"
+		<< std::setfill('0') << std::setw(2) << now.tm_sec;
 	return res.str();
 }
 
@@ -29,21 +29,18 @@
 /* ************************************************************************** */
 
 /**
- * @brief Constructs a PostResponse object.
- * @param server Reference to the server configuration.
- * @param request Reference to the HTTP request.
- * @param clientFd File descriptor for the client connection.
- * @param epollFd File descriptor for epoll instance.
+ * @brief Constructs an unbound PostResponse object.
+ *
+ * It is bound to a request with reset() before each use.
  */
-PostResponse::PostResponse(const Server &server, const HttpRequest &request,
-                           int clientFd, int epollFd)
-    : AResponse(server, request, OK), _clientFd(clientFd), _epollFd(epollFd) {}
+PostResponse::PostResponse() : AResponse() {}
 
 /**
  * @brief Copy constructor for PostResponse.
  * @param other Another PostResponse object to copy from.
  */
-PostResponse::PostResponse(const PostResponse &other) : AResponse(other) {}
+PostResponse::PostResponse(const PostResponse &other)
+    : AResponse(other) {}
 
 /**
  * @brief Destructor for PostResponse.
@@ -54,6 +51,20 @@ PostResponse::~PostResponse() {}
 /*                          Public Member Functions                           */
 /* ************************************************************************** */
 
+/**
+ * @brief Binds the handler to a new request.
+ *
+ * Also drops the multipart state left by the previous upload.
+ */
+void PostResponse::reset(const Server &server, const HttpRequest &request,
+                         HttpResponse &response, short status) {
+    AResponse::reset(server, request, response, status);
+    _body.clear();
+    _fileBuffer.clear();
+    _limit.clear();
+    _file2upload = File();
+}
+
 /**
  * @brief Generates a default HTML response for successful file uploads.
  * @return A string containing the HTML response.
@@ -83,7 +94,7 @@ static std::string generateDefaultUploadResponse() {
 
 /**
  * @brief Generates the HTTP response for a POST request.
- * @return A string containing the HTTP response.
+ * @return The header block of the HTTP response.
  *
  * This function processes the POST request by checking the method, parsing
  * the HTTP data, validating the body size, and handling file uploads. If
@@ -113,14 +124,14 @@ std::string PostResponse::generateResponse() {
 
         if ((_status = uploadFile()) != OK)
             return getErrorPage();
-        _response.body = generateDefaultUploadResponse();
+        _response->body = generateDefaultUploadResponse();
 		_status = CREATED;
-        _response.status = CREATED;
+        _response->status = CREATED;
     } else {
-        std::string root = _server.getRoot(_locationRoute);
+        std::string root = _server->getRoot(_locationRoute);
         std::string path = getPath();
-		CGI cgi(_request,
-            _response,
+		CGI cgi(*_request,
+            *_response,
             root,
             path
         );
@@ -129,7 +140,7 @@ std::string PostResponse::generateResponse() {
     }
     loadHeaders();
 
-    return (getResponseStr());
+    return (getHeaderStr());
 }
 
 /* ************************************************************************** */
@@ -145,60 +156,48 @@ std::string PostResponse::generateResponse() {
  * @return An unsigned short representing the response status.
  *
  * Checks for the presence of specific headers such as "expect" and
- * "content-length". Sends a 100 Continue response if necessary and
- * validates the request headers.
+ * "content-length" and validates the request headers. A chunked body was
+ * already decoded by the connection; any other transfer coding is rejected.
  */
 unsigned short PostResponse::parseHttp() {
-    if (hasHeader("expect"))
-        if (!send100continue())
+    if (hasHeader(HDR_EXPECT))
+        if (!checkExpect())
             return (_status);
-    if (!hasHeader("content-length") ||
-        (hasHeader("transfer-encoding") && !isCGI()))
+    if (hasHeader(HDR_TRANSFER_ENCODING)) { // Decoded by the connection
+        if (!_request->hasHeaderToken(HDR_TRANSFER_ENCODING, "chunked"))
+            _status = BAD_REQUEST;
+    } else if (!hasHeader(HDR_CONTENT_LENGTH))
         _status = BAD_REQUEST;
     return _status;
 }
 
 /**
  * @brief Checks if a specific header is present in the request.
- * @param header The header to check for.
+ * @param id The header to check for.
  * @return True if the header is present, false otherwise.
  */
-bool PostResponse::hasHeader(const std::string &header) const {
-    if (_request.headers.find(header) != _request.headers.end())
-        return (true);
-    return (false);
+bool PostResponse::hasHeader(HeaderId id) const {
+    return (_request->getHeader(id) != NULL);
 }
 
 /**
- * @brief Sends a 100 Continue response to the client.
- * @return True if the response was sent successfully, false otherwise.
+ * @brief Checks the expectation of the request.
+ * @return True if the expectation is valid, false otherwise.
  *
- * Validates the "expect" header and sends a 100 Continue response
- * if the request is valid. Checks for content length and transfer
- * encoding headers to ensure the request is well-formed.
+ * Validates the "expect" header and checks for content length and transfer
+ * encoding headers to ensure the request is well-formed. The interim 100
+ * Continue itself was sent by the connection, as soon as the header block
+ * was complete (see Cluster::queueContinue()).
  */
-bool PostResponse::send100continue() {
-    if (_request.headers.find("expect")->second != "100-continue") {
+bool PostResponse::checkExpect() {
+    if (!_request->getHeader(HDR_EXPECT)->iequals("100-continue")) {
         _status = BAD_REQUEST;
         return (false);
     }
-    if (!hasHeader("content-length") && !hasHeader("transfer-encoding")) {
+    if (!hasHeader(HDR_CONTENT_LENGTH) && !hasHeader(HDR_TRANSFER_ENCODING)) {
         _status = BAD_REQUEST;
         return (false);
     }
-    if (hasHeader("content-length") &&
-        string2number<ssize_t>(
-            _request.headers.find("content-length")->second) >
-            _server.getClientMaxBodySize()) {
-        _status = PAYLOAD_TOO_LARGE;
-        return (false);
-    }
-    ssize_t sent = send(_clientFd, "HTTP/1.1 100 Continue\r\n\r\n", 28, 0);
-    if (sent <= 0) {
-        _status = INTERNAL_SERVER_ERROR;
-        return (false);
-    }
-
     return (true);
 }
 
@@ -216,8 +215,8 @@ bool PostResponse::send100continue() {
  * fail, otherwise returns OK.
  */
 short PostResponse::checkBody() {
-    if (hasHeader("content-type") &&
-        _request.headers.find("content-type")->second.find("multipart/") == 0) {
+    if (hasHeader(HDR_CONTENT_TYPE) &&
+        _request->getHeader(HDR_CONTENT_TYPE)->istartsWith("multipart/")) {
         _limit = getLimit();
         if (_limit.empty())
             return (BAD_REQUEST);
@@ -239,20 +238,15 @@ short PostResponse::checkBody() {
  * is not found, it returns an empty string.
  */
 const std::string PostResponse::getLimit() {
-    std::multimap<std::string, std::string>::const_iterator contentTypeHeader =
-        _request.headers.find("content-type");
-    if (contentTypeHeader == _request.headers.end())
-        return "";
-
-    const std::string contentType = contentTypeHeader->second;
-    if (contentType.empty())
+    const StrView *contentType = _request->getHeader(HDR_CONTENT_TYPE);
+    if ((contentType == NULL) || contentType->empty())
         return "";
 
-    std::size_t limitPositrion = contentType.find("boundary=");
+    std::size_t limitPositrion = contentType->find("boundary=");
     if (limitPositrion == std::string::npos)
         return "";
 
-    const std::string limit = contentType.substr(limitPositrion + 9);
+    const std::string limit = contentType->substr(limitPositrion + 9).str();
 
     return (limit);
 }
@@ -272,24 +266,24 @@ PostResponse::getBody(const std::string &limit) {
     std::string fullDelimiter = "--" + limit;
     std::string endDelimiter = fullDelimiter + "--";
 
-    std::size_t startLDelimiterPos = _request.body.find(fullDelimiter);
+    std::size_t startLDelimiterPos = _request->body.find(fullDelimiter);
     if (startLDelimiterPos == std::string::npos)
         return (body);
 
     while (startLDelimiterPos != std::string::npos) {
         startLDelimiterPos += (fullDelimiter.length() + 2);
         std::size_t endDelimiterPos =
-            _request.body.find(fullDelimiter, startLDelimiterPos);
+            _request->body.find(fullDelimiter, startLDelimiterPos);
 
-        if (_request.body.find(endDelimiter, startLDelimiterPos) ==
+        if (_request->body.find(endDelimiter, startLDelimiterPos) ==
             startLDelimiterPos)
             break;
 
         if (endDelimiterPos == std::string::npos)
             return (body);
 
-        std::string subStr = _request.body.substr(
-            startLDelimiterPos, (endDelimiterPos - startLDelimiterPos));
+        std::string subStr = _request->body.substr(
+            startLDelimiterPos, (endDelimiterPos - startLDelimiterPos)).str();
         std::multimap<std::string, std::string> subMap = getFields(subStr);
         if (subMap.empty())
             break;
@@ -441,13 +435,12 @@ std::string PostResponse::getFieldValue(const std::string &header,
  * appropriate error status.
  */
 short PostResponse::checkForm() {
-    std::map<std::string, std::string>::iterator it =
-        _request.headers.find("content-type");
+    const StrView *contentType = _request->getHeader(HDR_CONTENT_TYPE);
 
-    if (it == _request.headers.end())
+    if (contentType == NULL)
         return (BAD_REQUEST);
 
-    if (it->second.find("multipart/form-data") == std::string::npos)
+    if (contentType->find("multipart/form-data") == std::string::npos)
         return (UNSUPPORTED_MEDIA_TYPE);
 
     return (OK);
@@ -474,9 +467,9 @@ short PostResponse::uploadFile() {
     if (status != OK)
         return (status);
 
-    std::string dir = _server.getUploadStore(_locationRoute);
+    std::string dir = _server->getUploadStore(_locationRoute);
     if (dir.empty())
-        dir = getPath(_server.getRoot(_locationRoute),
+        dir = getPath(_server->getRoot(_locationRoute),
                       "default_upload_directory");
     if (dir.at(dir.length() - 1) != '/') // Check if dir ends with /
         dir += "/";
@@ -491,7 +484,7 @@ short PostResponse::uploadFile() {
         return (FORBIDDEN);
 
     std::size_t bytes2write = _file2upload.content.length();
-    if ((storageSize += bytes2write) > MAX_STORAGE_SIZE) {
+    if (!reserveStorage(bytes2write)) {
         close(fd);
         return (PAYLOAD_TOO_LARGE);
     }
@@ -499,13 +492,14 @@ short PostResponse::uploadFile() {
 	ssize_t retv = write(fd, _file2upload.content.c_str(), bytes2write);
     if (retv == -1 || (retv == 0 && bytes2write > 0)) {
 		close(fd);
+		releaseStorage(bytes2write);
 		return (FORBIDDEN);
     }
 
 	if (close(fd) == -1)
 		return (INTERNAL_SERVER_ERROR);
 
-	storageSize += (getFileSize(path) - fileSize);
+	releaseStorage(fileSize); // The previous file (if any) was truncated
 
     return (OK);
 }
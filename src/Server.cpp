@@ -14,6 +14,7 @@
 #include "../inc/ConfParser.hpp"
 #include "../inc/Location.hpp"
 #include "../inc/Logger.hpp"
+#include "../inc/Utils.hpp"
 
 /* ************************************************************************** */
 /*                                Constructors                                */
@@ -22,7 +23,13 @@
  * @brief Default constructor for the Server class.
  * Initializes the server with default settings.
  */
-Server::Server(void) : _clientMaxBodySize(-1), _autoIndex(FALSE) {
+Server::Server(void)
+    : _clientMaxBodySize(-1), _autoIndex(FALSE),
+      _keepaliveRequests(DEFAULT_KEEPALIVE_REQUESTS),
+      _headerBufferSize(DEFAULT_HEADER_BUFFER_SIZE),
+      _maxHeaderSize(DEFAULT_LARGE_HEADER_BUFFERS * DEFAULT_LARGE_HEADER_SIZE),
+      _clientMinRate(0), _sendMinRate(0),
+      _minRateWindow(DEFAULT_MIN_RATE_WINDOW_MS), _headerConnsPerIp(0) {
     // Push back index.html/index.htm to _serverIdx vector (NginX Defaults)
     _serverIdx.push_back("index.html");
     _serverIdx.push_back("index.htm");
@@ -33,6 +40,9 @@ Server::Server(void) : _clientMaxBodySize(-1), _autoIndex(FALSE) {
     methods.insert(DELETE);
     _validMethods = methods;
     _return = std::make_pair(-1, "");
+    for (int i = 0; i < N_TIMEOUTS; ++i)
+        _timeouts[i] = DEFAULT_TIMEOUT_MS;
+    _timeouts[KEEPALIVE_TIMEOUT] = DEFAULT_KEEPALIVE_TIMEOUT_MS;
 }
 
 /**
@@ -44,7 +54,18 @@ Server::Server(const Server &copy)
       _clientMaxBodySize(copy.getClientMaxBodySize()),
       _errorPages(copy.getErrorPage()), _root(copy.getRoot()),
       _locations(copy.getLocations()), _autoIndex(copy.getAutoIdx()),
-      _return(copy.getReturn()), _cgiExt(copy.getCgiExt()) {}
+      _return(copy.getReturn()), _cgiExt(copy.getCgiExt()),
+      _keepaliveRequests(copy.getKeepaliveRequests()),
+      _headerBufferSize(copy.getHeaderBufferSize()),
+      _maxHeaderSize(copy.getMaxHeaderSize()),
+      _clientMinRate(copy.getClientMinRate()),
+      _sendMinRate(copy.getSendMinRate()),
+      _minRateWindow(copy.getMinRateWindow()),
+      _headerConnsPerIp(copy.getHeaderConnsPerIp()),
+      _connLimit(copy.getConnectionLimit()) {
+    for (int i = 0; i < N_TIMEOUTS; ++i)
+        _timeouts[i] = copy.getTimeout(static_cast<Timeout>(i));
+}
 
 /**
  * @brief Destructor for the Server class.
@@ -67,6 +88,16 @@ Server &Server::operator=(const Server &copy) {
     _autoIndex = copy.getAutoIdx();
     _return = copy.getReturn();
     _cgiExt = copy.getCgiExt();
+    _keepaliveRequests = copy.getKeepaliveRequests();
+    _headerBufferSize = copy.getHeaderBufferSize();
+    _maxHeaderSize = copy.getMaxHeaderSize();
+    _clientMinRate = copy.getClientMinRate();
+    _sendMinRate = copy.getSendMinRate();
+    _minRateWindow = copy.getMinRateWindow();
+    _headerConnsPerIp = copy.getHeaderConnsPerIp();
+    _connLimit = copy.getConnectionLimit();
+    for (int i = 0; i < N_TIMEOUTS; ++i)
+        _timeouts[i] = copy.getTimeout(static_cast<Timeout>(i));
     return (*this);
 }
 
@@ -130,6 +161,20 @@ void Server::initDirectiveMap(void) {
     _directiveMap["autoindex"] = &Server::setAutoIndex;
     _directiveMap["return"] = &Server::setReturn;
     _directiveMap["cgi_ext"] = &Server::setCgiExt;
+    _directiveMap["keepalive_requests"] = &Server::setKeepaliveRequests;
+    _directiveMap["client_header_buffer_size"] = &Server::setHeaderBufferSize;
+    _directiveMap["large_client_header_buffers"] =
+        &Server::setLargeHeaderBuffers;
+    _directiveMap["client_min_rate"] = &Server::setMinRate;
+    _directiveMap["send_min_rate"] = &Server::setMinRate;
+    _directiveMap["min_rate_window"] = &Server::setMinRateWindow;
+    _directiveMap["max_header_connections_per_ip"] =
+        &Server::setHeaderConnsPerIp;
+    _directiveMap["max_connections"] = &Server::setMaxConnections;
+    _directiveMap["client_header_timeout"] = &Server::setTimeout;
+    _directiveMap["client_body_timeout"] = &Server::setTimeout;
+    _directiveMap["keepalive_timeout"] = &Server::setTimeout;
+    _directiveMap["send_timeout"] = &Server::setTimeout;
 }
 
 /// @brief Checks if the IP address is valid.
@@ -385,6 +430,85 @@ std::set<Method> Server::getValidMethods(const std::string &route) const {
     return (it->second.getValidMethods());
 }
 
+/// @brief Returns the maximum number of requests served per connection.
+/// @return The keepalive_requests cap.
+std::size_t Server::getKeepaliveRequests(void) const {
+    return (_keepaliveRequests);
+}
+
+/// @brief Returns the initial size of the read buffer of a request.
+/// @return The client_header_buffer_size, in bytes.
+std::size_t Server::getHeaderBufferSize(void) const {
+    return (_headerBufferSize);
+}
+
+/// @brief Returns the size past which a header block is rejected.
+/// @return The number times the size of large_client_header_buffers.
+std::size_t Server::getMaxHeaderSize(void) const { return (_maxHeaderSize); }
+
+/// @brief Returns the rate below which a client sending a request is closed.
+/// @return The client_min_rate, in bytes per second, 0 if unchecked.
+std::size_t Server::getClientMinRate(void) const { return (_clientMinRate); }
+
+/// @brief Returns the rate below which a client reading a response is closed.
+/// @return The send_min_rate, in bytes per second, 0 if unchecked.
+std::size_t Server::getSendMinRate(void) const { return (_sendMinRate); }
+
+/// @brief Returns the window the transfer rates are measured over.
+/// @return The min_rate_window, in milliseconds.
+long Server::getMinRateWindow(void) const { return (_minRateWindow); }
+
+/// @brief Returns how many connections of an IP may wait for their headers.
+/// @return The max_header_connections_per_ip, 0 if unlimited.
+std::size_t Server::getHeaderConnsPerIp(void) const {
+    return (_headerConnsPerIp);
+}
+
+/// @brief Returns the max_connections limit of the server.
+/// @return The limit, unset (unlimited) by default.
+const ConnectionLimit &Server::getConnectionLimit(void) const {
+    return (_connLimit);
+}
+
+/// @brief Returns a connection timeout of the server.
+/// @param timeout The timeout to get.
+/// @return The timeout in milliseconds.
+long Server::getTimeout(Timeout timeout) const { return (_timeouts[timeout]); }
+
+/// @brief Returns a connection timeout of a location.
+/// @param timeout The timeout to get.
+/// @param route The location route.
+/// @return The location's timeout, or the server's if the location has none.
+long Server::getTimeout(Timeout timeout, const std::string &route) const {
+    if (route.empty())
+        return (_timeouts[timeout]);
+    std::map<std::string, Location>::const_iterator it;
+    it = _locations.find(route);
+    if ((it == _locations.end()) || (it->second.getTimeout(timeout) == -1))
+        return (_timeouts[timeout]);
+    return (it->second.getTimeout(timeout));
+}
+
+/// @brief Finds the location route serving a URI (longest prefix match).
+/// @param uri The request URI.
+/// @return The matching route, or an empty string if none matches.
+std::string Server::getLocationRoute(const std::string &uri) const {
+    std::map<std::string, Location>::const_iterator it = _locations.find(uri);
+    if (it != _locations.end())
+        return (it->first);
+
+    std::size_t bestMatchLen = 0;
+    std::string bestMatchRoute = "";
+    for (it = _locations.begin(); it != _locations.end(); ++it) {
+        if ((it->first.size() > bestMatchLen) &&
+            (uri.compare(0, it->first.size(), it->first) == 0)) {
+            bestMatchLen = it->first.size();
+            bestMatchRoute = it->first;
+        }
+    }
+    return (bestMatchRoute);
+}
+
 /* ************************************************************************** */
 /*                                  Setters                                   */
 /* ************************************************************************** */
@@ -403,26 +527,23 @@ void Server::setDirective(std::string &directive) {
         throw std::runtime_error("Directive " + directive + " is invalid");
     showContainer(__func__, "Directive Tokens", tks);
 
-    for (size_t tk = 0; tk < tks.size(); tk++) {
-        try {
-            std::string token = tks[tk];
-            (this->*_directiveMap[token])(tks);
+    std::map<std::string, DirHandler>::const_iterator it;
+    it = _directiveMap.find(tks[0]);
+    if (it == _directiveMap.end())
+        throw std::runtime_error("Directive " RED + tks[0] + NC " is invalid");
 
+    (this->*(it->second))(tks);
 #ifdef DEBUG
-            Logger::debug("Server", __func__,
-                          "Set directive: " BWHT + directive + NC);
+    Logger::debug("Server", __func__, "Set directive: " BWHT + directive + NC);
 #endif
-
-            return;
-        } catch (const std::exception &e) {
-        }
-    }
-
-    throw std::runtime_error("No valid directive found");
 }
 
 /// @brief Sets the listen directive
-/// @param tks The tokens of the listen directive
+/// @details The address is either TCP (see setListenAddress()) or the path
+/// of a unix domain socket, `unix:/path`, for a frontend on the same host.
+/// @param tks The tokens of the listen directive: the address, then the
+/// optional TCP parameters (see setListenOption()). Only backlog=, rcvbuf=
+/// and sndbuf= apply to a unix domain socket.
 /// @throw std::runtime_error if the listen directive is invalid
 void Server::setListen(std::vector<std::string> &tks) {
 #ifdef DEBUG
@@ -430,47 +551,39 @@ void Server::setListen(std::vector<std::string> &tks) {
                   "Processing listen directive: " YEL + tks[0] + NC);
 #endif
 
-    if (tks.size() > 2)
+    if (tks.size() < 2)
         throw std::runtime_error("Invalid listen directive: directive must "
-                                 "include at least one IP/port");
+                                 "include an IP/port");
+
+    std::string val = tks[1];
+    Socket socket;
+
+    std::size_t prefixLen = std::strlen(UNIX_SOCKET_PREFIX);
+    if (val.compare(0, prefixLen, UNIX_SOCKET_PREFIX) == 0) { // unix:/path
+        struct sockaddr_un unixAddr;
+        socket.ip = UNIX_SOCKET_IP;
+        socket.port = val.substr(prefixLen);
+        if (socket.port.empty() ||
+            (socket.port.size() >= sizeof(unixAddr.sun_path)))
+            throw std::runtime_error("Invalid listen directive: invalid unix "
+                                     "socket path '" +
+                                     socket.port + "'");
+    } else
+        setListenAddress(val, socket);
 
-    // Process tokens from the second one onwards
+    // Process the parameters, from the third token onwards
     std::vector<std::string>::const_iterator it;
-    for (it = tks.begin() + 1; it != tks.end(); ++it) {
-        std::string val = *it;
-        Socket socket;
-
-        size_t sep = val.find(':');     // Check for 'IP:Port' format
-        if (sep != std::string::npos) { // If ':' is present
-            socket.ip = val.substr(0, sep);
-            socket.port = val.substr(sep + 1);
-
-            if (socket.ip.empty() || socket.port.empty())
-                throw std::runtime_error("Invalid listen directive '" + val +
-                                         "'");
-        } else { // No ':' present; it could be just an IP or port
-            if (val.find_first_not_of("0123456789") == std::string::npos)
-                socket.port = val; // All numeric: assume it's a port
-            else
-                socket.ip = val; // Contains non-numeric: assume it's an IP
-        }
-
-        // Apply defaults
-        if (socket.ip.empty() || socket.ip == "listen")
-            socket.ip = "0.0.0.0";
-        if (socket.port.empty())
-            socket.port = "80";
-        // Validate IP and Port
-        if (!isIpValid(socket.ip))
-            throw std::runtime_error("Invalid listen directive: invalid IP '" +
-                                     socket.ip + "'");
-        if (!isPortValid(socket.port))
-            throw std::runtime_error("Invalid listen directive: invalid port "
-                                     "'" +
-                                     socket.port + "'");
-        // Add the socket to the list
-        _netAddr.push_back(socket);
-    }
+    for (it = tks.begin() + 2; it != tks.end(); ++it)
+        setListenOption(*it, socket.options);
+    const ListenOptions &options = socket.options;
+    if (socket.isUnix() && (options.deferred || options.fastOpen ||
+                            options.noDelay || options.notSentLowat))
+        throw std::runtime_error("Invalid listen directive: TCP parameters "
+                                 "on unix socket '" +
+                                 socket.port + "'");
+
+    // Add the socket to the list
+    _netAddr.push_back(socket);
 
 #ifdef DEBUG
     Logger::debug("Server", __func__,
@@ -478,6 +591,110 @@ void Server::setListen(std::vector<std::string> &tks) {
 #endif
 }
 
+/// @brief Sets the IP and port of a TCP listen directive.
+/// @details `IP:port`, `IP` (port 80) or `port` (all interfaces).
+/// @param val The address token of the listen directive.
+/// @param socket The socket to set the address of.
+/// @throw std::runtime_error if the IP or port is invalid.
+void Server::setListenAddress(const std::string &val, Socket &socket) const {
+    size_t sep = val.find(':');     // Check for 'IP:Port' format
+    if (sep != std::string::npos) { // If ':' is present
+        socket.ip = val.substr(0, sep);
+        socket.port = val.substr(sep + 1);
+
+        if (socket.ip.empty() || socket.port.empty())
+            throw std::runtime_error("Invalid listen directive '" + val + "'");
+    } else { // No ':' present; it could be just an IP or port
+        if (val.find_first_not_of("0123456789") == std::string::npos)
+            socket.port = val; // All numeric: assume it's a port
+        else
+            socket.ip = val; // Contains non-numeric: assume it's an IP
+    }
+
+    // Apply defaults
+    if (socket.ip.empty() || socket.ip == "listen")
+        socket.ip = "0.0.0.0";
+    if (socket.port.empty())
+        socket.port = "80";
+    // Validate IP and Port
+    if (!isIpValid(socket.ip))
+        throw std::runtime_error("Invalid listen directive: invalid IP '" +
+                                 socket.ip + "'");
+    if (!isPortValid(socket.port))
+        throw std::runtime_error("Invalid listen directive: invalid port "
+                                 "'" +
+                                 socket.port + "'");
+}
+
+/// @brief Parses a positive number or size (listen parameters, buffers).
+/// @param what The parameter or directive, for error messages.
+/// @param value The value, a number with an optional k or m unit.
+/// @param allowUnit Whether the value is a size that may take a unit.
+/// @return The value.
+/// @throw std::runtime_error if the value is not a positive int.
+static int parseSizeValue(const std::string &what, std::string value,
+                          bool allowUnit) {
+    long unit = 1;
+    if (allowUnit && !value.empty()) {
+        switch (value[value.size() - 1]) {
+        case 'k':
+        case 'K':
+            unit = KB;
+            break;
+        case 'm':
+        case 'M':
+            unit = MB;
+            break;
+        }
+        if (unit != 1)
+            value.erase(value.size() - 1);
+    }
+
+    char *end = NULL;
+    long n = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || (*end != '\0') || (n <= 0) || (n > (INT_MAX / unit)))
+        throw std::runtime_error("Invalid " + what);
+    return (static_cast<int>(n * unit));
+}
+
+/// @brief Sets a TCP parameter of a listen directive.
+/// @details The parameters are:
+/// - backlog=N: length of the accept queue (default SOMAXCONN)
+/// - rcvbuf=size, sndbuf=size: SO_RCVBUF and SO_SNDBUF of the socket
+/// - deferred: TCP_DEFER_ACCEPT, accept once the request starts arriving
+/// - fastopen=N: TCP_FASTOPEN, with a queue of N pending handshakes
+/// - nodelay: TCP_NODELAY on the accepted connections
+/// - notsent_lowat=size: TCP_NOTSENT_LOWAT on the accepted connections
+/// @param param The parameter token.
+/// @param options The options of the listen directive to update.
+/// @throw std::runtime_error if the parameter is unknown or invalid.
+void Server::setListenOption(const std::string &param,
+                             ListenOptions &options) {
+    std::size_t eq = param.find('=');
+    std::string name = param.substr(0, eq);
+    std::string value = (eq == std::string::npos) ? "" : param.substr(eq + 1);
+    bool hasValue = (eq != std::string::npos);
+    std::string what = "listen parameter: " + param;
+
+    if ((name == "deferred") && !hasValue)
+        options.deferred = true;
+    else if ((name == "nodelay") && !hasValue)
+        options.noDelay = true;
+    else if ((name == "backlog") && hasValue)
+        options.backlog = parseSizeValue(what, value, false);
+    else if ((name == "fastopen") && hasValue)
+        options.fastOpen = parseSizeValue(what, value, false);
+    else if ((name == "rcvbuf") && hasValue)
+        options.rcvBuf = parseSizeValue(what, value, true);
+    else if ((name == "sndbuf") && hasValue)
+        options.sndBuf = parseSizeValue(what, value, true);
+    else if ((name == "notsent_lowat") && hasValue)
+        options.notSentLowat = parseSizeValue(what, value, true);
+    else
+        throw std::runtime_error("Invalid " + what);
+    options.isSet = true;
+}
+
 /// @brief Sets the server name.
 /// @param name The name of the server.
 void Server::setServerName(std::vector<std::string> &tks) {
@@ -772,6 +989,116 @@ void Server::setCgiExt(std::vector<std::string> &tks) {
     _cgiExt = tks[1];
 }
 
+/// @brief Sets the keepalive_requests of the server.
+/// @param tks The tokens of the keepalive_requests directive.
+/// @throw std::runtime_error if the keepalive_requests is invalid.
+void Server::setKeepaliveRequests(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid keepalive_requests directive");
+
+    char *end = NULL;
+    long nRequests = std::strtol(tks[1].c_str(), &end, 10);
+    if ((*end != '\0') || (nRequests < 1))
+        throw std::runtime_error("Invalid keepalive_requests directive: " +
+                                 tks[1]);
+    _keepaliveRequests = static_cast<std::size_t>(nRequests);
+}
+
+/// @brief Sets the client_header_buffer_size of the server.
+/// @details The read buffer of a request starts with this capacity and
+/// doubles as needed, up to large_client_header_buffers for the header block.
+/// As in nginx, the default server of the address applies.
+/// @param tks The tokens of the client_header_buffer_size directive.
+/// @throw std::runtime_error if the size is invalid.
+void Server::setHeaderBufferSize(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid client_header_buffer_size directive");
+    _headerBufferSize = static_cast<std::size_t>(
+        parseSizeValue("client_header_buffer_size: " + tks[1], tks[1], true));
+}
+
+/// @brief Sets the large_client_header_buffers of the server.
+/// @details `large_client_header_buffers number size;`: a header block
+/// longer than number * size is rejected with 400 Bad Request.
+/// @param tks The tokens of the large_client_header_buffers directive.
+/// @throw std::runtime_error if the number or size is invalid.
+void Server::setLargeHeaderBuffers(std::vector<std::string> &tks) {
+    if (tks.size() != 3)
+        throw std::runtime_error("Invalid large_client_header_buffers "
+                                 "directive");
+    std::string what = "large_client_header_buffers: " + tks[1] + " " + tks[2];
+    std::size_t number = parseSizeValue(what, tks[1], false);
+    std::size_t size = parseSizeValue(what, tks[2], true);
+    if (number > (INT_MAX / size)) // Overflow
+        throw std::runtime_error("Invalid " + what);
+    _maxHeaderSize = (number * size);
+}
+
+/// @brief Sets the client_min_rate or send_min_rate of the server.
+/// @details `client_min_rate rate;` closes a client that sends its request
+/// slower than rate bytes per second, `send_min_rate rate;` one that reads
+/// its response slower, both measured over min_rate_window. Unlike the
+/// timeouts, a client trickling a byte now and then does not reset them.
+/// @param tks The tokens of the client_min_rate or send_min_rate directive.
+/// @throw std::runtime_error if the rate is invalid.
+void Server::setMinRate(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid " + tks[0] + " directive");
+    std::size_t rate = static_cast<std::size_t>(
+        parseSizeValue(tks[0] + ": " + tks[1], tks[1], true));
+    if (tks[0] == "client_min_rate")
+        _clientMinRate = rate;
+    else
+        _sendMinRate = rate;
+}
+
+/// @brief Sets the min_rate_window of the server.
+/// @param tks The tokens of the min_rate_window directive.
+/// @throw std::runtime_error if the duration is invalid or zero.
+void Server::setMinRateWindow(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid min_rate_window directive");
+    long window = parseDuration(tks[1]);
+    if (window == 0)
+        throw std::runtime_error("Invalid min_rate_window: " + tks[1]);
+    _minRateWindow = window;
+}
+
+/// @brief Sets the max_header_connections_per_ip of the server.
+/// @details Caps the connections of a client IP that have not sent a whole
+/// header block yet; further ones are shed with a 503. As with
+/// max_connections, the default server of the address applies. The count
+/// is kept per event loop.
+/// @param tks The tokens of the max_header_connections_per_ip directive.
+/// @throw std::runtime_error if the number is invalid.
+void Server::setHeaderConnsPerIp(std::vector<std::string> &tks) {
+    if (tks.size() != 2)
+        throw std::runtime_error("Invalid max_header_connections_per_ip "
+                                 "directive");
+    _headerConnsPerIp = static_cast<std::size_t>(parseSizeValue(
+        "max_header_connections_per_ip: " + tks[1], tks[1], false));
+}
+
+/// @brief Sets the max_connections of the server.
+/// @details Counts the connections accepted on the server's addresses whose
+/// default server it is, across every worker.
+/// @param tks The tokens of the max_connections directive.
+/// @throw std::runtime_error if the max_connections is invalid.
+void Server::setMaxConnections(std::vector<std::string> &tks) {
+    _connLimit.setWatermarks(tks);
+}
+
+/// @brief Sets one of the connection timeouts of the server.
+/// @param tks The tokens of a client_header_timeout, client_body_timeout,
+/// keepalive_timeout or send_timeout directive.
+/// @throw std::runtime_error if the timeout is invalid.
+void Server::setTimeout(std::vector<std::string> &tks) {
+    Timeout timeout = directive2timeout(tks[0]);
+    if ((tks.size() != 2) || (timeout == N_TIMEOUTS))
+        throw std::runtime_error("Invalid " + tks[0] + " directive");
+    _timeouts[timeout] = parseDuration(tks[1]);
+}
+
 /// @brief Sets the IP address for the server.
 /// @param ip The IP address to set.
 /// @param sockaadr The sockaddr_in object to set the IP address for.
@@ -0,0 +1,190 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StrView.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/09 11:02:14 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/09 11:02:14 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup StrViewModule String View Module
+ * @{
+ *
+ * Non-owning slices of the request buffer, compared and searched in place.
+ *
+ * @version 1.0
+ */
+
+#include "../inc/StrView.hpp"
+#include <cstring>   // std::memchr() std::strlen() memmem()
+#include <strings.h> // strncasecmp()
+
+/// @brief Checks for the whitespace trim() strips.
+static bool isBlank(char c) {
+    return ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'));
+}
+
+/* ************************************************************************** */
+/*                                 Accessors                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Copies the viewed bytes into a string.
+ *
+ * @return The bytes of the view.
+ */
+std::string StrView::str(void) const {
+    if (size == 0)
+        return (std::string());
+    return (std::string(data, size));
+}
+
+/* ************************************************************************** */
+/*                                 Comparison                                 */
+/* ************************************************************************** */
+
+/**
+ * @brief Checks if the view holds exactly a string.
+ *
+ * @param str A NUL-terminated string.
+ * @return true if the bytes are the same.
+ */
+bool StrView::equals(const char *str) const {
+    std::size_t len = std::strlen(str);
+    return ((len == size) && (std::memcmp(data, str, len) == 0));
+}
+
+/**
+ * @brief Checks if the view holds a string, ignoring ASCII case.
+ *
+ * @param str A NUL-terminated string.
+ * @return true if the bytes are the same but for their case.
+ */
+bool StrView::iequals(const char *str) const {
+    std::size_t len = std::strlen(str);
+    return ((len == size) && (strncasecmp(data, str, len) == 0));
+}
+
+/**
+ * @brief Checks if two views hold the same bytes, ignoring ASCII case.
+ *
+ * @param other The view to compare with.
+ * @return true if the bytes are the same but for their case.
+ */
+bool StrView::iequals(const StrView &other) const {
+    return ((size == other.size) &&
+            ((size == 0) || (strncasecmp(data, other.data, size) == 0)));
+}
+
+/**
+ * @brief Checks if the view starts with a prefix, ignoring ASCII case.
+ *
+ * @param prefix A NUL-terminated string.
+ * @return true if the first bytes are the prefix.
+ */
+bool StrView::istartsWith(const char *prefix) const {
+    std::size_t len = std::strlen(prefix);
+    return ((len <= size) && (strncasecmp(data, prefix, len) == 0));
+}
+
+/* ************************************************************************** */
+/*                                   Search                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Finds the first occurrence of a byte.
+ *
+ * @param c The byte to look for.
+ * @param pos The offset the search starts at.
+ * @return The offset of the byte, or std::string::npos.
+ */
+std::size_t StrView::find(char c, std::size_t pos) const {
+    if (pos >= size)
+        return (std::string::npos);
+    const void *found = std::memchr(data + pos, c, size - pos);
+    if (found == NULL)
+        return (std::string::npos);
+    return (static_cast<const char *>(found) - data);
+}
+
+/**
+ * @brief Finds the first occurrence of a byte sequence.
+ *
+ * @param needle The bytes to look for.
+ * @param pos The offset the search starts at.
+ * @return The offset of the sequence, or std::string::npos.
+ */
+std::size_t StrView::find(const std::string &needle, std::size_t pos) const {
+    if ((pos > size) || (needle.size() > (size - pos)))
+        return (std::string::npos);
+    if (needle.empty())
+        return (pos);
+    const void *found =
+        memmem(data + pos, size - pos, needle.data(), needle.size());
+    if (found == NULL)
+        return (std::string::npos);
+    return (static_cast<const char *>(found) - data);
+}
+
+/**
+ * @brief Finds the last occurrence of a byte.
+ *
+ * @param c The byte to look for.
+ * @return The offset of the byte, or std::string::npos.
+ */
+std::size_t StrView::rfind(char c) const {
+    for (std::size_t i = size; i > 0; --i)
+        if (data[i - 1] == c)
+            return (i - 1);
+    return (std::string::npos);
+}
+
+/* ************************************************************************** */
+/*                                  Slicing                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Gets a part of the view, without copying.
+ *
+ * @param pos The offset of the part, clamped to the size.
+ * @param len The length of the part, clamped to what is left.
+ * @return The part.
+ */
+StrView StrView::substr(std::size_t pos, std::size_t len) const {
+    if (pos > size)
+        pos = size;
+    if (len > (size - pos))
+        len = size - pos;
+    return (StrView(data + pos, len));
+}
+
+/**
+ * @brief Strips the whitespace (" \t\r\n") around the view.
+ *
+ * @return The trimmed view.
+ */
+StrView StrView::trim(void) const {
+    std::size_t start = 0;
+    std::size_t end = size;
+    while ((start < end) && isBlank(data[start]))
+        ++start;
+    while ((end > start) && isBlank(data[end - 1]))
+        --end;
+    return (StrView(data + start, end - start));
+}
+
+/* ************************************************************************** */
+/*                                 Overloads                                  */
+/* ************************************************************************** */
+
+std::ostream &operator<<(std::ostream &os, const StrView &view) {
+    if (view.size > 0)
+        os.write(view.data, view.size);
+    return (os);
+}
+
+/** @} */
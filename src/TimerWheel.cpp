@@ -0,0 +1,292 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/03/28 15:02:44 by passunca          #+#    #+#             */
+/*   Updated: 2025/03/28 15:02:44 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @defgroup TimerWheelModule Timer Wheel Module
+ * @{
+ *
+ * Hierarchical timing wheel used by the Cluster event loop to expire idle,
+ * slow and abandoned connections in O(1).
+ *
+ * @version 1.0
+ */
+
+#include "../inc/TimerWheel.hpp"
+#include <ctime> // clock_gettime()
+
+/* ************************************************************************** */
+/*                                   Timer                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs an unlinked timer.
+ */
+TimerWheel::Timer::Timer(void)
+    : prev(NULL), next(NULL), expires(0), fd(-1), wheel(NULL) {}
+
+/**
+ * @brief Copy constructor: copies the owner, never the link.
+ *
+ * @details A linked node can not be duplicated without corrupting its slot
+ * list, so the copy starts unlinked.
+ *
+ * @param copy The timer to copy from.
+ */
+TimerWheel::Timer::Timer(const Timer &copy)
+    : prev(NULL), next(NULL), expires(0), fd(copy.fd), wheel(NULL) {}
+
+/**
+ * @brief Assignment operator: copies the owner, keeps the current link.
+ *
+ * @param src The timer to copy from.
+ * @return A reference to this timer.
+ */
+TimerWheel::Timer &TimerWheel::Timer::operator=(const Timer &src) {
+    fd = src.fd;
+    return (*this);
+}
+
+/**
+ * @brief Removes the timer from its wheel, if linked.
+ */
+TimerWheel::Timer::~Timer(void) {
+    if (wheel != NULL)
+        wheel->cancel(*this);
+}
+
+/**
+ * @brief Checks if the timer is scheduled.
+ *
+ * @return true if the timer is linked in a wheel, false otherwise.
+ */
+bool TimerWheel::Timer::isActive(void) const { return (wheel != NULL); }
+
+/* ************************************************************************** */
+/*                          Constructor & Destructor                          */
+/* ************************************************************************** */
+
+/**
+ * @brief Constructs an empty wheel starting at the current time.
+ */
+TimerWheel::TimerWheel(void) : _currentTick(now() / TIMER_TICK_MS), _count(0) {
+    for (int level = 0; level < TIMER_LEVELS; ++level) {
+        for (int slot = 0; slot < TIMER_SLOTS; ++slot) {
+            _slots[level][slot].prev = &_slots[level][slot];
+            _slots[level][slot].next = &_slots[level][slot];
+        }
+    }
+}
+
+/**
+ * @brief Destroys the wheel, unlinking the timers still scheduled.
+ */
+TimerWheel::~TimerWheel(void) {
+    for (int level = 0; level < TIMER_LEVELS; ++level) {
+        for (int slot = 0; slot < TIMER_SLOTS; ++slot) {
+            Timer *head = &_slots[level][slot];
+            while (head->next != head)
+                unlink(*head->next);
+        }
+    }
+}
+
+/* ************************************************************************** */
+/*                                   Timers                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Schedules (or re-schedules) a timer to expire after a delay.
+ *
+ * @param timer The timer to schedule.
+ * @param delayMs The delay in milliseconds.
+ */
+void TimerWheel::schedule(Timer &timer, long delayMs) {
+    if (timer.wheel != NULL)
+        timer.wheel->cancel(timer);
+
+    uint64_t nowTick = now() / TIMER_TICK_MS;
+    if (_count == 0) // Nothing pending: jump straight to the present
+        _currentTick = nowTick;
+
+    uint64_t ticks = (delayMs <= 0) ? 1 : ((delayMs + TIMER_TICK_MS - 1) /
+                                           TIMER_TICK_MS);
+    timer.expires = nowTick + ticks;
+    if (timer.expires <= _currentTick)
+        timer.expires = (_currentTick + 1);
+    link(timer);
+}
+
+/**
+ * @brief Cancels a timer. Does nothing if it is not scheduled.
+ *
+ * @param timer The timer to cancel.
+ */
+void TimerWheel::cancel(Timer &timer) {
+    if (timer.wheel != this)
+        return;
+    unlink(timer);
+}
+
+/**
+ * @brief Turns the wheel up to the current time.
+ *
+ * @param expired Filled with the owners (fds) of every expired timer. The
+ * expired timers are unlinked before being reported.
+ */
+void TimerWheel::advance(std::vector<int> &expired) {
+    uint64_t nowTick = now() / TIMER_TICK_MS;
+    if (_count == 0) {
+        _currentTick = nowTick;
+        return;
+    }
+
+    while ((_currentTick < nowTick) && (_count > 0)) {
+        ++_currentTick;
+        int idx = static_cast<int>(_currentTick & TIMER_SLOT_MASK);
+        if (idx == 0)
+            cascade(1);
+
+        Timer *head = &_slots[0][idx];
+        while (head->next != head) {
+            Timer *timer = head->next;
+            unlink(*timer);
+            expired.push_back(timer->fd);
+        }
+    }
+    if (_currentTick < nowTick)
+        _currentTick = nowTick;
+}
+
+/**
+ * @brief Computes how long epoll_wait may block before the next deadline.
+ *
+ * @details Level 0 gives the exact slot of the next expiry. For higher levels
+ * the time of the next cascade is used: the loop wakes up then and level 0
+ * takes over.
+ *
+ * @return The timeout in milliseconds, or -1 if no timer is scheduled.
+ */
+int TimerWheel::getNextTimeout(void) const {
+    if (_count == 0)
+        return (-1);
+
+    uint64_t next = 0;
+    for (int level = 0; level < TIMER_LEVELS; ++level) {
+        int shift = (level * TIMER_SLOT_BITS);
+        uint64_t base = (_currentTick >> shift);
+        for (uint64_t k = 1; k <= TIMER_SLOTS; ++k) {
+            const Timer *head = &_slots[level][(base + k) & TIMER_SLOT_MASK];
+            if (head->next != head) {
+                uint64_t tick = ((base + k) << shift);
+                if ((next == 0) || (tick < next))
+                    next = tick;
+                break;
+            }
+        }
+    }
+
+    uint64_t nowMs = now();
+    uint64_t nextMs = (next * TIMER_TICK_MS);
+    if (nextMs <= nowMs)
+        return (0);
+    if ((nextMs - nowMs) > INT_MAX)
+        return (INT_MAX);
+    return (static_cast<int>(nextMs - nowMs));
+}
+
+/**
+ * @brief Returns the current monotonic time.
+ *
+ * @return Milliseconds since an arbitrary, fixed point in the past.
+ */
+uint64_t TimerWheel::now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((static_cast<uint64_t>(ts.tv_sec) * 1000) +
+            (static_cast<uint64_t>(ts.tv_nsec) / 1000000));
+}
+
+/* ************************************************************************** */
+/*                                  Private                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Links a timer in the slot matching its expiry.
+ *
+ * @param timer The timer to link, with its expiry set.
+ */
+void TimerWheel::link(Timer &timer) {
+    uint64_t delta = (timer.expires - _currentTick);
+    uint64_t maxDelta = (1ULL << (TIMER_LEVELS * TIMER_SLOT_BITS)) - 1;
+    if (delta > maxDelta) { // Clamp to the range of the wheel
+        delta = maxDelta;
+        timer.expires = (_currentTick + delta);
+    }
+
+    int level = 0;
+    while ((level < (TIMER_LEVELS - 1)) &&
+           (delta >= (1ULL << ((level + 1) * TIMER_SLOT_BITS))))
+        ++level;
+    int slot = static_cast<int>((timer.expires >> (level * TIMER_SLOT_BITS)) &
+                                TIMER_SLOT_MASK);
+
+    Timer *head = &_slots[level][slot];
+    timer.prev = head->prev;
+    timer.next = head;
+    head->prev->next = &timer;
+    head->prev = &timer;
+    timer.wheel = this;
+    ++_count;
+}
+
+/**
+ * @brief Unlinks a timer from its slot.
+ *
+ * @param timer The linked timer.
+ */
+void TimerWheel::unlink(Timer &timer) {
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = NULL;
+    timer.next = NULL;
+    timer.wheel = NULL;
+    --_count;
+}
+
+/**
+ * @brief Moves the timers of the current slot of a level to lower levels.
+ *
+ * @details Called when the level below completes a full turn. When this
+ * level also wraps around, the level above is cascaded first.
+ *
+ * @param level The level to cascade.
+ */
+void TimerWheel::cascade(int level) {
+    if (level >= TIMER_LEVELS)
+        return;
+
+    int idx = static_cast<int>((_currentTick >> (level * TIMER_SLOT_BITS)) &
+                               TIMER_SLOT_MASK);
+    Timer *head = &_slots[level][idx];
+    Timer *timer = head->next;
+    head->prev = head; // Detach the whole list, then re-link every node
+    head->next = head;
+    while (timer != head) {
+        Timer *next = timer->next;
+        --_count;
+        link(*timer);
+        timer = next;
+    }
+    if (idx == 0)
+        cascade(level + 1);
+}
+/** @} */
@@ -88,23 +88,33 @@ std::string method2string(Method method) {
  * @return The corresponding HTTP method enum.
  */
 Method string2method(const std::string &str) {
-	if (str == "GET")
+	return (string2method(StrView(str)));
+}
+
+/**
+ * @brief Converts a slice of a request to its HTTP method enum.
+ *
+ * @param str The method token, as received.
+ * @return The corresponding HTTP method enum, or UNKNOWN.
+ */
+Method string2method(const StrView &str) {
+	if (str.equals("GET"))
 		return (GET);
-	else if (str == "POST")
+	else if (str.equals("POST"))
 		return (POST);
-	else if (str == "DELETE")
+	else if (str.equals("DELETE"))
 		return (DELETE);
-	else if (str == "HEAD")
+	else if (str.equals("HEAD"))
 		return (HEAD);
-	else if (str == "PUT")
+	else if (str.equals("PUT"))
 		return (PUT);
-	else if (str == "CONNECT")
+	else if (str.equals("CONNECT"))
 		return (CONNECT);
-	else if (str == "OPTIONS")
+	else if (str.equals("OPTIONS"))
 		return (OPTIONS);
-	else if (str == "TRACE")
+	else if (str.equals("TRACE"))
 		return (TRACE);
-	else if (str == "PATCH")
+	else if (str.equals("PATCH"))
 		return (PATCH);
 	else
 		return (UNKNOWN);
@@ -123,6 +133,98 @@ std::string err2string(ErrCodes code) {
     return number2string<int>(code);
 }
 
+/**
+ * @brief Checks if a comma-separated header value lists a token.
+ *
+ * @param value The header value (e.g. `gzip, chunked`).
+ * @param token The token to look for, compared case-insensitively.
+ * @return true if the token is one of the list elements, false otherwise.
+ */
+bool isHeaderToken(const StrView &value, const char *token) {
+	std::size_t start = 0;
+	while (start <= value.size) {
+		std::size_t comma = value.find(',', start);
+		if (comma == std::string::npos)
+			comma = value.size;
+		if (value.substr(start, comma - start).trim().iequals(token))
+			return (true);
+		start = comma + 1;
+	}
+	return (false);
+}
+
+/* ************************************************************************** */
+/*                                  Storage                                   */
+/* ************************************************************************** */
+
+/**
+ * @brief Storage counter updated by reserveStorage() and releaseStorage().
+ *
+ * Points to the global storageSize, or to an anonymous shared mapping once
+ * shareStorage() has been called by the master process.
+ */
+static std::size_t *storageCounter = &storageSize;
+
+/**
+ * @brief Atomically reserves storage for an upload.
+ *
+ * Worker threads share the global storageSize counter, so the check against
+ * MAX_STORAGE_SIZE and the update are done in a single compare-and-swap loop.
+ *
+ * @param bytes The number of bytes to store.
+ * @return true if the bytes were accounted, false if the limit is exceeded.
+ */
+bool reserveStorage(std::size_t bytes) {
+	std::size_t current = *storageCounter;
+	while (true) {
+		if ((current + bytes) > MAX_STORAGE_SIZE)
+			return (false);
+		std::size_t seen = __sync_val_compare_and_swap(storageCounter, current,
+													   current + bytes);
+		if (seen == current)
+			return (true);
+		current = seen;
+	}
+}
+
+/**
+ * @brief Atomically releases storage, never going below zero.
+ *
+ * Files that existed before the server started are not accounted, so
+ * deleting them must not wrap the counter around.
+ *
+ * @param bytes The number of bytes released.
+ */
+void releaseStorage(std::size_t bytes) {
+	std::size_t current = *storageCounter;
+	while (true) {
+		std::size_t next = (bytes > current) ? 0 : (current - bytes);
+		std::size_t seen =
+			__sync_val_compare_and_swap(storageCounter, current, next);
+		if (seen == current)
+			return;
+		current = seen;
+	}
+}
+
+/**
+ * @brief Moves the storage counter to memory shared between processes.
+ *
+ * Called by the master before forking worker processes, so that uploads and
+ * deletes in any worker count against the same MAX_STORAGE_SIZE.
+ *
+ * @throw std::runtime_error if the shared mapping cannot be created.
+ */
+void shareStorage(void) {
+	void *shared = mmap(NULL, sizeof(std::size_t), PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED)
+		throw std::runtime_error("Failed to map shared storage counter: " +
+								 std::string(std::strerror(errno)));
+	*static_cast<std::size_t *>(shared) = *storageCounter;
+	storageCounter = static_cast<std::size_t *>(shared);
+}
+
 /* ************************************************************************** */
 /*                                    Time                                    */
 /* ************************************************************************** */
@@ -206,11 +308,62 @@ static int getMonthFromStr(const std::string &month_str) {
  */
 std::string getHttpDate() {
 	std::time_t now = std::time(0);
-	std::tm *gmt = std::gmtime(&now);
+	std::tm gmt;
+	gmtime_r(&now, &gmt);
 	char buf[35];
-	std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", gmt);
+	std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
 	return (std::string(buf));
 }
 
-/** @} */
+/**
+ * @brief Parses a duration as used by the timeout directives.
+ *
+ * A bare number is a number of seconds (like nginx). The suffixes `ms`, `s`,
+ * `m` and `h` are accepted.
+ *
+ * @param value The duration string.
+ * @return The duration in milliseconds.
+ * @throws std::runtime_error if the duration is invalid or out of range.
+ */
+long parseDuration(const std::string &value) {
+	char *end = NULL;
+	long num = std::strtol(value.c_str(), &end, 10);
+	if ((end == value.c_str()) || (num < 0))
+		throw std::runtime_error("Invalid duration: " + value);
+
+	std::string unit(end);
+	long factor = 0;
+	if (unit.empty() || (unit == "s"))
+		factor = 1000;
+	else if (unit == "ms")
+		factor = 1;
+	else if (unit == "m")
+		factor = (60 * 1000);
+	else if (unit == "h")
+		factor = (60 * 60 * 1000);
+	else
+		throw std::runtime_error("Invalid duration unit: " + value);
 
+	if (num > (LONG_MAX / factor))
+		throw std::runtime_error("Duration out of range: " + value);
+	return (num * factor);
+}
+
+/**
+ * @brief Maps a timeout directive name to its Timeout.
+ *
+ * @param directive The directive name.
+ * @return The Timeout, or N_TIMEOUTS if it is not a timeout directive.
+ */
+Timeout directive2timeout(const std::string &directive) {
+	static const char *names[N_TIMEOUTS] = {
+		"client_header_timeout", "client_body_timeout", "keepalive_timeout",
+		"send_timeout"};
+
+	for (int i = 0; i < N_TIMEOUTS; ++i)
+		if (directive == names[i])
+			return (static_cast<Timeout>(i));
+	return (N_TIMEOUTS);
+}
+
+/** @} */
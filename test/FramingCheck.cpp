@@ -0,0 +1,97 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FramingCheck.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: passunca <passunca@student.42porto.com>    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/04/14 18:21:05 by passunca          #+#    #+#             */
+/*   Updated: 2025/04/14 18:21:05 by passunca         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/**
+ * @file FramingCheck.cpp
+ * @brief Checks that the request framer and parser agree on a request.
+ *
+ * Each case is framed by Connection::frameRequest() as if it had just been
+ * received, then compared to the status, length and persistence expected.
+ * A request that would be framed differently from how it is parsed must be
+ * rejected and its connection closed, or the bytes after it would be taken
+ * for another request (request smuggling). Exits non-zero on a failure.
+ *
+ * Run with `make framing_check`.
+ */
+
+#include "../inc/Connection.hpp"
+#include <cstdio> // std::printf()
+
+/// @brief A request and how it must be framed.
+struct FramingCase {
+    const char *name;
+    const char *raw;
+    unsigned short status; /**< The expected framingStatus. */
+    std::size_t headerLen; /**< The expected header block length. */
+    std::size_t bodyLen;   /**< The expected body, if the status is OK. */
+    bool mustClose;        /**< The connection must close after it. */
+};
+
+static const FramingCase CASES[] = {
+    // Parsed as "Content-Length: 39", the body framed as a second request
+    {"bare LF before Content-Length",
+     "POST /cgi-bin/py/echo.py HTTP/1.1\r\nHost: x\r\nX: a\nContent-Length: "
+     "39\r\n\r\nGET /cgi-bin/py/echo.py HTTP/1.1\r\n\r\n",
+     BAD_REQUEST, 71, 0, true},
+    {"bare CR in a field", "GET / HTTP/1.1\r\nHost: x\rX: a\r\n\r\n",
+     BAD_REQUEST, 32, 0, true},
+    {"bare LF after the request line",
+     "GET / HTTP/1.1\nHost: x\r\nContent-Length: 3\r\n\r\nabc", BAD_REQUEST,
+     45, 0, true},
+    {"CRLF only", "POST / HTTP/1.1\r\nHost: x\r\nContent-Length: 3\r\n\r\nabc",
+     OK, 47, 3, false},
+    {"TE and CL", "POST / HTTP/1.1\r\nHost: x\r\nContent-Length: 3\r\n"
+                  "Transfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n",
+     OK, 75, 3, true},
+    {"conflicting CL", "POST / HTTP/1.1\r\nContent-Length: 3\r\n"
+                       "Content-Length: 4\r\n\r\nabcd",
+     BAD_REQUEST, 57, 0, true},
+};
+static const std::size_t N_CASES = sizeof(CASES) / sizeof(CASES[0]);
+
+/**
+ * @brief Frames one case and compares it to what is expected.
+ *
+ * @return true if it was framed as expected (reported on stdout).
+ */
+static bool checkCase(const FramingCase &c) {
+    Connection conn(-1);
+
+    conn.requestBuff = c.raw;
+    bool framed = conn.frameRequest();
+    std::size_t expectedLen =
+        c.headerLen + ((c.status == OK) ? c.bodyLen : 0);
+    bool ok = framed && (conn.framingStatus == c.status) &&
+              (conn.headerLen == c.headerLen) &&
+              (conn.requestLen == expectedLen) &&
+              (conn.mustClose == c.mustClose);
+    std::printf("%s %s: status %u, header %lu, request %lu%s\n",
+                ok ? "[OK]  " : "[FAIL]", c.name, conn.framingStatus,
+                static_cast<unsigned long>(conn.headerLen),
+                static_cast<unsigned long>(conn.requestLen),
+                conn.mustClose ? ", close" : "");
+    return (ok);
+}
+
+int main(void) {
+    int failed = 0;
+
+    for (std::size_t i = 0; i < N_CASES; ++i)
+        failed += !checkCase(CASES[i]);
+    if (failed) {
+        std::printf("[FAIL] %d of %lu cases\n", failed,
+                    static_cast<unsigned long>(N_CASES));
+        return (1);
+    }
+    std::printf("[OK] every request is framed as it is parsed\n");
+    return (0);
+}